@@ -238,6 +238,7 @@ solution("xenia")
   include("src/xenia")
   include("src/xenia/app")
   include("src/xenia/apu")
+  include("src/xenia/apu/headless")
   include("src/xenia/apu/nop")
   include("src/xenia/base")
   include("src/xenia/cpu")
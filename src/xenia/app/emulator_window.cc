@@ -115,6 +115,9 @@ bool EmulatorWindow::Initialize() {
       case 0x74: {  // VK_F5
         GpuClearCaches();
       } break;
+      case 0x75: {  // VK_F6
+        CpuDumpJitStats();
+      } break;
       case 0x76: {  // VK_F7
         // Save to file
         // TODO: Choose path based on user input, or from options
@@ -204,6 +207,9 @@ bool EmulatorWindow::Initialize() {
     cpu_menu->AddChild(MenuItem::Create(MenuItem::Type::kString,
                                         L"&Pause/Resume Profiler", L"`",
                                         []() { Profiler::TogglePause(); }));
+    cpu_menu->AddChild(MenuItem::Create(
+        MenuItem::Type::kString, L"Dump &JIT Stats", L"F6",
+        std::bind(&EmulatorWindow::CpuDumpJitStats, this)));
   }
   cpu_menu->AddChild(MenuItem::Create(MenuItem::Type::kSeparator));
   {
@@ -348,6 +354,15 @@ void EmulatorWindow::CpuTimeScalarSetDouble() {
   UpdateTitle();
 }
 
+void EmulatorWindow::CpuDumpJitStats() {
+  auto processor = emulator()->processor();
+  if (!processor || !processor->compile_stats()) {
+    XELOGW("JIT stats are only collected when launched with --jit_stats");
+    return;
+  }
+  processor->DumpCompileStats();
+}
+
 void EmulatorWindow::CpuBreakIntoDebugger() {
   if (!FLAGS_debug) {
     xe::ui::ImGuiDialog::ShowMessageBox(window_.get(), "Xenia Debugger",
@@ -50,6 +50,7 @@ class EmulatorWindow {
   void CpuTimeScalarReset();
   void CpuTimeScalarSetHalf();
   void CpuTimeScalarSetDouble();
+  void CpuDumpJitStats();
   void CpuBreakIntoDebugger();
   void GpuTraceFrame();
   void GpuClearCaches();
@@ -19,6 +19,7 @@ project("xenia-app")
     "spirv-tools",
     "volk",
     "xenia-apu",
+    "xenia-apu-headless",
     "xenia-apu-nop",
     "xenia-base",
     "xenia-core",
@@ -21,6 +21,7 @@
 #include "xenia/vfs/devices/host_path_device.h"
 
 // Available audio systems:
+#include "xenia/apu/headless/headless_audio_system.h"
 #include "xenia/apu/nop/nop_audio_system.h"
 #if XE_PLATFORM_WIN32
 #include "xenia/apu/xaudio2/xaudio2_audio_system.h"
@@ -37,7 +38,7 @@
 #include "xenia/hid/xinput/xinput_hid.h"
 #endif  // XE_PLATFORM_WIN32
 
-DEFINE_string(apu, "any", "Audio system. Use: [any, nop, xaudio2]");
+DEFINE_string(apu, "any", "Audio system. Use: [any, nop, headless, xaudio2]");
 DEFINE_string(gpu, "any", "Graphics system. Use: [any, vulkan, null]");
 DEFINE_string(hid, "any", "Input system. Use: [any, nop, winkey, xinput]");
 
@@ -53,6 +54,8 @@ namespace app {
 std::unique_ptr<apu::AudioSystem> CreateAudioSystem(cpu::Processor* processor) {
   if (FLAGS_apu.compare("nop") == 0) {
     return apu::nop::NopAudioSystem::Create(processor);
+  } else if (FLAGS_apu.compare("headless") == 0) {
+    return apu::headless::HeadlessAudioSystem::Create(processor);
 #if XE_PLATFORM_WIN32
   } else if (FLAGS_apu.compare("xaudio2") == 0) {
     return apu::xaudio2::XAudio2AudioSystem::Create(processor);
@@ -10,3 +10,10 @@
 #include "xenia/apu/apu_flags.h"
 
 DEFINE_bool(mute, false, "Mutes all audio output.");
+DEFINE_int32(xma_decoder_threads, 2,
+             "Number of threads decoding XMA contexts in parallel.");
+DEFINE_int32(audio_target_latency_ms, 0,
+             "Audio latency to keep queued per client, in milliseconds. The "
+             "worker sleeps until half of it has played, refills it in one "
+             "batch and grows the target on starvation. 0 keeps the driver "
+             "queue full, waking for every frame.");
@@ -13,5 +13,7 @@
 #include <gflags/gflags.h>
 
 DECLARE_bool(mute);
+DECLARE_int32(xma_decoder_threads);
+DECLARE_int32(audio_target_latency_ms);
 
 #endif  // XENIA_APU_APU_FLAGS_H_
@@ -81,12 +81,51 @@ X_STATUS AudioSystem::Setup(kernel::KernelState* kernel_state) {
   return X_STATUS_SUCCESS;
 }
 
+// Duration of one 256 sample frame at 48kHz, in microseconds.
+const uint32_t kFrameDurationUs = 256 * 1000000 / 48000;
+// Frames played without starving before a grown target is trimmed back.
+const uint32_t kTargetShrinkFrames = 1024;
+
 void AudioSystem::WorkerThreadMain() {
   // Initialize driver and ringbuffer.
   Initialize();
 
+  uint32_t base_target_frames = kMaximumQueuedFrames;
+  uint32_t refill_frames = 1;
+  if (FLAGS_audio_target_latency_ms > 0) {
+    base_target_frames = xe::clamp<uint32_t>(
+        uint32_t(FLAGS_audio_target_latency_ms) * 1000 / kFrameDurationUs, 2,
+        uint32_t(kMaximumQueuedFrames));
+    // Refill once half of the queue has played.
+    refill_frames = base_target_frames / 2;
+  }
+
+  struct Batch {
+    size_t index;
+    uint32_t callback;
+    cpu::Function* function;
+    uint32_t callback_arg;
+    uint32_t frame_count;
+  };
+  Batch batches[kMaximumClientCount];
+  // Frames that can play before any client drops to its refill level.
+  uint32_t idle_frames = 0;
+
   // Main run loop.
   while (worker_running_) {
+    if (idle_frames > 1) {
+      // Nothing needs refilling for a while, so don't wake for every frame
+      // the drivers release in the meantime; the semaphores keep count. Stop
+      // one frame short so the wait below still catches the refill point.
+      auto timeout = std::chrono::milliseconds(
+          (idle_frames - 1) * kFrameDurationUs / 1000);
+      if (xe::threading::Wait(shutdown_event_.get(), true, timeout) ==
+          xe::threading::WaitResult::kSuccess) {
+        // Leave it for the wait below to handle.
+        shutdown_event_->Set();
+      }
+    }
+
     // These handles signify the number of submitted samples. Once we reach
     // 64 samples, we wait until our audio backend releases a semaphore
     // (signaling a sample has finished playing)
@@ -108,34 +147,94 @@ void AudioSystem::WorkerThreadMain() {
       continue;
     }
 
-    // Number of clients pumped
-    bool pumped = false;
+    // Collect the frames each driver has finished since the last wake and
+    // decide how many callbacks every client needs to get back to its target.
+    size_t batch_count = 0;
+    idle_frames = UINT32_MAX;
+    auto global_lock = global_critical_region_.Acquire();
     if (result.first == xe::threading::WaitResult::kSuccess) {
-      auto index = result.second;
+      // The wait itself took one of this client's frames.
+      ++clients_[result.second].credits;
+    }
+    for (size_t i = 0; i < kMaximumClientCount; ++i) {
+      auto& client = clients_[i];
+      if (!client.in_use || !client.callback) {
+        continue;
+      }
+      while (xe::threading::Wait(client_semaphores_[i].get(), false,
+                                 std::chrono::milliseconds(0)) ==
+             xe::threading::WaitResult::kSuccess) {
+        ++client.credits;
+      }
+      if (!client.target_frames) {
+        client.target_frames = base_target_frames;
+      }
 
-      auto global_lock = global_critical_region_.Acquire();
-      uint32_t client_callback = clients_[index].callback;
-      uint32_t client_callback_arg = clients_[index].wrapped_callback_arg;
-      global_lock.unlock();
+      uint32_t queued = uint32_t(kMaximumQueuedFrames) - client.credits;
+      if (client.started && !queued) {
+        // The driver ran dry before we woke; keep more queued from now on.
+        client.target_frames = std::min(client.target_frames + 1,
+                                        uint32_t(kMaximumQueuedFrames));
+        client.frames_since_starved = 0;
+      }
+      uint32_t refill_level = client.target_frames -
+                              std::min(refill_frames, client.target_frames);
+      if (queued <= refill_level) {
+        uint32_t frame_count =
+            std::min(client.credits, client.target_frames - queued);
+        if (frame_count) {
+          client.credits -= frame_count;
+          client.started = true;
+          queued += frame_count;
+          batches[batch_count++] = {i, client.callback, client.function,
+                                    client.wrapped_callback_arg, frame_count};
+
+          client.frames_since_starved += frame_count;
+          if (client.frames_since_starved >= kTargetShrinkFrames &&
+              client.target_frames > base_target_frames) {
+            --client.target_frames;
+            client.frames_since_starved = 0;
+          }
+        }
+      }
+      idle_frames = std::min(
+          idle_frames, queued > refill_level ? queued - refill_level : 0);
+    }
+    if (idle_frames == UINT32_MAX) {
+      // No clients; block until one registers.
+      idle_frames = 0;
+    }
+    global_lock.unlock();
+
+    // Pump every pending frame of a client back to back on the worker's
+    // persistent thread state.
+    for (size_t i = 0; i < batch_count; ++i) {
+      auto& batch = batches[i];
+      if (!batch.function) {
+        batch.function = processor_->ResolveFunction(batch.callback);
+        if (!batch.function) {
+          XELOGE("Unable to resolve audio client callback %.8X",
+                 batch.callback);
+          continue;
+        }
+        global_lock.lock();
+        if (clients_[batch.index].callback == batch.callback) {
+          clients_[batch.index].function = batch.function;
+        }
+        global_lock.unlock();
+      }
 
-      if (client_callback) {
-        SCOPE_profile_cpu_i("apu", "xe::apu::AudioSystem->client_callback");
-        uint64_t args[] = {client_callback_arg};
-        processor_->Execute(worker_thread_->thread_state(), client_callback,
+      SCOPE_profile_cpu_i("apu", "xe::apu::AudioSystem->client_callback");
+      for (uint32_t j = 0; j < batch.frame_count && worker_running_; ++j) {
+        uint64_t args[] = {batch.callback_arg};
+        processor_->Execute(worker_thread_->thread_state(), batch.function,
                             args, xe::countof(args));
       }
-
-      pumped = true;
     }
 
     if (!worker_running_) {
       break;
     }
-
-    if (!pumped) {
-      SCOPE_profile_cpu_i("apu", "Sleep");
-      xe::threading::Sleep(std::chrono::milliseconds(500));
-    }
   }
   worker_running_ = false;
 
@@ -271,6 +370,11 @@ bool AudioSystem::Restore(ByteStream* stream) {
     client.wrapped_callback_arg = stream->Read<uint32_t>();
 
     client.in_use = true;
+    client.function = nullptr;
+    client.credits = 0;
+    client.target_frames = 0;
+    client.frames_since_starved = 0;
+    client.started = false;
 
     auto client_semaphore = client_semaphores_[id].get();
     auto ret = client_semaphore->Release(kMaximumQueuedFrames, nullptr);
@@ -80,6 +80,15 @@ class AudioSystem {
     uint32_t callback_arg;
     uint32_t wrapped_callback_arg;
     bool in_use;
+    // Worker state; everything below is reset when the client is replaced.
+    // Callback resolved on first use so pumps skip the function lookup.
+    cpu::Function* function;
+    // Frames the driver has finished playing that have not been refilled.
+    uint32_t credits;
+    // Frames to keep queued in the driver; grows when the driver runs dry.
+    uint32_t target_frames;
+    uint32_t frames_since_starved;
+    bool started;
   } clients_[kMaximumClientCount];
 
   int FindFreeClient();
@@ -0,0 +1,114 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_CONVERSION_H_
+#define XENIA_APU_CONVERSION_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "xenia/base/math.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/platform.h"
+
+namespace xe {
+namespace apu {
+namespace conversion {
+
+// Converts planar float samples (nominally [-1, 1]) to interleaved big-endian
+// signed 16-bit PCM, as the XMA hardware writes it. Samples are clamped,
+// scaled by 32767 and truncated toward zero.
+
+// Reference implementation; handles any channel count.
+inline void planar_float_to_s16be_scalar(const float* const* channels,
+                                         int channel_count,
+                                         size_t first_sample,
+                                         size_t sample_count,
+                                         uint16_t* output) {
+  for (size_t i = first_sample; i < first_sample + sample_count; ++i) {
+    for (int j = 0; j < channel_count; ++j) {
+      float scaled_sample = xe::saturate(channels[j][i]) * ((1 << 15) - 1);
+      int sample = static_cast<int>(scaled_sample);
+      xe::store_and_swap<uint16_t>(output++, uint16_t(sample & 0xFFFF));
+    }
+  }
+}
+
+#if XE_ARCH_AMD64
+// Clamps, scales and truncates 8 floats to 8 big-endian s16 in one vector.
+inline __m128i float8_to_s16be(const float* src) {
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 minus_one = _mm_set1_ps(-1.0f);
+  const __m128 scale = _mm_set1_ps(float((1 << 15) - 1));
+  // min(x, 1) picks 1 for NaN, matching xe::saturate.
+  __m128 lo = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src), one), minus_one);
+  __m128 hi = _mm_max_ps(_mm_min_ps(_mm_loadu_ps(src + 4), one), minus_one);
+  __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(_mm_mul_ps(lo, scale)),
+                                   _mm_cvttps_epi32(_mm_mul_ps(hi, scale)));
+  const __m128i swap_mask =
+      _mm_set_epi8(14, 15, 12, 13, 10, 11, 8, 9, 6, 7, 4, 5, 2, 3, 0, 1);
+  return _mm_shuffle_epi8(packed, swap_mask);
+}
+#endif  // XE_ARCH_AMD64
+
+inline void planar_float_to_s16be_mono(const float* input, size_t count,
+                                       uint16_t* output) {
+  size_t i = 0;
+#if XE_ARCH_AMD64
+  for (; i + 8 <= count; i += 8) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i),
+                     float8_to_s16be(input + i));
+  }
+#endif  // XE_ARCH_AMD64
+  planar_float_to_s16be_scalar(&input, 1, i, count - i, output + i);
+}
+
+inline void planar_float_to_s16be_stereo(const float* left, const float* right,
+                                         size_t count, uint16_t* output) {
+  size_t i = 0;
+#if XE_ARCH_AMD64
+  for (; i + 8 <= count; i += 8) {
+    __m128i l = float8_to_s16be(left + i);
+    __m128i r = float8_to_s16be(right + i);
+    auto out = reinterpret_cast<__m128i*>(output + i * 2);
+    _mm_storeu_si128(out, _mm_unpacklo_epi16(l, r));
+    _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(l, r));
+  }
+#endif  // XE_ARCH_AMD64
+  const float* channels[] = {left + i, right + i};
+  planar_float_to_s16be_scalar(channels, 2, 0, count - i, output + i * 2);
+}
+
+// Converts sample_count samples starting at first_sample of every channel
+// into output.
+inline void planar_float_to_s16be(const float* const* channels,
+                                  int channel_count, size_t first_sample,
+                                  size_t sample_count, uint16_t* output) {
+  switch (channel_count) {
+    case 1:
+      planar_float_to_s16be_mono(channels[0] + first_sample, sample_count,
+                                 output);
+      break;
+    case 2:
+      planar_float_to_s16be_stereo(channels[0] + first_sample,
+                                   channels[1] + first_sample, sample_count,
+                                   output);
+      break;
+    default:
+      planar_float_to_s16be_scalar(channels, channel_count, first_sample,
+                                   sample_count, output);
+      break;
+  }
+}
+
+}  // namespace conversion
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_CONVERSION_H_
@@ -0,0 +1,20 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/headless/headless_apu_flags.h"
+
+DEFINE_string(headless_audio_wav, "",
+              "Captures headless audio output to the given .wav file. "
+              "Additional clients write to <name>.<index>.wav.");
+DEFINE_int32(headless_audio_channels, 2,
+             "Headless audio output channels: 2 (5.1 downmixed) or 6.");
+DEFINE_bool(headless_audio_realtime, true,
+            "Consume headless audio at the 48kHz host clock. When false "
+            "frames are consumed as fast as they are submitted, which is "
+            "useful for benchmarking the audio pipeline.");
@@ -0,0 +1,19 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_HEADLESS_HEADLESS_APU_FLAGS_H_
+#define XENIA_APU_HEADLESS_HEADLESS_APU_FLAGS_H_
+
+#include <gflags/gflags.h>
+
+DECLARE_string(headless_audio_wav);
+DECLARE_int32(headless_audio_channels);
+DECLARE_bool(headless_audio_realtime);
+
+#endif  // XENIA_APU_HEADLESS_HEADLESS_APU_FLAGS_H_
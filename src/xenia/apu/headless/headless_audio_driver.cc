@@ -0,0 +1,197 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/headless/headless_audio_driver.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstring>
+
+#include "xenia/apu/apu_flags.h"
+#include "xenia/apu/headless/headless_apu_flags.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+
+namespace xe {
+namespace apu {
+namespace headless {
+
+// Guest frames are 5.1 in WAVEFORMATEXTENSIBLE order: FL, FR, FC, LFE, BL, BR.
+// Stereo output uses the ITU-R BS.775 downmix and drops LFE.
+const float kDownmixCenter = 0.7071068f;
+const float kDownmixSurround = 0.7071068f;
+
+HeadlessAudioDriver::HeadlessAudioDriver(Memory* memory,
+                                         xe::threading::Semaphore* semaphore,
+                                         uint32_t channel_count,
+                                         SampleSink sink)
+    : AudioDriver(memory),
+      semaphore_(semaphore),
+      channel_count_(channel_count),
+      sink_(std::move(sink)) {}
+
+HeadlessAudioDriver::~HeadlessAudioDriver() { assert_false(running_); }
+
+bool HeadlessAudioDriver::Initialize() {
+  if (channel_count_ != 2 && channel_count_ != kFrameChannels) {
+    XELOGE("Headless audio: unsupported channel count %u", channel_count_);
+    return false;
+  }
+  frames_ = std::make_unique<Frame[]>(kQueuedFrames);
+  running_ = true;
+  output_thread_ = std::thread([this]() {
+    xe::threading::set_name("Headless Audio Output");
+    OutputThreadMain();
+  });
+  return true;
+}
+
+void HeadlessAudioDriver::SubmitFrame(uint32_t frame_ptr) {
+  uint32_t write_index = write_index_.load(std::memory_order_relaxed);
+  uint32_t read_index = read_index_.load(std::memory_order_acquire);
+  if (write_index - read_index >= kQueuedFrames) {
+    // The client semaphore should prevent this; drop rather than stall the
+    // audio worker. The dropped frame still returns its slot so the client
+    // doesn't lose a semaphore count for good.
+    ++overruns_;
+    auto ret = semaphore_->Release(1, nullptr);
+    assert_true(ret);
+    return;
+  }
+
+  auto input = memory_->TranslateVirtual<const float*>(frame_ptr);
+  auto& frame = frames_[write_index % kQueuedFrames];
+  float* output = frame.samples;
+  if (FLAGS_mute) {
+    std::memset(output, 0, sizeof(float) * channel_count_ * kChannelSamples);
+  } else if (channel_count_ == kFrameChannels) {
+    for (uint32_t i = 0; i < kChannelSamples; ++i) {
+      for (uint32_t channel = 0; channel < kFrameChannels; ++channel) {
+        *output++ = xe::byte_swap(input[channel * kChannelSamples + i]);
+      }
+    }
+  } else {
+    const float* fl = input;
+    const float* fr = input + kChannelSamples;
+    const float* fc = input + kChannelSamples * 2;
+    const float* bl = input + kChannelSamples * 4;
+    const float* br = input + kChannelSamples * 5;
+    for (uint32_t i = 0; i < kChannelSamples; ++i) {
+      float center = xe::byte_swap(fc[i]) * kDownmixCenter;
+      *output++ = xe::byte_swap(fl[i]) + center +
+                  xe::byte_swap(bl[i]) * kDownmixSurround;
+      *output++ = xe::byte_swap(fr[i]) + center +
+                  xe::byte_swap(br[i]) * kDownmixSurround;
+    }
+  }
+  frame.submit_ticks = Clock::QueryHostTickCount();
+
+  write_index_.store(write_index + 1, std::memory_order_release);
+  ++frames_submitted_;
+}
+
+void HeadlessAudioDriver::OutputThreadMain() {
+  const uint64_t frequency = Clock::host_tick_frequency();
+  std::unique_ptr<float[]> silence(new float[kFrameChannels * kChannelSamples]);
+  std::memset(silence.get(), 0,
+              sizeof(float) * kFrameChannels * kChannelSamples);
+
+  bool started = false;
+  uint64_t deadline = Clock::QueryHostTickCount();
+  while (running_) {
+    if (FLAGS_headless_audio_realtime) {
+      // One frame per period of the 48kHz clock, scaled like the XAudio2
+      // frequency ratio so audio keeps pace with the guest clock.
+      double scalar = std::max(Clock::guest_time_scalar(), 0.01);
+      uint64_t period =
+          uint64_t(double(frequency) * kChannelSamples / kSampleRate / scalar);
+      deadline += period;
+      uint64_t now = Clock::QueryHostTickCount();
+      if (now < deadline) {
+        xe::threading::Sleep(std::chrono::microseconds(
+            (deadline - now) * 1000000 / frequency));
+      } else if (now - deadline > period * kQueuedFrames) {
+        // Fell far behind (debugger break, suspend); resync the clock.
+        deadline = now;
+      }
+    }
+
+    uint32_t read_index = read_index_.load(std::memory_order_relaxed);
+    uint32_t write_index = write_index_.load(std::memory_order_acquire);
+    if (read_index == write_index) {
+      if (!FLAGS_headless_audio_realtime) {
+        // Nothing to pace against; just wait for the next frame.
+        xe::threading::Sleep(std::chrono::microseconds(100));
+      } else if (started) {
+        // The device would play silence here.
+        ++underruns_;
+        if (sink_) {
+          sink_(silence.get(), kChannelSamples, channel_count_);
+        }
+      }
+      continue;
+    }
+    started = true;
+
+    auto& frame = frames_[read_index % kQueuedFrames];
+    uint64_t latency = Clock::QueryHostTickCount() - frame.submit_ticks;
+    latency_ticks_total_ += latency;
+    uint64_t latency_max = latency_ticks_max_.load(std::memory_order_relaxed);
+    if (latency > latency_max) {
+      latency_ticks_max_.store(latency, std::memory_order_relaxed);
+    }
+    if (sink_) {
+      sink_(frame.samples, kChannelSamples, channel_count_);
+    }
+
+    read_index_.store(read_index + 1, std::memory_order_release);
+    ++frames_played_;
+
+    auto ret = semaphore_->Release(1, nullptr);
+    assert_true(ret);
+  }
+}
+
+void HeadlessAudioDriver::Shutdown() {
+  if (running_) {
+    running_ = false;
+    output_thread_.join();
+  }
+
+  auto stats = this->stats();
+  XELOGI(
+      "Headless audio: %" PRIu64 " frames submitted, %" PRIu64
+      " played, %" PRIu64 " underruns, %" PRIu64
+      " overruns, latency avg %.2fms max %.2fms",
+      stats.frames_submitted, stats.frames_played, stats.underruns,
+      stats.overruns, stats.average_latency_ms, stats.max_latency_ms);
+
+  // Release the sink so captures are finalized.
+  sink_ = nullptr;
+}
+
+HeadlessAudioDriver::Stats HeadlessAudioDriver::stats() const {
+  double ms_per_tick = 1000.0 / double(Clock::host_tick_frequency());
+  Stats stats;
+  stats.frames_submitted = frames_submitted_;
+  stats.frames_played = frames_played_;
+  stats.underruns = underruns_;
+  stats.overruns = overruns_;
+  stats.average_latency_ms =
+      stats.frames_played
+          ? latency_ticks_total_ * ms_per_tick / stats.frames_played
+          : 0.0;
+  stats.max_latency_ms = latency_ticks_max_ * ms_per_tick;
+  return stats;
+}
+
+}  // namespace headless
+}  // namespace apu
+}  // namespace xe
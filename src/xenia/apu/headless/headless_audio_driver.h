@@ -0,0 +1,96 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_HEADLESS_HEADLESS_AUDIO_DRIVER_H_
+#define XENIA_APU_HEADLESS_HEADLESS_AUDIO_DRIVER_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+
+#include "xenia/apu/audio_driver.h"
+#include "xenia/base/threading.h"
+
+namespace xe {
+namespace apu {
+namespace headless {
+
+// Plays guest frames against the host clock without any sound hardware.
+// SubmitFrame converts each frame into a single-producer/single-consumer ring
+// that an output thread drains at 48kHz, handing the samples to a sink and
+// releasing the client semaphore just as a real device would on buffer end.
+class HeadlessAudioDriver : public AudioDriver {
+ public:
+  static const uint32_t kFrameChannels = 6;
+  static const uint32_t kChannelSamples = 256;
+  static const uint32_t kSampleRate = 48000;
+  static const uint32_t kQueuedFrames = 64;
+
+  // Receives every played frame as interleaved host-endian floats on the
+  // output thread. Underruns deliver a frame of silence.
+  typedef std::function<void(const float* samples, uint32_t sample_count,
+                             uint32_t channel_count)>
+      SampleSink;
+
+  struct Stats {
+    uint64_t frames_submitted;
+    uint64_t frames_played;
+    uint64_t underruns;
+    uint64_t overruns;
+    double average_latency_ms;
+    double max_latency_ms;
+  };
+
+  HeadlessAudioDriver(Memory* memory, xe::threading::Semaphore* semaphore,
+                      uint32_t channel_count, SampleSink sink);
+  ~HeadlessAudioDriver() override;
+
+  bool Initialize();
+  void SubmitFrame(uint32_t frame_ptr) override;
+  void Shutdown();
+
+  uint32_t channel_count() const { return channel_count_; }
+  Stats stats() const;
+
+ private:
+  struct Frame {
+    uint64_t submit_ticks;
+    float samples[kFrameChannels * kChannelSamples];
+  };
+
+  void OutputThreadMain();
+
+  xe::threading::Semaphore* semaphore_ = nullptr;
+  uint32_t channel_count_ = 2;
+  SampleSink sink_;
+
+  // Indices increase monotonically; the slot is index % kQueuedFrames.
+  // Only SubmitFrame advances write_index_ and only the output thread
+  // advances read_index_.
+  std::unique_ptr<Frame[]> frames_;
+  std::atomic<uint32_t> write_index_ = {0};
+  std::atomic<uint32_t> read_index_ = {0};
+
+  std::atomic<bool> running_ = {false};
+  std::thread output_thread_;
+
+  std::atomic<uint64_t> frames_submitted_ = {0};
+  std::atomic<uint64_t> frames_played_ = {0};
+  std::atomic<uint64_t> underruns_ = {0};
+  std::atomic<uint64_t> overruns_ = {0};
+  std::atomic<uint64_t> latency_ticks_total_ = {0};
+  std::atomic<uint64_t> latency_ticks_max_ = {0};
+};
+
+}  // namespace headless
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_HEADLESS_HEADLESS_AUDIO_DRIVER_H_
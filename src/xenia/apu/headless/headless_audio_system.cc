@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/headless/headless_audio_system.h"
+
+#include "xenia/apu/apu_flags.h"
+#include "xenia/apu/headless/headless_apu_flags.h"
+#include "xenia/apu/headless/wav_file_writer.h"
+#include "xenia/base/string.h"
+
+namespace xe {
+namespace apu {
+namespace headless {
+
+std::unique_ptr<AudioSystem> HeadlessAudioSystem::Create(
+    cpu::Processor* processor) {
+  return std::make_unique<HeadlessAudioSystem>(processor);
+}
+
+HeadlessAudioSystem::HeadlessAudioSystem(cpu::Processor* processor)
+    : AudioSystem(processor) {}
+
+HeadlessAudioSystem::~HeadlessAudioSystem() = default;
+
+HeadlessAudioDriver::SampleSink HeadlessAudioSystem::CreateWavSink(
+    size_t index, uint32_t channel_count) {
+  if (FLAGS_headless_audio_wav.empty()) {
+    return nullptr;
+  }
+  auto path = xe::to_wstring(FLAGS_headless_audio_wav);
+  if (index) {
+    // capture.wav -> capture.1.wav
+    auto extension = path.rfind(L".wav");
+    auto suffix = L"." + std::to_wstring(index);
+    if (extension != std::wstring::npos) {
+      path.insert(extension, suffix);
+    } else {
+      path += suffix + L".wav";
+    }
+  }
+  auto writer = std::make_shared<WavFileWriter>();
+  if (!writer->Open(path, channel_count, HeadlessAudioDriver::kSampleRate)) {
+    return nullptr;
+  }
+  return [writer](const float* samples, uint32_t sample_count,
+                  uint32_t channel_count) {
+    writer->Write(samples, sample_count);
+  };
+}
+
+X_STATUS HeadlessAudioSystem::CreateDriver(size_t index,
+                                           xe::threading::Semaphore* semaphore,
+                                           AudioDriver** out_driver) {
+  assert_not_null(out_driver);
+  uint32_t channel_count = uint32_t(FLAGS_headless_audio_channels);
+  auto sink = sink_factory_ ? sink_factory_(index, channel_count)
+                            : CreateWavSink(index, channel_count);
+  auto driver =
+      new HeadlessAudioDriver(memory_, semaphore, channel_count, sink);
+  if (!driver->Initialize()) {
+    driver->Shutdown();
+    delete driver;
+    return X_STATUS_UNSUCCESSFUL;
+  }
+
+  *out_driver = driver;
+  return X_STATUS_SUCCESS;
+}
+
+void HeadlessAudioSystem::DestroyDriver(AudioDriver* driver) {
+  assert_not_null(driver);
+  auto headless_driver = static_cast<HeadlessAudioDriver*>(driver);
+  headless_driver->Shutdown();
+  delete headless_driver;
+}
+
+}  // namespace headless
+}  // namespace apu
+}  // namespace xe
@@ -0,0 +1,53 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_HEADLESS_HEADLESS_AUDIO_SYSTEM_H_
+#define XENIA_APU_HEADLESS_HEADLESS_AUDIO_SYSTEM_H_
+
+#include "xenia/apu/audio_system.h"
+#include "xenia/apu/headless/headless_audio_driver.h"
+
+namespace xe {
+namespace apu {
+namespace headless {
+
+class HeadlessAudioSystem : public AudioSystem {
+ public:
+  // Creates the sink for the client at the given index.
+  typedef std::function<HeadlessAudioDriver::SampleSink(size_t index,
+                                                        uint32_t channel_count)>
+      SinkFactory;
+
+  explicit HeadlessAudioSystem(cpu::Processor* processor);
+  ~HeadlessAudioSystem() override;
+
+  static std::unique_ptr<AudioSystem> Create(cpu::Processor* processor);
+
+  // Overrides the default sink (--headless_audio_wav or none) for clients
+  // registered afterwards.
+  void set_sink_factory(SinkFactory sink_factory) {
+    sink_factory_ = std::move(sink_factory);
+  }
+
+  X_STATUS CreateDriver(size_t index, xe::threading::Semaphore* semaphore,
+                        AudioDriver** out_driver) override;
+  void DestroyDriver(AudioDriver* driver) override;
+
+ private:
+  HeadlessAudioDriver::SampleSink CreateWavSink(size_t index,
+                                                uint32_t channel_count);
+
+  SinkFactory sink_factory_;
+};
+
+}  // namespace headless
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_HEADLESS_HEADLESS_AUDIO_SYSTEM_H_
@@ -0,0 +1,18 @@
+project_root = "../../../.."
+include(project_root.."/tools/build")
+
+group("src")
+project("xenia-apu-headless")
+  uuid("3c5b2d1e-8f4a-4e2b-9c6d-7a1f0e9b5d42")
+  kind("StaticLib")
+  language("C++")
+  links({
+    "xenia-base",
+    "xenia-apu",
+  })
+  defines({
+  })
+  includedirs({
+    project_root.."/third_party/gflags/src",
+  })
+  local_platform_files()
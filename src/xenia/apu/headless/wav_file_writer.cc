@@ -0,0 +1,112 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/apu/headless/wav_file_writer.h"
+
+#include <algorithm>
+
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+
+namespace xe {
+namespace apu {
+namespace headless {
+
+#pragma pack(push, 1)
+struct WavHeader {
+  uint32_t riff_id;
+  uint32_t riff_size;
+  uint32_t wave_id;
+  uint32_t fmt_id;
+  uint32_t fmt_size;
+  uint16_t format_tag;
+  uint16_t channel_count;
+  uint32_t sample_rate;
+  uint32_t byte_rate;
+  uint16_t block_align;
+  uint16_t bits_per_sample;
+  uint16_t extension_size;
+  uint32_t fact_id;
+  uint32_t fact_size;
+  uint32_t sample_length;
+  uint32_t data_id;
+  uint32_t data_size;
+};
+#pragma pack(pop)
+static_assert(sizeof(WavHeader) == 58, "WAV header must be packed");
+
+const uint16_t kWaveFormatIeeeFloat = 3;
+
+WavFileWriter::~WavFileWriter() { Close(); }
+
+bool WavFileWriter::Open(const std::wstring& path, uint32_t channel_count,
+                         uint32_t sample_rate) {
+  Close();
+  file_ = xe::filesystem::OpenFile(path, "wb");
+  if (!file_) {
+    XELOGE("Unable to open %S for audio capture", path.c_str());
+    return false;
+  }
+  channel_count_ = channel_count;
+  sample_rate_ = sample_rate;
+  data_size_ = 0;
+  WriteHeader();
+  return true;
+}
+
+void WavFileWriter::Write(const float* samples, uint32_t sample_count) {
+  if (!file_) {
+    return;
+  }
+  size_t written =
+      std::fwrite(samples, sizeof(float) * channel_count_, sample_count, file_);
+  data_size_ += written * sizeof(float) * channel_count_;
+}
+
+void WavFileWriter::Close() {
+  if (!file_) {
+    return;
+  }
+  // Rewrite the header now that the sizes are known.
+  std::fseek(file_, 0, SEEK_SET);
+  WriteHeader();
+  std::fclose(file_);
+  file_ = nullptr;
+}
+
+void WavFileWriter::WriteHeader() {
+  // RIFF sizes are 32-bit; very long captures are clamped.
+  uint32_t data_size = uint32_t(
+      std::min<uint64_t>(data_size_, 0xFFFFFFFFu - sizeof(WavHeader)));
+  uint32_t block_align = sizeof(float) * channel_count_;
+
+  WavHeader header;
+  header.riff_id = 'FFIR';
+  header.riff_size = sizeof(WavHeader) - 8 + data_size;
+  header.wave_id = 'EVAW';
+  header.fmt_id = ' tmf';
+  header.fmt_size = 18;
+  header.format_tag = kWaveFormatIeeeFloat;
+  header.channel_count = uint16_t(channel_count_);
+  header.sample_rate = sample_rate_;
+  header.byte_rate = sample_rate_ * block_align;
+  header.block_align = uint16_t(block_align);
+  header.bits_per_sample = 32;
+  header.extension_size = 0;
+  header.fact_id = 'tcaf';
+  header.fact_size = 4;
+  header.sample_length = block_align ? data_size / block_align : 0;
+  header.data_id = 'atad';
+  header.data_size = data_size;
+  std::fwrite(&header, sizeof(header), 1, file_);
+}
+
+}  // namespace headless
+}  // namespace apu
+}  // namespace xe
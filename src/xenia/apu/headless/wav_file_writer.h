@@ -0,0 +1,49 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_APU_HEADLESS_WAV_FILE_WRITER_H_
+#define XENIA_APU_HEADLESS_WAV_FILE_WRITER_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace xe {
+namespace apu {
+namespace headless {
+
+// Writes interleaved 32-bit float samples to a RIFF WAVE file. The chunk
+// sizes are patched in when the file is closed.
+class WavFileWriter {
+ public:
+  WavFileWriter() = default;
+  ~WavFileWriter();
+
+  bool Open(const std::wstring& path, uint32_t channel_count,
+            uint32_t sample_rate);
+  void Write(const float* samples, uint32_t sample_count);
+  void Close();
+
+  bool is_open() const { return file_ != nullptr; }
+  uint64_t data_size() const { return data_size_; }
+
+ private:
+  void WriteHeader();
+
+  FILE* file_ = nullptr;
+  uint32_t channel_count_ = 0;
+  uint32_t sample_rate_ = 0;
+  uint64_t data_size_ = 0;
+};
+
+}  // namespace headless
+}  // namespace apu
+}  // namespace xe
+
+#endif  // XENIA_APU_HEADLESS_WAV_FILE_WRITER_H_
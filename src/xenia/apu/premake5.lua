@@ -18,3 +18,5 @@ project("xenia-apu")
     project_root.."/third_party/libav/",
   })
   local_platform_files()
+
+include("testing")
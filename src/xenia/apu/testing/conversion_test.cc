@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "xenia/apu/conversion.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace apu {
+namespace test {
+
+// Random samples, including out-of-range values and NaN to exercise clamping.
+std::vector<float> MakeSamples(size_t count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> dist(-1.25f, 1.25f);
+  std::vector<float> samples(count);
+  for (auto& sample : samples) {
+    sample = dist(rng);
+  }
+  if (count > 3) {
+    samples[0] = 1.0f;
+    samples[1] = -1.0f;
+    samples[2] = 0.0f;
+    samples[3] = std::numeric_limits<float>::quiet_NaN();
+  }
+  return samples;
+}
+
+TEST_CASE("planar_float_to_s16be_mono", "Conversion") {
+  for (size_t count : {0, 1, 7, 8, 9, 511, 512}) {
+    auto input = MakeSamples(count, uint32_t(count));
+    const float* channels[] = {input.data()};
+    std::vector<uint16_t> expected(count), actual(count);
+    conversion::planar_float_to_s16be_scalar(channels, 1, 0, count,
+                                             expected.data());
+    conversion::planar_float_to_s16be(channels, 1, 0, count, actual.data());
+    REQUIRE(expected == actual);
+  }
+}
+
+TEST_CASE("planar_float_to_s16be_stereo", "Conversion") {
+  for (size_t count : {0, 1, 7, 8, 9, 511, 512}) {
+    auto left = MakeSamples(count, uint32_t(count));
+    auto right = MakeSamples(count, uint32_t(count) + 1000);
+    const float* channels[] = {left.data(), right.data()};
+    std::vector<uint16_t> expected(count * 2), actual(count * 2);
+    conversion::planar_float_to_s16be_scalar(channels, 2, 0, count,
+                                             expected.data());
+    conversion::planar_float_to_s16be(channels, 2, 0, count, actual.data());
+    REQUIRE(expected == actual);
+  }
+}
+
+TEST_CASE("planar_float_to_s16be_offset", "Conversion") {
+  // Conversions split at a ring buffer wrap must match a single conversion.
+  auto left = MakeSamples(512, 1);
+  auto right = MakeSamples(512, 2);
+  const float* channels[] = {left.data(), right.data()};
+  std::vector<uint16_t> expected(1024), actual(1024);
+  conversion::planar_float_to_s16be_scalar(channels, 2, 0, 512,
+                                           expected.data());
+  conversion::planar_float_to_s16be(channels, 2, 0, 100, actual.data());
+  conversion::planar_float_to_s16be(channels, 2, 100, 412,
+                                    actual.data() + 200);
+  REQUIRE(expected == actual);
+}
+
+// Not run by default; use `xenia-apu-tests [benchmark]`.
+TEST_CASE("planar_float_to_s16be_benchmark", "[.][benchmark]") {
+  const size_t kFrameSamples = 512;
+  const int kFrameCount = 100000;
+  auto left = MakeSamples(kFrameSamples, 1);
+  auto right = MakeSamples(kFrameSamples, 2);
+  const float* channels[] = {left.data(), right.data()};
+  std::vector<uint16_t> output(kFrameSamples * 2);
+
+  for (int channel_count = 1; channel_count <= 2; ++channel_count) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kFrameCount; ++i) {
+      conversion::planar_float_to_s16be_scalar(channels, channel_count, 0,
+                                               kFrameSamples, output.data());
+    }
+    auto scalar_time = std::chrono::duration<double, std::nano>(
+                           std::chrono::high_resolution_clock::now() - start)
+                           .count();
+
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < kFrameCount; ++i) {
+      conversion::planar_float_to_s16be(channels, channel_count, 0,
+                                        kFrameSamples, output.data());
+    }
+    auto vector_time = std::chrono::duration<double, std::nano>(
+                           std::chrono::high_resolution_clock::now() - start)
+                           .count();
+
+    std::printf("%d channel(s): scalar %.1f ns/frame, vector %.1f ns/frame "
+                "(%.1fx)\n",
+                channel_count, scalar_time / kFrameCount,
+                vector_time / kFrameCount, scalar_time / vector_time);
+  }
+}
+
+}  // namespace test
+}  // namespace apu
+}  // namespace xe
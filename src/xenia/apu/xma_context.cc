@@ -12,6 +12,7 @@
 #include <algorithm>
 #include <cstring>
 
+#include "xenia/apu/conversion.h"
 #include "xenia/apu/xma_decoder.h"
 #include "xenia/apu/xma_helpers.h"
 #include "xenia/base/bit_stream.h"
@@ -45,9 +46,6 @@ XmaContext::~XmaContext() {
   if (decoded_frame_) {
     av_frame_free(&decoded_frame_);
   }
-  if (current_frame_) {
-    delete[] current_frame_;
-  }
 }
 
 int XmaContext::Setup(uint32_t id, Memory* memory, uint32_t guest_ptr) {
@@ -90,10 +88,6 @@ int XmaContext::Setup(uint32_t id, Memory* memory, uint32_t guest_ptr) {
 
   partial_frame_buffer_.resize(2048);
 
-  // Current frame stuff whatever
-  // samples per frame * 2 max channels * output bytes
-  current_frame_ = new uint8_t[kSamplesPerFrame * kBytesPerSample * 2];
-
   // FYI: We're purposely not opening the context here. That is done later.
   return 0;
 }
@@ -583,12 +577,10 @@ void XmaContext::DecodePackets(XMA_CONTEXT_DATA* data) {
                                         context_->sample_fmt, 1) ==
              context_->channels * decoded_frame_->nb_samples * sizeof(float));
 
-      // Convert the frame.
-      ConvertFrame((const uint8_t**)decoded_frame_->data, context_->channels,
-                   decoded_frame_->nb_samples, current_frame_);
-
+      // Convert the frame straight into the output buffer.
       assert_true(output_remaining_bytes >= kBytesPerFrame * num_channels);
-      output_rb.Write(current_frame_, kBytesPerFrame * num_channels);
+      ConvertFrame((const uint8_t**)decoded_frame_->data, context_->channels,
+                   decoded_frame_->nb_samples, &output_rb);
       written_bytes = kBytesPerFrame * num_channels;
 
       output_remaining_bytes -= written_bytes;
@@ -647,30 +639,34 @@ int XmaContext::PrepareDecoder(uint8_t* block, size_t size, int sample_rate,
   return 0;
 }
 
-bool XmaContext::ConvertFrame(const uint8_t** samples, int num_channels,
-                              int num_samples, uint8_t* output_buffer) {
-  // Loop through every sample, convert and drop it into the output array.
-  // If more than one channel, we need to interleave the samples from each
-  // channel next to each other.
-  // TODO: This can definitely be optimized with AVX/SSE intrinsics!
-  uint32_t o = 0;
-  for (int i = 0; i < num_samples; i++) {
-    for (int j = 0; j < num_channels; j++) {
-      // Select the appropriate array based on the current channel.
-      auto sample_array = reinterpret_cast<const float*>(samples[j]);
-
-      // Raw sample should be within [-1, 1].
-      // Clamp it, just in case.
-      float raw_sample = xe::saturate(sample_array[i]);
-
-      // Convert the sample and output it in big endian.
-      float scaled_sample = raw_sample * ((1 << 15) - 1);
-      int sample = static_cast<int>(scaled_sample);
-      xe::store_and_swap<uint16_t>(&output_buffer[o++ * 2], sample & 0xFFFF);
-    }
+void XmaContext::ConvertFrame(const uint8_t** samples, int num_channels,
+                              int num_samples, RingBuffer* output_rb) {
+  auto channels = reinterpret_cast<const float* const*>(samples);
+  size_t sample_bytes = num_channels * kBytesPerSample;
+
+  // The output buffer is a whole number of 256b blocks, so it only ever
+  // wraps between samples.
+  size_t offset = 0;
+  while (offset < size_t(num_samples)) {
+    size_t contiguous_samples =
+        (output_rb->capacity() - output_rb->write_offset()) / sample_bytes;
+    size_t count = std::min(num_samples - offset, contiguous_samples);
+    conversion::planar_float_to_s16be(
+        channels, num_channels, offset, count,
+        reinterpret_cast<uint16_t*>(output_rb->write_ptr()));
+    output_rb->AdvanceWrite(count * sample_bytes);
+    offset += count;
   }
 
-  return true;
+  // Always emit a whole frame; pad short frames with silence.
+  size_t pad_bytes = (kSamplesPerFrame - num_samples) * sample_bytes;
+  while (pad_bytes) {
+    size_t count =
+        std::min(pad_bytes, output_rb->capacity() - output_rb->write_offset());
+    std::memset(reinterpret_cast<void*>(output_rb->write_ptr()), 0, count);
+    output_rb->AdvanceWrite(count);
+    pad_bytes -= count;
+  }
 }
 
 }  // namespace apu
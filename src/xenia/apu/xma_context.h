@@ -29,6 +29,9 @@
 // https://github.com/hrydgard/minidx9/blob/master/Include/xma2defs.h
 
 // Forward declarations
+namespace xe {
+class RingBuffer;
+}  // namespace xe
 struct AVCodec;
 struct AVCodecContext;
 struct AVFrame;
@@ -179,8 +182,10 @@ class XmaContext {
   int PrepareDecoder(uint8_t* block, size_t size, int sample_rate,
                      int channels);
 
-  bool ConvertFrame(const uint8_t** samples, int num_channels, int num_samples,
-                    uint8_t* output_buffer);
+  // Writes one frame of interleaved big-endian s16 samples at the ring's
+  // write offset, wrapping as needed.
+  void ConvertFrame(const uint8_t** samples, int num_channels, int num_samples,
+                    RingBuffer* output_rb);
 
   int StartPacket(XMA_CONTEXT_DATA* data);
 
@@ -212,8 +217,6 @@ class XmaContext {
   size_t partial_frame_start_offset_bits_ = 0;
   size_t partial_frame_offset_bits_ = 0;  // blah internal don't use this
   std::vector<uint8_t> partial_frame_buffer_;
-
-  uint8_t* current_frame_ = nullptr;
 };
 
 }  // namespace apu
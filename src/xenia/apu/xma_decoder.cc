@@ -11,11 +11,15 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
+
+#include "xenia/apu/apu_flags.h"
 #include "xenia/apu/xma_context.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/ring_buffer.h"
+#include "xenia/base/string.h"
 #include "xenia/base/string_buffer.h"
 #include "xenia/cpu/processor.h"
 #include "xenia/cpu/thread_state.h"
@@ -122,68 +126,78 @@ X_STATUS XmaDecoder::Setup(kernel::KernelState* kernel_state) {
   }
   registers_.next_context = 1;
   context_bitmap_.Resize(kContextCount);
+  context_queued_.resize(kContextCount, false);
 
+  // A context only decodes after being kicked (Work() is a no-op unless it is
+  // enabled), so workers only need to look at the contexts kicked since.
   worker_running_ = true;
-  work_event_ = xe::threading::Event::CreateAutoResetEvent(false);
-  worker_thread_ = kernel::object_ref<kernel::XHostThread>(
-      new kernel::XHostThread(kernel_state, 128 * 1024, 0, [this]() {
-        WorkerThreadMain();
-        return 0;
-      }));
-  worker_thread_->set_name("XMA Decoder Worker");
-  worker_thread_->set_can_debugger_suspend(true);
-  worker_thread_->Create();
+  int worker_count = std::max(FLAGS_xma_decoder_threads, 1);
+  for (int i = 0; i < worker_count; ++i) {
+    auto worker_thread = kernel::object_ref<kernel::XHostThread>(
+        new kernel::XHostThread(kernel_state, 128 * 1024, 0, [this]() {
+          WorkerThreadMain();
+          return 0;
+        }));
+    worker_thread->set_name(
+        xe::format_string("XMA Decoder Worker %d", i));
+    worker_thread->set_can_debugger_suspend(true);
+    worker_thread->Create();
+    worker_threads_.push_back(std::move(worker_thread));
+  }
 
   return X_STATUS_SUCCESS;
 }
 
 void XmaDecoder::WorkerThreadMain() {
-  uint32_t idle_loop_count = 0;
-  while (worker_running_) {
-    // Okay, let's loop through XMA contexts to find ones we need to decode!
-    bool did_work = false;
-    for (uint32_t n = 0; n < kContextCount; n++) {
-      XmaContext& context = contexts_[n];
-      did_work = context.Work() || did_work;
-
-      // TODO: Need thread safety to do this.
-      // Probably not too important though.
-      // registers_.current_context = n;
-      // registers_.next_context = (n + 1) % kContextCount;
-    }
-
-    if (paused_) {
-      pause_fence_.Signal();
-      resume_fence_.Wait();
-    }
-
-    if (!did_work) {
-      idle_loop_count++;
-    } else {
-      idle_loop_count = 0;
+  std::unique_lock<std::mutex> lock(work_mutex_);
+  while (true) {
+    work_cond_.wait(lock, [this]() {
+      return !worker_running_ || (!paused_ && !ready_contexts_.empty());
+    });
+    if (!worker_running_) {
+      break;
     }
-
-    if (idle_loop_count > 500) {
-      // Idle for an extended period. Introduce a 20ms wait.
-      xe::threading::Wait(work_event_.get(), false,
-                          std::chrono::milliseconds(20));
+    uint32_t context_id = ready_contexts_.front();
+    ready_contexts_.pop();
+    // Cleared before decoding so a kick that lands mid-decode queues it
+    // again; the context lock keeps two workers from decoding it at once.
+    context_queued_[context_id] = false;
+    ++busy_worker_count_;
+    lock.unlock();
+
+    contexts_[context_id].Work();
+
+    lock.lock();
+    --busy_worker_count_;
+    if (paused_ && !busy_worker_count_) {
+      work_cond_.notify_all();
     }
+  }
+}
 
-    xe::threading::MaybeYield();
+void XmaDecoder::ScheduleContext(uint32_t context_id) {
+  std::lock_guard<std::mutex> lock(work_mutex_);
+  if (context_queued_[context_id]) {
+    return;
   }
+  context_queued_[context_id] = true;
+  ready_contexts_.push(context_id);
+  work_cond_.notify_one();
 }
 
 void XmaDecoder::Shutdown() {
-  worker_running_ = false;
-  work_event_->Set();
-
-  if (paused_) {
-    Resume();
+  {
+    std::lock_guard<std::mutex> lock(work_mutex_);
+    worker_running_ = false;
+    paused_ = false;
+    work_cond_.notify_all();
   }
 
-  // Wait for work thread.
-  xe::threading::Wait(worker_thread_->thread(), false);
-  worker_thread_.reset();
+  // Wait for work threads.
+  for (auto& worker_thread : worker_threads_) {
+    xe::threading::Wait(worker_thread->thread(), false);
+  }
+  worker_threads_.clear();
 
   memory()->SystemHeapFree(registers_.context_array_ptr);
 }
@@ -279,11 +293,9 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
         uint32_t context_id = base_context_id + i;
         XmaContext& context = contexts_[context_id];
         context.Enable();
+        ScheduleContext(context_id);
       }
     }
-
-    // Signal the decoder thread to start processing.
-    work_event_->Set();
   } else if (r >= 0x1A40 && r <= 0x1A40 + 9 * 4) {
     // Context lock command.
     // This requests a lock by flagging the context.
@@ -296,9 +308,6 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
         context.Disable();
       }
     }
-
-    // Signal the decoder thread to start processing.
-    work_event_->Set();
   } else if (r >= 0x1A80 && r <= 0x1A80 + 9 * 4) {
     // Context clear command.
     // This will reset the given hardware contexts.
@@ -314,21 +323,24 @@ void XmaDecoder::WriteRegister(uint32_t addr, uint32_t value) {
 }
 
 void XmaDecoder::Pause() {
+  std::unique_lock<std::mutex> lock(work_mutex_);
   if (paused_) {
     return;
   }
   paused_ = true;
 
-  pause_fence_.Wait();
+  // Wait for in-flight decodes; idle workers won't pick up anything new.
+  work_cond_.wait(lock, [this]() { return !busy_worker_count_; });
 }
 
 void XmaDecoder::Resume() {
+  std::lock_guard<std::mutex> lock(work_mutex_);
   if (!paused_) {
     return;
   }
   paused_ = false;
 
-  resume_fence_.Signal();
+  work_cond_.notify_all();
 }
 
 }  // namespace apu
@@ -11,8 +11,10 @@
 #define XENIA_APU_XMA_DECODER_H_
 
 #include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <queue>
+#include <vector>
 
 #include "xenia/apu/xma_context.h"
 #include "xenia/base/bit_map.h"
@@ -53,6 +55,8 @@ class XmaDecoder {
 
  private:
   void WorkerThreadMain();
+  // Queues a kicked context for the next free worker.
+  void ScheduleContext(uint32_t context_id);
 
   static uint32_t MMIOReadRegisterThunk(void* ppc_context, XmaDecoder* as,
                                         uint32_t addr) {
@@ -68,12 +72,17 @@ class XmaDecoder {
   cpu::Processor* processor_ = nullptr;
 
   std::atomic<bool> worker_running_ = {false};
-  kernel::object_ref<kernel::XHostThread> worker_thread_;
-  std::unique_ptr<xe::threading::Event> work_event_ = nullptr;
+  std::vector<kernel::object_ref<kernel::XHostThread>> worker_threads_;
+
+  // Contexts kicked but not yet picked up by a worker. Guarded by
+  // work_mutex_, as are paused_ and busy_worker_count_.
+  std::mutex work_mutex_;
+  std::condition_variable work_cond_;
+  std::queue<uint32_t> ready_contexts_;
+  std::vector<bool> context_queued_;
+  uint32_t busy_worker_count_ = 0;
 
   bool paused_ = false;
-  xe::threading::Fence pause_fence_;   // Signaled when worker paused.
-  xe::threading::Fence resume_fence_;  // Signaled when resume requested.
 
   // Stored little endian, accessed through 0x7FEA....
   union {
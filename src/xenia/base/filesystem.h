@@ -91,6 +91,9 @@ class FileHandle {
   // Set length of the file in bytes.
   virtual bool SetLength(size_t length) = 0;
 
+  // Queries the current length of the file in bytes.
+  virtual bool GetLength(size_t* out_length) = 0;
+
   // Flushes any pending write buffers to the underlying filesystem.
   virtual void Flush() = 0;
 
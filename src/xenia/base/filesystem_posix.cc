@@ -18,6 +18,8 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include <cstring>
+
 namespace xe {
 namespace filesystem {
 
@@ -76,7 +78,7 @@ bool CreateFile(const std::wstring& path) {
 }
 
 bool DeleteFile(const std::wstring& path) {
-  return (xe::to_string(path).c_str()) == 0 ? true : false;
+  return unlink(xe::to_string(path).c_str()) == 0 ? true : false;
 }
 
 class PosixFileHandle : public FileHandle {
@@ -102,6 +104,14 @@ class PosixFileHandle : public FileHandle {
   bool SetLength(size_t length) override {
     return ftruncate(handle_, length) >= 0 ? true : false;
   }
+  bool GetLength(size_t* out_length) override {
+    struct stat st;
+    if (fstat(handle_, &st) < 0) {
+      return false;
+    }
+    *out_length = size_t(st.st_size);
+    return true;
+  }
   void Flush() override { fsync(handle_); }
 
  private:
@@ -110,7 +120,7 @@ class PosixFileHandle : public FileHandle {
 
 std::unique_ptr<FileHandle> FileHandle::OpenExisting(std::wstring path,
                                                      uint32_t desired_access) {
-  int open_access;
+  int open_access = 0;
   if (desired_access & FileAccess::kGenericRead) {
     open_access |= O_RDONLY;
   }
@@ -148,6 +158,8 @@ bool GetInfo(const std::wstring& path, FileInfo* out_info) {
     } else {
       out_info->type = FileInfo::Type::kFile;
     }
+    out_info->name = xe::find_name_from_path(path);
+    out_info->total_size = S_ISDIR(st.st_mode) ? 0 : st.st_size;
     out_info->create_timestamp = convertUnixtimeToWinFiletime(st.st_ctime);
     out_info->access_timestamp = convertUnixtimeToWinFiletime(st.st_atime);
     out_info->write_timestamp = convertUnixtimeToWinFiletime(st.st_mtime);
@@ -165,11 +177,17 @@ std::vector<FileInfo> ListFiles(const std::wstring& path) {
   }
 
   while (auto ent = readdir(dir)) {
+    if (std::strcmp(ent->d_name, ".") == 0 ||
+        std::strcmp(ent->d_name, "..") == 0) {
+      continue;
+    }
     FileInfo info;
 
     info.name = xe::to_wstring(ent->d_name);
     struct stat st;
-    stat((xe::to_string(path) + xe::to_string(info.name)).c_str(), &st);
+    if (stat(xe::to_string(xe::join_paths(path, info.name)).c_str(), &st)) {
+      continue;
+    }
     info.create_timestamp = convertUnixtimeToWinFiletime(st.st_ctime);
     info.access_timestamp = convertUnixtimeToWinFiletime(st.st_atime);
     info.write_timestamp = convertUnixtimeToWinFiletime(st.st_mtime);
@@ -182,6 +200,7 @@ std::vector<FileInfo> ListFiles(const std::wstring& path) {
     }
     result.push_back(info);
   }
+  closedir(dir);
 
   return result;
 }
@@ -126,6 +126,14 @@ class Win32FileHandle : public FileHandle {
     }
     return true;
   }
+  bool GetLength(size_t* out_length) override {
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(handle_, &size)) {
+      return false;
+    }
+    *out_length = size_t(size.QuadPart);
+    return true;
+  }
   void Flush() override { FlushFileBuffers(handle_); }
 
  private:
@@ -47,6 +47,11 @@ class MappedMemory {
   // Changes the offset inside the file. This will update data() and size()!
   virtual bool Remap(size_t offset, size_t length) { return false; }
 
+  // Hints that [offset, offset + length) will be read soon, so the OS can
+  // page it in with large reads up front instead of faulting it in a page at
+  // a time during the copy.
+  void Prefetch(size_t offset, size_t length);
+
  protected:
   std::wstring path_;
   Mode mode_;
@@ -9,10 +9,19 @@
 
 #include "xenia/base/mapped_memory.h"
 
+#include <fcntl.h>
 #include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
 #include <cstdio>
 #include <memory>
+#include <mutex>
+#include <vector>
 
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/base/memory.h"
 #include "xenia/base/string.h"
 
 namespace xe {
@@ -76,10 +85,173 @@ std::unique_ptr<MappedMemory> MappedMemory::Open(const std::wstring& path,
   return std::move(mm);
 }
 
+void MappedMemory::Prefetch(size_t offset, size_t length) {
+  if (!data_ || offset >= size_) {
+    return;
+  }
+  length = std::min(length, size_ - offset);
+  size_t page_size = xe::memory::page_size();
+  uintptr_t start = reinterpret_cast<uintptr_t>(data()) + offset;
+  uintptr_t aligned_start = start - (start % page_size);
+  madvise(reinterpret_cast<void*>(aligned_start),
+          start + length - aligned_start, MADV_WILLNEED);
+}
+
+class PosixChunkedMappedMemoryWriter : public ChunkedMappedMemoryWriter {
+ public:
+  PosixChunkedMappedMemoryWriter(const std::wstring& path, size_t chunk_size,
+                                 bool low_address_space)
+      : ChunkedMappedMemoryWriter(path, chunk_size, low_address_space) {}
+
+  ~PosixChunkedMappedMemoryWriter() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunks_.clear();
+  }
+
+  uint8_t* Allocate(size_t length) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!chunks_.empty()) {
+      uint8_t* result = chunks_.back()->Allocate(length);
+      if (result != nullptr) {
+        return result;
+      }
+    }
+    auto chunk = std::make_unique<Chunk>(chunk_size_);
+    auto chunk_path = path_ + L"." + std::to_wstring(chunks_.size());
+    if (!chunk->Open(chunk_path, low_address_space_)) {
+      return nullptr;
+    }
+    uint8_t* result = chunk->Allocate(length);
+    chunks_.push_back(std::move(chunk));
+    return result;
+  }
+
+  void Flush() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& chunk : chunks_) {
+      chunk->Flush();
+    }
+  }
+
+  void FlushNew() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& chunk : chunks_) {
+      chunk->FlushNew();
+    }
+  }
+
+ private:
+  class Chunk {
+   public:
+    explicit Chunk(size_t capacity)
+        : fd_(-1),
+          data_(nullptr),
+          offset_(0),
+          capacity_(capacity),
+          last_flush_offset_(0) {}
+
+    ~Chunk() {
+      if (data_) {
+        munmap(data_, capacity_);
+      }
+      if (fd_ != -1) {
+        // Drop the unused tail so readers only see written data.
+        if (ftruncate(fd_, offset_) != 0) {
+          XELOGW("Unable to truncate mapped chunk (%d)", errno);
+        }
+        close(fd_);
+      }
+    }
+
+    bool Open(const std::wstring& path, bool low_address_space) {
+      fd_ = open(xe::to_string(path).c_str(), O_RDWR | O_CREAT | O_TRUNC,
+                 0644);
+      if (fd_ == -1) {
+        XELOGE("Unable to create chunk file %S (%d)", path.c_str(), errno);
+        return false;
+      }
+
+      // Reserve the blocks up front: running out of space while writing
+      // through the mapping would be a SIGBUS instead of an error here.
+      // Not all filesystems support it, so fall back to a sparse file.
+      if (posix_fallocate(fd_, 0, capacity_) != 0 &&
+          ftruncate(fd_, capacity_) != 0) {
+        XELOGE("Unable to size chunk file %S (%d)", path.c_str(), errno);
+        return false;
+      }
+
+      // If specified, ensure the allocation occurs in the lower 32-bit address
+      // space (callers embed the addresses as disp32 in generated code).
+      int prot = PROT_READ | PROT_WRITE;
+      if (low_address_space) {
+        uint8_t* address = reinterpret_cast<uint8_t*>(0x10000000);
+        for (int i = 0; i < 1000 && !data_; ++i, address += capacity_) {
+          if (uintptr_t(address) + capacity_ > 0x80000000ull) {
+            break;
+          }
+          void* result = mmap(address, capacity_, prot, MAP_SHARED, fd_, 0);
+          if (result == MAP_FAILED) {
+            continue;
+          }
+          if (result != address) {
+            // Hint not honored; something else lives there.
+            munmap(result, capacity_);
+            continue;
+          }
+          data_ = address;
+        }
+        if (!data_) {
+          XELOGE("Unable to find space for mapping");
+          return false;
+        }
+      } else {
+        void* result = mmap(nullptr, capacity_, prot, MAP_SHARED, fd_, 0);
+        if (result == MAP_FAILED) {
+          return false;
+        }
+        data_ = reinterpret_cast<uint8_t*>(result);
+      }
+
+      return true;
+    }
+
+    uint8_t* Allocate(size_t length) {
+      if (capacity_ - offset_ < length) {
+        return nullptr;
+      }
+      uint8_t* result = data_ + offset_;
+      offset_ += length;
+      return result;
+    }
+
+    void Flush() { msync(data_, offset_, MS_SYNC); }
+
+    void FlushNew() {
+      // msync wants a page aligned start.
+      size_t page_size = xe::memory::page_size();
+      size_t start = last_flush_offset_ - last_flush_offset_ % page_size;
+      msync(data_ + start, offset_ - start, MS_ASYNC);
+      last_flush_offset_ = offset_;
+    }
+
+   private:
+    int fd_;
+    uint8_t* data_;
+    size_t offset_;
+    size_t capacity_;
+    size_t last_flush_offset_;
+  };
+
+  std::mutex mutex_;
+  std::vector<std::unique_ptr<Chunk>> chunks_;
+};
+
 std::unique_ptr<ChunkedMappedMemoryWriter> ChunkedMappedMemoryWriter::Open(
     const std::wstring& path, size_t chunk_size, bool low_address_space) {
-  // TODO(DrChat)
-  return nullptr;
+  size_t aligned_chunk_size =
+      xe::round_up(chunk_size, size_t(xe::memory::page_size()));
+  return std::make_unique<PosixChunkedMappedMemoryWriter>(
+      path, aligned_chunk_size, low_address_space);
 }
 
 }  // namespace xe
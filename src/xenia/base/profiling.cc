@@ -58,6 +58,8 @@ bool Profiler::is_enabled() { return true; }
 bool Profiler::is_visible() { return is_enabled() && MicroProfileIsDrawing(); }
 
 void Profiler::Initialize() {
+  ProfileTrace::Initialize();
+
   // Custom groups.
   MicroProfileSetEnableAllGroups(false);
   MicroProfileForceEnableGroup("apu", MicroProfileTokenTypeCpu);
@@ -96,6 +98,7 @@ void Profiler::Dump() {
 }
 
 void Profiler::Shutdown() {
+  ProfileTrace::Shutdown();
   drawer_.reset();
   window_ = nullptr;
   MicroProfileShutdown();
@@ -108,10 +111,14 @@ uint32_t Profiler::GetColor(const char* str) {
 }
 
 void Profiler::ThreadEnter(const char* name) {
+  ProfileTrace::ThreadEnter(name);
   MicroProfileOnThreadCreate(name);
 }
 
-void Profiler::ThreadExit() { MicroProfileOnThreadExit(); }
+void Profiler::ThreadExit() {
+  ProfileTrace::ThreadExit();
+  MicroProfileOnThreadExit();
+}
 
 bool Profiler::OnKeyDown(int key_code) {
   // http://msdn.microsoft.com/en-us/library/windows/desktop/dd375731(v=vs.85).aspx
@@ -246,18 +253,23 @@ void Profiler::Present() {
 #endif  // XE_OPTION_PROFILING_UI
 }
 
-void Profiler::Flip() { MicroProfileFlip(); }
+void Profiler::Flip() {
+  ProfileTrace::Flip();
+  MicroProfileFlip();
+}
 
 #else
 
 bool Profiler::is_enabled() { return false; }
 bool Profiler::is_visible() { return false; }
-void Profiler::Initialize() {}
+void Profiler::Initialize() { ProfileTrace::Initialize(); }
 void Profiler::Dump() {}
-void Profiler::Shutdown() {}
+void Profiler::Shutdown() { ProfileTrace::Shutdown(); }
 uint32_t Profiler::GetColor(const char* str) { return 0; }
-void Profiler::ThreadEnter(const char* name) {}
-void Profiler::ThreadExit() {}
+void Profiler::ThreadEnter(const char* name) {
+  ProfileTrace::ThreadEnter(name);
+}
+void Profiler::ThreadExit() { ProfileTrace::ThreadExit(); }
 bool Profiler::OnKeyDown(int key_code) { return false; }
 bool Profiler::OnKeyUp(int key_code) { return false; }
 void Profiler::OnMouseDown(bool left_button, bool right_button) {}
@@ -268,7 +280,7 @@ void Profiler::ToggleDisplay() {}
 void Profiler::TogglePause() {}
 void Profiler::set_window(ui::Window* window) {}
 void Profiler::Present() {}
-void Profiler::Flip() {}
+void Profiler::Flip() { ProfileTrace::Flip(); }
 
 #endif  // XE_OPTION_PROFILING
 
@@ -10,6 +10,8 @@
 #ifndef XENIA_BASE_PROFILING_H_
 #define XENIA_BASE_PROFILING_H_
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 
 #include "xenia/base/string.h"
@@ -36,6 +38,25 @@ class Window;
 
 namespace xe {
 
+#define XE_PROFILE_TRACE_CONCAT_(a, b) a##b
+#define XE_PROFILE_TRACE_CONCAT(a, b) XE_PROFILE_TRACE_CONCAT_(a, b)
+
+// Records a CPU scope into the trace file, if one is being captured.
+// Names must be string literals (or otherwise live forever).
+#define SCOPE_profile_trace(group_name, scope_name)                     \
+  xe::ProfileTraceScope XE_PROFILE_TRACE_CONCAT(xe_profile_trace_scope_, \
+                                                __LINE__)(                \
+      group_name, scope_name)
+
+// Records a counter change into the trace file, if one is being captured.
+#define COUNT_profile_trace(name, value, is_delta)                 \
+  do {                                                             \
+    if (xe::ProfileTrace::is_enabled()) {                          \
+      xe::ProfileTrace::Counter(name, static_cast<int64_t>(value), \
+                                is_delta);                         \
+    }                                                              \
+  } while (false)
+
 #if XE_OPTION_PROFILING
 
 // Defines a profiling scope for CPU tasks.
@@ -62,15 +83,17 @@ namespace xe {
 
 // Enters a CPU profiling scope, active for the duration of the containing
 // block. No previous definition required.
-#define SCOPE_profile_cpu_i(group_name, scope_name) \
-  MICROPROFILE_SCOPEI(group_name, scope_name,       \
-                      xe::Profiler::GetColor(scope_name))
+#define SCOPE_profile_cpu_i(group_name, scope_name)        \
+  MICROPROFILE_SCOPEI(group_name, scope_name,              \
+                      xe::Profiler::GetColor(scope_name)); \
+  SCOPE_profile_trace(group_name, scope_name)
 
 // Enters a CPU profiling scope by function name, active for the duration of
 // the containing block. No previous definition required.
-#define SCOPE_profile_cpu_f(group_name)         \
-  MICROPROFILE_SCOPEI(group_name, __FUNCTION__, \
-                      xe::Profiler::GetColor(__FUNCTION__))
+#define SCOPE_profile_cpu_f(group_name)                      \
+  MICROPROFILE_SCOPEI(group_name, __FUNCTION__,              \
+                      xe::Profiler::GetColor(__FUNCTION__)); \
+  SCOPE_profile_trace(group_name, __FUNCTION__)
 
 // Enters a previously defined GPU profiling scope, active for the duration
 // of the containing block.
@@ -89,13 +112,19 @@ namespace xe {
                          xe::Profiler::GetColor(__FUNCTION__))
 
 // Adds a number to a counter
-#define COUNT_profile_add(name, count) MICROPROFILE_COUNTER_ADD(name, count)
+#define COUNT_profile_add(name, count)   \
+  MICROPROFILE_COUNTER_ADD(name, count); \
+  COUNT_profile_trace(name, count, true)
 
 // Subtracts a number to a counter
-#define COUNT_profile_sub(name, count) MICROPROFILE_COUNTER_SUB(name, count)
+#define COUNT_profile_sub(name, count)   \
+  MICROPROFILE_COUNTER_SUB(name, count); \
+  COUNT_profile_trace(name, -static_cast<int64_t>(count), true)
 
 // Sets a counter's value
-#define COUNT_profile_set(name, count) MICROPROFILE_COUNTER_SET(name, count)
+#define COUNT_profile_set(name, count)   \
+  MICROPROFILE_COUNTER_SET(name, count); \
+  COUNT_profile_trace(name, count, false)
 
 // Tracks a CPU value counter.
 #define COUNT_profile_cpu(name, count) MICROPROFILE_META_CPU(name, count)
@@ -112,12 +141,10 @@ namespace xe {
 #define SCOPE_profile_cpu(name) \
   do {                          \
   } while (false)
-#define SCOPE_profile_cpu_f(name) \
-  do {                            \
-  } while (false)
+#define SCOPE_profile_cpu_f(group_name) \
+  SCOPE_profile_trace(group_name, __FUNCTION__)
 #define SCOPE_profile_cpu_i(group_name, scope_name) \
-  do {                                              \
-  } while (false)
+  SCOPE_profile_trace(group_name, scope_name)
 #define SCOPE_profile_gpu(name) \
   do {                          \
   } while (false)
@@ -127,15 +154,10 @@ namespace xe {
 #define SCOPE_profile_gpu_i(group_name, scope_name) \
   do {                                              \
   } while (false)
-#define COUNT_profile_add(name, count) \
-  do {                                 \
-  } while (false)
+#define COUNT_profile_add(name, count) COUNT_profile_trace(name, count, true)
 #define COUNT_profile_sub(name, count) \
-  do {                                 \
-  } while (false)
-#define COUNT_profile_set(name, count) \
-  do {                                 \
-  } while (false)
+  COUNT_profile_trace(name, -static_cast<int64_t>(count), true)
+#define COUNT_profile_set(name, count) COUNT_profile_trace(name, count, false)
 #define COUNT_profile_cpu(name, count) \
   do {                                 \
   } while (false)
@@ -150,6 +172,61 @@ namespace xe {
 
 #endif  // XE_OPTION_PROFILING
 
+// Streams profiling scopes, counters and thread names to a Chrome trace event
+// JSON file (chrome://tracing, ui.perfetto.dev) for offline analysis.
+// Unlike the microprofile UI this works on every platform and in headless
+// runs. Each thread appends to its own bounded ring buffer and a background
+// thread drains the rings into the file; events are dropped (and counted)
+// rather than blocking when a ring is full.
+// Enabled with --profile_trace, see profiling_trace.cc.
+class ProfileTrace {
+ public:
+  static bool is_enabled() {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Starts capturing if requested by flags. Called by Profiler::Initialize.
+  static void Initialize();
+  // Stops capturing and finishes the file. Called by Profiler::Shutdown.
+  static void Shutdown();
+
+  // Names the calling thread in the trace.
+  static void ThreadEnter(const char* name);
+  static void ThreadExit();
+  // Marks the end of a frame. Capture stops after --profile_trace_frames.
+  static void Flip();
+
+  // Timestamp in nanoseconds, for use with Scope.
+  static uint64_t Now();
+  // Records a completed scope that began at start (from Now()).
+  static void Scope(const char* group_name, const char* scope_name,
+                    uint64_t start);
+  // Records a counter update, either an absolute value or a delta.
+  static void Counter(const char* name, int64_t value, bool is_delta);
+
+ private:
+  static std::atomic<bool> enabled_;
+};
+
+// Records the lifetime of the object as a scope. See SCOPE_profile_trace.
+class ProfileTraceScope {
+ public:
+  ProfileTraceScope(const char* group_name, const char* scope_name)
+      : group_name_(group_name),
+        scope_name_(scope_name),
+        start_(ProfileTrace::is_enabled() ? ProfileTrace::Now() : 0) {}
+  ~ProfileTraceScope() {
+    if (start_) {
+      ProfileTrace::Scope(group_name_, scope_name_, start_);
+    }
+  }
+
+ private:
+  const char* group_name_;
+  const char* scope_name_;
+  uint64_t start_;
+};
+
 class Profiler {
  public:
   static bool is_enabled();
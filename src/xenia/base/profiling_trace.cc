@@ -0,0 +1,342 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <condition_variable>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/profiling.h"
+#include "xenia/base/threading.h"
+
+DEFINE_string(profile_trace, "",
+              "Write profiling scopes and counters to the given path as a "
+              "Chrome trace (chrome://tracing, ui.perfetto.dev).");
+DEFINE_int32(profile_trace_frames, 0,
+             "Stop --profile_trace capture after this many frames; 0 captures "
+             "until exit.");
+DEFINE_int32(profile_trace_buffer_events, 16 * 1024,
+             "Events buffered per thread for --profile_trace before new ones "
+             "are dropped.");
+
+namespace xe {
+
+namespace {
+
+enum class EventType : uint32_t {
+  kScope,
+  kCounterSet,
+  kCounterDelta,
+  kFrame,
+};
+
+struct Event {
+  EventType type;
+  const char* group_name;
+  const char* name;
+  uint64_t timestamp;
+  // Duration for scopes, value for counters, number for frames.
+  int64_t value;
+};
+
+// Single producer (the owning thread), single consumer (the writer thread)
+// ring of events.
+struct ThreadBuffer {
+  uint32_t thread_id = 0;
+  // Guarded by mutex_.
+  std::string name;
+  bool name_changed = true;
+  bool exited = false;
+
+  std::atomic<uint64_t> write_index = {0};
+  std::atomic<uint64_t> read_index = {0};
+  std::atomic<uint64_t> dropped_count = {0};
+  std::vector<Event> events;
+};
+
+// Guards the buffer list and thread names. Never held while writing the file
+// so threads are not stalled behind the writer.
+std::mutex mutex_;
+std::condition_variable writer_cv_;
+bool writer_stopping_ = false;
+// Buffers of threads that may still write. Exited threads are removed once
+// drained; live ones are kept until process exit as they may be mid-event.
+std::vector<ThreadBuffer*> buffers_;
+
+std::thread writer_thread_;
+std::wstring path_;
+std::chrono::steady_clock::time_point base_time_;
+std::atomic<uint32_t> frame_number_ = {0};
+
+// Only touched by the writer thread.
+FILE* file_ = nullptr;
+std::map<std::string, int64_t> counters_;
+uint64_t event_count_ = 0;
+uint64_t dropped_count_ = 0;
+
+// Buffers are created on the first event so threads that never record
+// anything cost nothing; the name is held until then.
+thread_local ThreadBuffer* current_buffer_ = nullptr;
+thread_local std::string current_name_;
+
+ThreadBuffer* GetCurrentBuffer() {
+  if (current_buffer_) {
+    return current_buffer_;
+  }
+  auto buffer = new ThreadBuffer();
+  buffer->thread_id = xe::threading::current_thread_system_id();
+  buffer->events.resize(std::max(FLAGS_profile_trace_buffer_events, 16));
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer->name = current_name_.empty()
+                     ? "thread_" + std::to_string(buffer->thread_id)
+                     : current_name_;
+  buffers_.push_back(buffer);
+  current_buffer_ = buffer;
+  return buffer;
+}
+
+void AppendEvent(const Event& event) {
+  if (!ProfileTrace::is_enabled()) {
+    return;
+  }
+  auto buffer = GetCurrentBuffer();
+  uint64_t write_index = buffer->write_index.load(std::memory_order_relaxed);
+  uint64_t read_index = buffer->read_index.load(std::memory_order_acquire);
+  if (write_index - read_index >= buffer->events.size()) {
+    buffer->dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  buffer->events[write_index % buffer->events.size()] = event;
+  buffer->write_index.store(write_index + 1, std::memory_order_release);
+}
+
+void WriteString(const char* value) {
+  std::fputc('"', file_);
+  for (const char* c = value; *c; ++c) {
+    if (*c == '"' || *c == '\\') {
+      std::fputc('\\', file_);
+      std::fputc(*c, file_);
+    } else if (uint8_t(*c) < 0x20) {
+      std::fprintf(file_, "\\u%.4x", uint8_t(*c));
+    } else {
+      std::fputc(*c, file_);
+    }
+  }
+  std::fputc('"', file_);
+}
+
+// Timestamps are in microseconds, the unit the trace format expects.
+void WriteEvent(uint32_t thread_id, const Event& event) {
+  std::fprintf(file_, ",\n{\"pid\":1,\"tid\":%u,\"ts\":%.3f,", thread_id,
+               event.timestamp / 1000.0);
+  switch (event.type) {
+    case EventType::kScope:
+      std::fprintf(file_, "\"ph\":\"X\",\"dur\":%.3f,\"cat\":",
+                   event.value / 1000.0);
+      WriteString(event.group_name);
+      std::fputs(",\"name\":", file_);
+      WriteString(event.name);
+      break;
+    case EventType::kCounterSet:
+    case EventType::kCounterDelta: {
+      // Counters are process wide; deltas from all threads are summed here.
+      auto& value = counters_[event.name];
+      if (event.type == EventType::kCounterSet) {
+        value = event.value;
+      } else {
+        value += event.value;
+      }
+      std::fputs("\"ph\":\"C\",\"name\":", file_);
+      WriteString(event.name);
+      std::fprintf(file_, ",\"args\":{\"value\":%" PRId64 "}", value);
+      break;
+    }
+    case EventType::kFrame:
+      std::fprintf(file_,
+                   "\"ph\":\"i\",\"s\":\"g\",\"name\":\"Frame\","
+                   "\"args\":{\"frame\":%" PRId64 "}",
+                   event.value);
+      break;
+  }
+  std::fputc('}', file_);
+  ++event_count_;
+}
+
+void DrainBuffers(std::unique_lock<std::mutex>& lock) {
+  struct Pending {
+    ThreadBuffer* buffer;
+    bool exited;
+    std::string name;
+  };
+  std::vector<Pending> pending;
+  for (auto buffer : buffers_) {
+    pending.push_back({buffer, buffer->exited, std::string()});
+    if (buffer->name_changed) {
+      pending.back().name = buffer->name;
+      buffer->name_changed = false;
+    }
+  }
+  lock.unlock();
+
+  for (auto& it : pending) {
+    auto buffer = it.buffer;
+    if (!it.name.empty()) {
+      std::fprintf(file_,
+                   ",\n{\"pid\":1,\"tid\":%u,\"ph\":\"M\","
+                   "\"name\":\"thread_name\",\"args\":{\"name\":",
+                   buffer->thread_id);
+      WriteString(it.name.c_str());
+      std::fputs("}}", file_);
+    }
+    uint64_t read_index = buffer->read_index.load(std::memory_order_relaxed);
+    uint64_t write_index = buffer->write_index.load(std::memory_order_acquire);
+    for (; read_index != write_index; ++read_index) {
+      WriteEvent(buffer->thread_id,
+                 buffer->events[read_index % buffer->events.size()]);
+    }
+    buffer->read_index.store(read_index, std::memory_order_release);
+    dropped_count_ += buffer->dropped_count.exchange(0);
+  }
+
+  // Only buffers that had exited before the drain began are known to be
+  // fully written out.
+  lock.lock();
+  for (auto& it : pending) {
+    if (it.exited) {
+      buffers_.erase(std::find(buffers_.begin(), buffers_.end(), it.buffer));
+      delete it.buffer;
+    }
+  }
+}
+
+void WriterThreadMain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!writer_stopping_) {
+    writer_cv_.wait_for(lock, std::chrono::milliseconds(100));
+    DrainBuffers(lock);
+  }
+  DrainBuffers(lock);
+  lock.unlock();
+  std::fputs("\n]}\n", file_);
+  std::fclose(file_);
+  file_ = nullptr;
+  XELOGI("Profile trace: %" PRIu64 " events (%" PRIu64
+         " dropped) written to %S",
+         event_count_, dropped_count_, path_.c_str());
+}
+
+// Lets the writer finish the file. Events are no longer recorded once
+// enabled_ is cleared.
+void StopWriter() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    writer_stopping_ = true;
+  }
+  writer_cv_.notify_all();
+}
+
+}  // namespace
+
+std::atomic<bool> ProfileTrace::enabled_ = {false};
+
+void ProfileTrace::Initialize() {
+  if (FLAGS_profile_trace.empty() || file_) {
+    return;
+  }
+  path_ = xe::to_wstring(FLAGS_profile_trace);
+  file_ = xe::filesystem::OpenFile(path_, "w");
+  if (!file_) {
+    XELOGE("Unable to open profile trace output %S", path_.c_str());
+    return;
+  }
+  std::fputs(
+      "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"
+      "{\"pid\":1,\"ph\":\"M\",\"name\":\"process_name\","
+      "\"args\":{\"name\":\"xenia\"}}",
+      file_);
+  base_time_ = std::chrono::steady_clock::now();
+  writer_thread_ = std::thread(WriterThreadMain);
+  enabled_ = true;
+}
+
+void ProfileTrace::Shutdown() {
+  enabled_ = false;
+  StopWriter();
+  if (writer_thread_.joinable()) {
+    writer_thread_.join();
+  }
+}
+
+void ProfileTrace::ThreadEnter(const char* name) {
+  if (!is_enabled() || !name) {
+    return;
+  }
+  current_name_ = name;
+  auto buffer = current_buffer_;
+  if (buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffer->name = name;
+    buffer->name_changed = true;
+  }
+}
+
+void ProfileTrace::ThreadExit() {
+  current_name_.clear();
+  auto buffer = current_buffer_;
+  if (!buffer) {
+    return;
+  }
+  current_buffer_ = nullptr;
+  std::lock_guard<std::mutex> lock(mutex_);
+  buffer->exited = true;
+}
+
+void ProfileTrace::Flip() {
+  if (!is_enabled()) {
+    return;
+  }
+  uint32_t frame_number = ++frame_number_;
+  AppendEvent({EventType::kFrame, nullptr, nullptr, Now(), frame_number});
+  if (FLAGS_profile_trace_frames > 0 &&
+      frame_number >= uint32_t(FLAGS_profile_trace_frames)) {
+    enabled_ = false;
+    StopWriter();
+  }
+}
+
+uint64_t ProfileTrace::Now() {
+  // Never zero, as ProfileTraceScope uses that to mean disabled.
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - base_time_)
+             .count() |
+         1;
+}
+
+void ProfileTrace::Scope(const char* group_name, const char* scope_name,
+                         uint64_t start) {
+  AppendEvent({EventType::kScope, group_name, scope_name, start,
+               int64_t(Now() - start)});
+}
+
+void ProfileTrace::Counter(const char* name, int64_t value, bool is_delta) {
+  AppendEvent({is_delta ? EventType::kCounterDelta : EventType::kCounterSet,
+               nullptr, name, Now(), value});
+}
+
+}  // namespace xe
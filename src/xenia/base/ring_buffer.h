@@ -17,6 +17,7 @@
 
 #include "xenia/base/assert.h"
 #include "xenia/base/byte_order.h"
+#include "xenia/base/memory.h"
 
 namespace xe {
 
@@ -95,6 +96,25 @@ class RingBuffer {
     return imm;
   }
 
+  // Reads count elements into buffer, byte swapping each in a single pass.
+  template <typename T>
+  size_t ReadAndSwap(T* buffer, size_t count) {
+    static_assert(std::is_fundamental<T>::value,
+                  "Swapped read only supports basic types!");
+
+    ReadRange range = BeginRead(count * sizeof(T));
+    size_t first_count = range.first_length / sizeof(T);
+    xe::copy_and_swap(buffer, reinterpret_cast<const T*>(range.first),
+                      first_count);
+    if (range.second_length) {
+      xe::copy_and_swap(buffer + first_count,
+                        reinterpret_cast<const T*>(range.second),
+                        range.second_length / sizeof(T));
+    }
+    EndRead(range);
+    return (range.first_length + range.second_length) / sizeof(T);
+  }
+
   size_t Write(const uint8_t* buffer, size_t count);
   template <typename T>
   size_t Write(const T* buffer, size_t count) {
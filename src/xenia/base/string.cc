@@ -88,6 +88,13 @@ std::wstring format_string(const wchar_t* format, va_list args) {
   }
 }
 
+std::string to_lower_ascii(std::string value) {
+  for (auto& c : value) {
+    c = char(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return value;
+}
+
 std::string::size_type find_first_of_case(const std::string& target,
                                           const std::string& search) {
   const char* str = target.c_str();
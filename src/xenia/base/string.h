@@ -40,6 +40,10 @@ inline std::wstring format_string(const wchar_t* format, ...) {
   return result;
 }
 
+// Lowercases ASCII letters only, for case-insensitive keys (strcasecmp
+// semantics).
+std::string to_lower_ascii(std::string value);
+
 // find_first_of string, case insensitive.
 std::string::size_type find_first_of_case(const std::string& target,
                                           const std::string& search);
@@ -18,6 +18,18 @@ namespace xe {
 namespace cpu {
 namespace backend {
 
+// Describes the frame of a block of generated code. This is what
+// LookupUnwindInfo returns on hosts without a system function table format
+// (Windows returns its RUNTIME_FUNCTION entries instead).
+struct UnwindInfo {
+  uint64_t begin_address;
+  uint64_t end_address;
+  // Offset of the first instruction after the frame has been allocated.
+  uint32_t prolog_end;
+  // Bytes allocated below the return address, or 0 if the code has no frame.
+  uint32_t stack_size;
+};
+
 class CodeCache {
  public:
   CodeCache() = default;
@@ -217,6 +217,8 @@ void* X64CodeCache::PlaceGuestCode(uint32_t guest_address, void* machine_code,
   }
 #endif
 
+  OnCodePlaced(guest_address, function_info, code_address, code_size);
+
   // Now that everything is ready, fix up the indirection table.
   // Note that we do support code that doesn't have an indirection fixup, so
   // ignore those when we see them.
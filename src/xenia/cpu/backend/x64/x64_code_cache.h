@@ -87,6 +87,12 @@ class X64CodeCache : public CodeCache {
                          size_t code_size, size_t stack_size,
                          void* code_address,
                          UnwindReservation unwind_reservation) {}
+  // Called outside of the lock once code has been copied into place, before
+  // it is reachable through the indirection table. function_info is null for
+  // host code.
+  virtual void OnCodePlaced(uint32_t guest_address,
+                            GuestFunction* function_info, void* code_address,
+                            size_t code_size) {}
 
   std::wstring file_name_;
   xe::memory::FileMappingHandle mapping_ = nullptr;
@@ -9,11 +9,275 @@
 
 #include "xenia/cpu/backend/x64/x64_code_cache.h"
 
+#include <gflags/gflags.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+
+#include "xenia/base/assert.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/string.h"
+#include "xenia/cpu/function.h"
+#include "xenia/cpu/module.h"
+
+DEFINE_bool(perf_map, false,
+            "Write /tmp/perf-<pid>.map entries for all generated code so perf "
+            "can name JIT frames.");
+DEFINE_string(perf_jitdump, "",
+              "Directory to write a perf jitdump (jit-<pid>.dump) to, with "
+              "code bytes and guest instruction indices as line info. Use "
+              "with `perf record -k 1` and `perf inject --jit`.");
+
+// libgcc's runtime registration of unwind info (unwind-dw2-fde.c).
+extern "C" void __register_frame(void* begin);
+extern "C" void __deregister_frame(void* begin);
+
 namespace xe {
 namespace cpu {
 namespace backend {
 namespace x64 {
 
+// Writes the perf map and jitdump formats described in the Linux kernel tree
+// under tools/perf/Documentation/jit-interface.txt and jitdump-specification.
+class PerfJitWriter {
+ public:
+  ~PerfJitWriter();
+
+  bool Initialize();
+  void CodeLoaded(uint32_t guest_address, GuestFunction* function_info,
+                  void* code_address, size_t code_size);
+
+ private:
+  enum RecordType : uint32_t {
+    kJitCodeLoad = 0,
+    kJitCodeDebugInfo = 2,
+  };
+#pragma pack(push, 1)
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t total_size;
+    uint32_t elf_mach;
+    uint32_t pad1;
+    uint32_t pid;
+    uint64_t timestamp;
+    uint64_t flags;
+  };
+  struct RecordHeader {
+    uint32_t id;
+    uint32_t total_size;
+    uint64_t timestamp;
+  };
+  struct CodeLoadRecord {
+    RecordHeader header;
+    uint32_t pid;
+    uint32_t tid;
+    uint64_t vma;
+    uint64_t code_addr;
+    uint64_t code_size;
+    uint64_t code_index;
+    // Followed by the name (NUL terminated) and the code bytes.
+  };
+  struct DebugInfoRecord {
+    RecordHeader header;
+    uint64_t code_addr;
+    uint64_t nr_entry;
+    // Followed by nr_entry DebugEntry.
+  };
+  struct DebugEntry {
+    uint64_t code_addr;
+    uint32_t line;
+    uint32_t discrim;
+    // Followed by the file name (NUL terminated).
+  };
+#pragma pack(pop)
+
+  static uint64_t Timestamp();
+  void WriteDebugInfo(GuestFunction* function_info, uint8_t* code_address);
+
+  std::mutex mutex_;
+  FILE* map_file_ = nullptr;
+  FILE* dump_file_ = nullptr;
+  void* dump_marker_ = nullptr;
+  size_t dump_marker_size_ = 0;
+  uint64_t code_index_ = 0;
+};
+
+PerfJitWriter::~PerfJitWriter() {
+  if (map_file_) {
+    fclose(map_file_);
+  }
+  if (dump_marker_) {
+    munmap(dump_marker_, dump_marker_size_);
+  }
+  if (dump_file_) {
+    fclose(dump_file_);
+  }
+}
+
+uint64_t PerfJitWriter::Timestamp() {
+  // perf record -k 1 samples with CLOCK_MONOTONIC; records must match.
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return uint64_t(ts.tv_sec) * 1000000000ull + uint64_t(ts.tv_nsec);
+}
+
+bool PerfJitWriter::Initialize() {
+  if (FLAGS_perf_map) {
+    auto path = xe::format_string("/tmp/perf-%d.map", getpid());
+    map_file_ = fopen(path.c_str(), "w");
+    if (!map_file_) {
+      XELOGE("Unable to open perf map %s", path.c_str());
+    }
+  }
+
+  if (!FLAGS_perf_jitdump.empty()) {
+    auto path = xe::format_string("%s/jit-%d.dump",
+                                  FLAGS_perf_jitdump.c_str(), getpid());
+    dump_file_ = fopen(path.c_str(), "w+");
+    if (!dump_file_) {
+      XELOGE("Unable to open perf jitdump %s", path.c_str());
+    } else {
+      // perf finds the dump through an executable mapping of it showing up
+      // in the trace, so keep one around.
+      dump_marker_size_ = size_t(sysconf(_SC_PAGESIZE));
+      dump_marker_ = mmap(nullptr, dump_marker_size_, PROT_READ | PROT_EXEC,
+                          MAP_PRIVATE, fileno(dump_file_), 0);
+      if (dump_marker_ == MAP_FAILED) {
+        dump_marker_ = nullptr;
+        XELOGE("Unable to map perf jitdump marker");
+      }
+
+      FileHeader header = {0};
+      header.magic = 0x4A695444;  // 'JiTD'
+      header.version = 1;
+      header.total_size = sizeof(header);
+      header.elf_mach = 62;  // EM_X86_64
+      header.pid = uint32_t(getpid());
+      header.timestamp = Timestamp();
+      fwrite(&header, sizeof(header), 1, dump_file_);
+      fflush(dump_file_);
+    }
+  }
+
+  return map_file_ || dump_file_;
+}
+
+void PerfJitWriter::WriteDebugInfo(GuestFunction* function_info,
+                                   uint8_t* code_address) {
+  // perf stores line numbers as signed 32-bit values, so guest addresses
+  // (0x82000000 and up) can't be used directly. Each function gets its own
+  // file named after its full guest address, and lines are 1-based
+  // instruction indices within it: line N of "module@82001000" is the PPC
+  // instruction at 0x82001000 + (N - 1) * 4.
+  auto& source_map = function_info->source_map();
+  if (source_map.empty()) {
+    return;
+  }
+  uint32_t function_address = function_info->address();
+  std::string file_name = xe::format_string(
+      "%s@%.8X", function_info->module()->name().c_str(), function_address);
+  size_t entry_size = sizeof(DebugEntry) + file_name.size() + 1;
+
+  DebugInfoRecord record;
+  record.header.id = kJitCodeDebugInfo;
+  record.header.total_size =
+      uint32_t(sizeof(record) + entry_size * source_map.size());
+  record.header.timestamp = Timestamp();
+  record.code_addr = uint64_t(code_address);
+  record.nr_entry = source_map.size();
+  fwrite(&record, sizeof(record), 1, dump_file_);
+  for (auto& source_entry : source_map) {
+    // Entries before the function start (shouldn't happen) map to line 1
+    // rather than wrapping.
+    uint32_t offset = source_entry.guest_address >= function_address
+                          ? source_entry.guest_address - function_address
+                          : 0;
+    DebugEntry entry;
+    entry.code_addr = uint64_t(code_address + source_entry.code_offset);
+    entry.line = offset / 4 + 1;
+    entry.discrim = 0;
+    fwrite(&entry, sizeof(entry), 1, dump_file_);
+    fwrite(file_name.c_str(), file_name.size() + 1, 1, dump_file_);
+  }
+}
+
+void PerfJitWriter::CodeLoaded(uint32_t guest_address,
+                               GuestFunction* function_info,
+                               void* code_address, size_t code_size) {
+  std::string name;
+  if (function_info && !function_info->name().empty()) {
+    name = function_info->name();
+  } else if (function_info) {
+    name = xe::format_string("sub_%.8X", guest_address);
+  } else {
+    name = xe::format_string("xe_host_%p", code_address);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (map_file_) {
+    fprintf(map_file_, "%lx %zx %s\n", uintptr_t(code_address), code_size,
+            name.c_str());
+    fflush(map_file_);
+  }
+
+  if (dump_file_) {
+    // Debug info must precede the load record it describes.
+    if (function_info) {
+      WriteDebugInfo(function_info, reinterpret_cast<uint8_t*>(code_address));
+    }
+
+    CodeLoadRecord record;
+    record.header.id = kJitCodeLoad;
+    record.header.total_size =
+        uint32_t(sizeof(record) + name.size() + 1 + code_size);
+    record.header.timestamp = Timestamp();
+    record.pid = uint32_t(getpid());
+    record.tid = uint32_t(syscall(SYS_gettid));
+    record.vma = uint64_t(code_address);
+    record.code_addr = uint64_t(code_address);
+    record.code_size = code_size;
+    record.code_index = code_index_++;
+    fwrite(&record, sizeof(record), 1, dump_file_);
+    fwrite(name.c_str(), name.size() + 1, 1, dump_file_);
+    fwrite(code_address, code_size, 1, dump_file_);
+    fflush(dump_file_);
+  }
+}
+
+// Size of the .eh_frame data (CIE, FDE and terminator) per function.
+static const size_t kEhFrameSize = 64;
+
+// DWARF call frame information encodings, from the x86-64 psABI.
+enum : uint8_t {
+  kDwCfaNop = 0x00,
+  kDwCfaAdvanceLoc4 = 0x04,
+  kDwCfaDefCfa = 0x0C,
+  kDwCfaDefCfaOffset = 0x0E,
+  kDwCfaOffset = 0x80,
+  kDwRegRsp = 7,
+  kDwRegRip = 16,
+  kDwEhPePcrelSdata4 = 0x1B,
+};
+
+// Pads a CIE/FDE with nops to pointer alignment and fills in its length.
+static uint8_t* FinishEhFrameRecord(uint8_t* record, uint8_t* p) {
+  while ((p - record) % 8) {
+    *p++ = kDwCfaNop;
+  }
+  xe::store<uint32_t>(record, uint32_t(p - record - 4));
+  return p;
+}
+
 class PosixX64CodeCache : public X64CodeCache {
  public:
   PosixX64CodeCache();
@@ -21,19 +285,26 @@ class PosixX64CodeCache : public X64CodeCache {
 
   bool Initialize() override;
 
-  void* LookupUnwindInfo(uint64_t host_pc) override { return nullptr; }
+  void* LookupUnwindInfo(uint64_t host_pc) override;
 
  private:
-  /*
   UnwindReservation RequestUnwindReservation(uint8_t* entry_address) override;
   void PlaceCode(uint32_t guest_address, void* machine_code, size_t code_size,
                  size_t stack_size, void* code_address,
                  UnwindReservation unwind_reservation) override;
 
-  void InitializeUnwindEntry(uint8_t* unwind_entry_address,
-                             size_t unwind_table_slot, void* code_address,
-                             size_t code_size, size_t stack_size);
-  */
+  void InitializeEhFrame(uint8_t* eh_frame_address, const UnwindInfo& info);
+
+  void OnCodePlaced(uint32_t guest_address, GuestFunction* function_info,
+                    void* code_address, size_t code_size) override;
+
+  std::unique_ptr<PerfJitWriter> perf_jit_writer_;
+
+  // Sorted by address, as code is only ever appended.
+  std::vector<UnwindInfo> unwind_table_;
+  // Number of valid entries. Only grows once an entry is fully written, so
+  // lookups from other threads never see a partial entry.
+  std::atomic<uint32_t> unwind_table_count_ = {0};
 };
 
 std::unique_ptr<X64CodeCache> X64CodeCache::Create() {
@@ -41,11 +312,165 @@ std::unique_ptr<X64CodeCache> X64CodeCache::Create() {
 }
 
 PosixX64CodeCache::PosixX64CodeCache() = default;
-PosixX64CodeCache::~PosixX64CodeCache() = default;
 
-bool PosixX64CodeCache::Initialize() { return X64CodeCache::Initialize(); }
+PosixX64CodeCache::~PosixX64CodeCache() {
+  // The unwinder keeps pointers to the registered frames; drop them before
+  // the code cache mapping goes away.
+  for (uint32_t i = 0; i < unwind_table_count_; ++i) {
+    auto& info = unwind_table_[i];
+    __deregister_frame(reinterpret_cast<uint8_t*>(info.begin_address) +
+                       xe::round_up(info.end_address - info.begin_address, 16));
+  }
+}
+
+bool PosixX64CodeCache::Initialize() {
+  if (!X64CodeCache::Initialize()) {
+    return false;
+  }
+
+  unwind_table_.resize(kMaximumFunctionCount);
+
+  if (FLAGS_perf_map || !FLAGS_perf_jitdump.empty()) {
+    perf_jit_writer_ = std::make_unique<PerfJitWriter>();
+    if (!perf_jit_writer_->Initialize()) {
+      perf_jit_writer_.reset();
+    }
+  }
+
+  return true;
+}
+
+PosixX64CodeCache::UnwindReservation
+PosixX64CodeCache::RequestUnwindReservation(uint8_t* entry_address) {
+  // Called under the global lock, immediately followed by PlaceCode.
+  UnwindReservation unwind_reservation;
+  unwind_reservation.data_size = kEhFrameSize;
+  unwind_reservation.table_slot = unwind_table_count_;
+  unwind_reservation.entry_address = entry_address;
+  assert_false(unwind_table_count_ >= kMaximumFunctionCount);
+  return unwind_reservation;
+}
+
+void PosixX64CodeCache::PlaceCode(uint32_t guest_address, void* machine_code,
+                                  size_t code_size, size_t stack_size,
+                                  void* code_address,
+                                  UnwindReservation unwind_reservation) {
+  auto code = reinterpret_cast<const uint8_t*>(code_address);
+  auto& info = unwind_table_[unwind_reservation.table_slot];
+  info.begin_address = reinterpret_cast<uint64_t>(code_address);
+  info.end_address = info.begin_address + code_size;
+  info.stack_size = uint32_t(stack_size);
+  info.prolog_end = 0;
+  if (stack_size) {
+    // The frame is allocated with a single sub rsp, imm: first thing in guest
+    // functions, after spilling arguments to the home area in thunks.
+    // See X64Emitter::Emit and X64ThunkEmitter.
+    size_t scan_size = std::min(code_size, size_t(64));
+    for (size_t i = 0; i + 4 <= scan_size; ++i) {
+      if (code[i] != 0x48 || code[i + 2] != 0xEC) {
+        continue;
+      }
+      if (code[i + 1] == 0x83 && code[i + 3] == stack_size) {
+        info.prolog_end = uint32_t(i + 4);
+        break;
+      } else if (code[i + 1] == 0x81 && i + 7 <= scan_size &&
+                 xe::load<uint32_t>(code + i + 3) == stack_size) {
+        info.prolog_end = uint32_t(i + 7);
+        break;
+      }
+    }
+  }
+
+  InitializeEhFrame(unwind_reservation.entry_address, info);
+  __register_frame(unwind_reservation.entry_address);
+
+  unwind_table_count_.store(uint32_t(unwind_reservation.table_slot + 1),
+                            std::memory_order_release);
+}
+
+void PosixX64CodeCache::InitializeEhFrame(uint8_t* eh_frame_address,
+                                          const UnwindInfo& info) {
+  // A CIE/FDE pair followed by a zero terminator, which is what libgcc's
+  // __register_frame expects. CFA is rsp + 8 on entry and rsp + stack_size + 8
+  // once the frame is allocated. Epilogs aren't described; unwinding from the
+  // few instructions between add rsp and ret is off by one frame.
+  uint8_t* p = eh_frame_address;
+
+  uint8_t* cie = p;
+  p += 4;
+  xe::store<uint32_t>(p, 0);  // CIE id
+  p += 4;
+  *p++ = 1;  // version
+  *p++ = 'z';
+  *p++ = 'R';
+  *p++ = 0;
+  *p++ = 1;     // code alignment factor
+  *p++ = 0x78;  // data alignment factor, -8 as sleb128
+  *p++ = kDwRegRip;
+  *p++ = 1;  // augmentation data length
+  *p++ = kDwEhPePcrelSdata4;
+  *p++ = kDwCfaDefCfa;
+  *p++ = kDwRegRsp;
+  *p++ = 8;
+  *p++ = kDwCfaOffset | kDwRegRip;
+  *p++ = 1;  // return address at CFA - 8
+  p = FinishEhFrameRecord(cie, p);
+
+  uint8_t* fde = p;
+  p += 4;
+  xe::store<uint32_t>(p, uint32_t(p - cie));  // CIE pointer
+  p += 4;
+  xe::store<int32_t>(p, int32_t(int64_t(info.begin_address) - int64_t(p)));
+  p += 4;
+  xe::store<uint32_t>(p, uint32_t(info.end_address - info.begin_address));
+  p += 4;
+  *p++ = 0;  // augmentation data length
+  if (info.stack_size) {
+    *p++ = kDwCfaAdvanceLoc4;
+    xe::store<uint32_t>(p, info.prolog_end);
+    p += 4;
+    *p++ = kDwCfaDefCfaOffset;
+    uint32_t cfa_offset = info.stack_size + 8;
+    do {
+      uint8_t byte = cfa_offset & 0x7F;
+      cfa_offset >>= 7;
+      *p++ = cfa_offset ? (byte | 0x80) : byte;
+    } while (cfa_offset);
+  }
+  p = FinishEhFrameRecord(fde, p);
+
+  xe::store<uint32_t>(p, 0);
+  p += 4;
+  assert_true(size_t(p - eh_frame_address) <= kEhFrameSize);
+}
+
+void* PosixX64CodeCache::LookupUnwindInfo(uint64_t host_pc) {
+  uint32_t count = unwind_table_count_.load(std::memory_order_acquire);
+  auto it = std::upper_bound(
+      unwind_table_.begin(), unwind_table_.begin() + count, host_pc,
+      [](uint64_t pc, const UnwindInfo& info) {
+        return pc < info.begin_address;
+      });
+  if (it == unwind_table_.begin()) {
+    return nullptr;
+  }
+  --it;
+  if (host_pc >= it->end_address) {
+    return nullptr;
+  }
+  return &*it;
+}
+
+void PosixX64CodeCache::OnCodePlaced(uint32_t guest_address,
+                                     GuestFunction* function_info,
+                                     void* code_address, size_t code_size) {
+  if (perf_jit_writer_) {
+    perf_jit_writer_->CodeLoaded(guest_address, function_info, code_address,
+                                 code_size);
+  }
+}
 
 }  // namespace x64
 }  // namespace backend
 }  // namespace cpu
-}  // namespace xe
\ No newline at end of file
+}  // namespace xe
@@ -107,13 +107,14 @@ bool X64Emitter::Emit(GuestFunction* function, HIRBuilder* builder,
     return false;
   }
 
+  // Stash source map. This is done before placing the code so that code
+  // cache listeners (perf jitdump) can see it.
+  source_map_arena_.CloneContents(out_source_map);
+
   // Copy the final code to the cache and relocate it.
   *out_code_size = getSize();
   *out_code_address = Emplace(stack_size, function);
 
-  // Stash source map.
-  source_map_arena_.CloneContents(out_source_map);
-
   return true;
 }
 
@@ -180,7 +181,12 @@ bool X64Emitter::Emit(HIRBuilder* builder, size_t* out_stack_size) {
     auto trace_header = trace_data_->header();
 
     // Call count.
-    lock();
+    // Unless asked for exact counts the counters use plain increments: a
+    // locked RMW on a line shared by every thread running the function
+    // dominates the cost of tracing.
+    if (FLAGS_trace_function_atomic_counters) {
+      lock();
+    }
     inc(qword[low_address(&trace_header->function_call_count)]);
 
     // Get call history slot.
@@ -196,9 +202,14 @@ bool X64Emitter::Emit(HIRBuilder* builder, size_t* out_stack_size) {
         edx);
 
     // Calling thread. Load ax with thread ID.
+    // The bit is set once per thread, so only take the lock when it's clear.
     EmitGetCurrentThreadId();
+    Xbyak::Label thread_use_done;
+    bt(qword[low_address(&trace_header->function_thread_use)], rax);
+    jc(thread_use_done);
     lock();
     bts(qword[low_address(&trace_header->function_thread_use)], rax);
+    L(thread_use_done);
   }
 
   // Load membase.
@@ -267,7 +278,9 @@ void X64Emitter::MarkSourceOffset(const Instr* i) {
   if (debug_info_flags_ & DebugInfoFlags::kDebugInfoTraceFunctionCoverage) {
     uint32_t instruction_index =
         (entry->guest_address - trace_data_->start_address()) / 4;
-    lock();
+    if (FLAGS_trace_function_atomic_counters) {
+      lock();
+    }
     inc(qword[low_address(trace_data_->instruction_execute_counts() +
                           instruction_index * 8)]);
   }
@@ -2157,9 +2157,17 @@ EMITTER_OPCODE_TABLE(OPCODE_STORE_MMIO, STORE_MMIO_I32);
 // ============================================================================
 // OPCODE_LOAD_OFFSET
 // ============================================================================
+// Whether the guest address register can be used as-is, without clearing the
+// upper 32 bits first. Tracing reuses the address after the destination
+// (which may share the register) has been written, so it always gets a copy.
+bool IsAddressZeroExtended(uint16_t flags) {
+  return (flags & LoadStoreFlags::LOAD_STORE_ADDRESS_ZERO_EXTENDED) &&
+         !IsTracingData();
+}
+
 template <typename T>
 RegExp ComputeMemoryAddressOffset(X64Emitter& e, const T& guest,
-                                  const T& offset) {
+                                  const T& offset, uint16_t flags = 0) {
   int32_t offset_const = static_cast<int32_t>(offset.constant());
 
   if (guest.is_constant) {
@@ -2171,9 +2179,10 @@ RegExp ComputeMemoryAddressOffset(X64Emitter& e, const T& guest,
       e.mov(e.eax, address);
       return e.GetMembaseReg() + e.rax;
     }
+  } else if (IsAddressZeroExtended(flags)) {
+    return e.GetMembaseReg() + guest.reg() + offset_const;
   } else {
     // Clear the top 32 bits, as they are likely garbage.
-    // TODO(benvanik): find a way to avoid doing this.
     e.mov(e.eax, guest.reg().cvt32());
     return e.GetMembaseReg() + e.rax + offset_const;
   }
@@ -2182,7 +2191,7 @@ RegExp ComputeMemoryAddressOffset(X64Emitter& e, const T& guest,
 struct LOAD_OFFSET_I8
     : Sequence<LOAD_OFFSET_I8, I<OPCODE_LOAD_OFFSET, I8Op, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     e.mov(i.dest, e.byte[addr]);
   }
 };
@@ -2190,7 +2199,7 @@ struct LOAD_OFFSET_I8
 struct LOAD_OFFSET_I16
     : Sequence<LOAD_OFFSET_I16, I<OPCODE_LOAD_OFFSET, I16Op, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
         e.movbe(i.dest, e.word[addr]);
@@ -2207,7 +2216,7 @@ struct LOAD_OFFSET_I16
 struct LOAD_OFFSET_I32
     : Sequence<LOAD_OFFSET_I32, I<OPCODE_LOAD_OFFSET, I32Op, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
         e.movbe(i.dest, e.dword[addr]);
@@ -2224,7 +2233,7 @@ struct LOAD_OFFSET_I32
 struct LOAD_OFFSET_I64
     : Sequence<LOAD_OFFSET_I64, I<OPCODE_LOAD_OFFSET, I64Op, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
         e.movbe(i.dest, e.qword[addr]);
@@ -2247,7 +2256,7 @@ struct STORE_OFFSET_I8
     : Sequence<STORE_OFFSET_I8,
                I<OPCODE_STORE_OFFSET, VoidOp, I64Op, I64Op, I8Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     if (i.src3.is_constant) {
       e.mov(e.byte[addr], i.src3.constant());
     } else {
@@ -2260,7 +2269,7 @@ struct STORE_OFFSET_I16
     : Sequence<STORE_OFFSET_I16,
                I<OPCODE_STORE_OFFSET, VoidOp, I64Op, I64Op, I16Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src3.is_constant);
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
@@ -2282,7 +2291,7 @@ struct STORE_OFFSET_I32
     : Sequence<STORE_OFFSET_I32,
                I<OPCODE_STORE_OFFSET, VoidOp, I64Op, I64Op, I32Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src3.is_constant);
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
@@ -2304,7 +2313,7 @@ struct STORE_OFFSET_I64
     : Sequence<STORE_OFFSET_I64,
                I<OPCODE_STORE_OFFSET, VoidOp, I64Op, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2);
+    auto addr = ComputeMemoryAddressOffset(e, i.src1, i.src2, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src3.is_constant);
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
@@ -2329,7 +2338,8 @@ EMITTER_OPCODE_TABLE(OPCODE_STORE_OFFSET, STORE_OFFSET_I8, STORE_OFFSET_I16,
 // ============================================================================
 // Note: most *should* be aligned, but needs to be checked!
 template <typename T>
-RegExp ComputeMemoryAddress(X64Emitter& e, const T& guest) {
+RegExp ComputeMemoryAddress(X64Emitter& e, const T& guest,
+                            uint16_t flags = 0) {
   if (guest.is_constant) {
     // TODO(benvanik): figure out how to do this without a temp.
     // Since the constant is often 0x8... if we tried to use that as a
@@ -2341,16 +2351,17 @@ RegExp ComputeMemoryAddress(X64Emitter& e, const T& guest) {
       e.mov(e.eax, address);
       return e.GetMembaseReg() + e.rax;
     }
+  } else if (IsAddressZeroExtended(flags)) {
+    return e.GetMembaseReg() + guest.reg();
   } else {
     // Clear the top 32 bits, as they are likely garbage.
-    // TODO(benvanik): find a way to avoid doing this.
     e.mov(e.eax, guest.reg().cvt32());
     return e.GetMembaseReg() + e.rax;
   }
 }
 struct LOAD_I8 : Sequence<LOAD_I8, I<OPCODE_LOAD, I8Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     e.mov(i.dest, e.byte[addr]);
     if (IsTracingData()) {
       e.mov(e.r8b, i.dest);
@@ -2361,7 +2372,7 @@ struct LOAD_I8 : Sequence<LOAD_I8, I<OPCODE_LOAD, I8Op, I64Op>> {
 };
 struct LOAD_I16 : Sequence<LOAD_I16, I<OPCODE_LOAD, I16Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
         e.movbe(i.dest, e.word[addr]);
@@ -2381,7 +2392,7 @@ struct LOAD_I16 : Sequence<LOAD_I16, I<OPCODE_LOAD, I16Op, I64Op>> {
 };
 struct LOAD_I32 : Sequence<LOAD_I32, I<OPCODE_LOAD, I32Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
         e.movbe(i.dest, e.dword[addr]);
@@ -2401,7 +2412,7 @@ struct LOAD_I32 : Sequence<LOAD_I32, I<OPCODE_LOAD, I32Op, I64Op>> {
 };
 struct LOAD_I64 : Sequence<LOAD_I64, I<OPCODE_LOAD, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
         e.movbe(i.dest, e.qword[addr]);
@@ -2421,7 +2432,7 @@ struct LOAD_I64 : Sequence<LOAD_I64, I<OPCODE_LOAD, I64Op, I64Op>> {
 };
 struct LOAD_F32 : Sequence<LOAD_F32, I<OPCODE_LOAD, F32Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     e.vmovss(i.dest, e.dword[addr]);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_always("not implemented yet");
@@ -2435,7 +2446,7 @@ struct LOAD_F32 : Sequence<LOAD_F32, I<OPCODE_LOAD, F32Op, I64Op>> {
 };
 struct LOAD_F64 : Sequence<LOAD_F64, I<OPCODE_LOAD, F64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     e.vmovsd(i.dest, e.qword[addr]);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_always("not implemented yet");
@@ -2449,7 +2460,7 @@ struct LOAD_F64 : Sequence<LOAD_F64, I<OPCODE_LOAD, F64Op, I64Op>> {
 };
 struct LOAD_V128 : Sequence<LOAD_V128, I<OPCODE_LOAD, V128Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     // TODO(benvanik): we should try to stick to movaps if possible.
     e.vmovups(i.dest, e.ptr[addr]);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
@@ -2472,7 +2483,7 @@ EMITTER_OPCODE_TABLE(OPCODE_LOAD, LOAD_I8, LOAD_I16, LOAD_I32, LOAD_I64,
 // Note: most *should* be aligned, but needs to be checked!
 struct STORE_I8 : Sequence<STORE_I8, I<OPCODE_STORE, VoidOp, I64Op, I8Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.src2.is_constant) {
       e.mov(e.byte[addr], i.src2.constant());
     } else {
@@ -2488,7 +2499,7 @@ struct STORE_I8 : Sequence<STORE_I8, I<OPCODE_STORE, VoidOp, I64Op, I8Op>> {
 };
 struct STORE_I16 : Sequence<STORE_I16, I<OPCODE_STORE, VoidOp, I64Op, I16Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src2.is_constant);
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
@@ -2513,7 +2524,7 @@ struct STORE_I16 : Sequence<STORE_I16, I<OPCODE_STORE, VoidOp, I64Op, I16Op>> {
 };
 struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src2.is_constant);
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
@@ -2538,7 +2549,7 @@ struct STORE_I32 : Sequence<STORE_I32, I<OPCODE_STORE, VoidOp, I64Op, I32Op>> {
 };
 struct STORE_I64 : Sequence<STORE_I64, I<OPCODE_STORE, VoidOp, I64Op, I64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src2.is_constant);
       if (e.IsFeatureEnabled(kX64EmitMovbe)) {
@@ -2563,7 +2574,7 @@ struct STORE_I64 : Sequence<STORE_I64, I<OPCODE_STORE, VoidOp, I64Op, I64Op>> {
 };
 struct STORE_F32 : Sequence<STORE_F32, I<OPCODE_STORE, VoidOp, I64Op, F32Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src2.is_constant);
       assert_always("not yet implemented");
@@ -2584,7 +2595,7 @@ struct STORE_F32 : Sequence<STORE_F32, I<OPCODE_STORE, VoidOp, I64Op, F32Op>> {
 };
 struct STORE_F64 : Sequence<STORE_F64, I<OPCODE_STORE, VoidOp, I64Op, F64Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src2.is_constant);
       assert_always("not yet implemented");
@@ -2606,7 +2617,7 @@ struct STORE_F64 : Sequence<STORE_F64, I<OPCODE_STORE, VoidOp, I64Op, F64Op>> {
 struct STORE_V128
     : Sequence<STORE_V128, I<OPCODE_STORE, VoidOp, I64Op, V128Op>> {
   static void Emit(X64Emitter& e, const EmitArgType& i) {
-    auto addr = ComputeMemoryAddress(e, i.src1);
+    auto addr = ComputeMemoryAddress(e, i.src1, i.instr->flags);
     if (i.instr->flags & LoadStoreFlags::LOAD_STORE_BYTE_SWAP) {
       assert_false(i.src2.is_constant);
       e.vpshufb(e.xmm0, i.src2, e.GetXmmConstPtr(XMMByteSwapMask));
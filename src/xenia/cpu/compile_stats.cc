@@ -0,0 +1,152 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compile_stats.h"
+
+#include <algorithm>
+#include <cinttypes>
+
+#include "xenia/base/logging.h"
+#include "xenia/cpu/hir/block.h"
+#include "xenia/cpu/hir/hir_builder.h"
+#include "xenia/cpu/hir/instr.h"
+
+namespace xe {
+namespace cpu {
+
+// Number of functions kept in the largest-output list.
+static const size_t kLargestFunctionCount = 16;
+
+uint32_t CompileStats::CountInstrs(hir::HIRBuilder* builder) {
+  uint32_t count = 0;
+  for (auto block = builder->first_block(); block; block = block->next) {
+    for (auto i = block->instr_head; i; i = i->next) {
+      switch (i->opcode->num) {
+        case hir::OPCODE_COMMENT:
+        case hir::OPCODE_NOP:
+        case hir::OPCODE_SOURCE_OFFSET:
+          break;
+        default:
+          ++count;
+          break;
+      }
+    }
+  }
+  return count;
+}
+
+void CompileStats::Record(const FunctionCompileStats& stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++function_count_;
+  guest_bytes_ += stats.guest_size;
+  host_bytes_ += stats.host_size;
+  scan_ns_ += stats.scan_ns;
+  hir_emit_ns_ += stats.hir_emit_ns;
+  assemble_ns_ += stats.assemble_ns;
+  total_ns_ += stats.total_ns;
+  if (stats.total_ns > max_ns_) {
+    max_ns_ = stats.total_ns;
+    max_ns_address_ = stats.guest_address;
+  }
+
+  if (passes_.size() < stats.passes.size()) {
+    passes_.resize(stats.passes.size());
+  }
+  for (size_t i = 0; i < stats.passes.size(); ++i) {
+    auto& pass = stats.passes[i];
+    auto& totals = passes_[i];
+    totals.name = pass.name;
+    totals.time_ns += pass.time_ns;
+    totals.instrs_before += pass.instrs_before;
+    totals.instrs_after += pass.instrs_after;
+  }
+
+  uint64_t us = stats.total_ns / 1000;
+  size_t bucket = 0;
+  while (us && bucket < kLatencyBucketCount - 1) {
+    us >>= 1;
+    ++bucket;
+  }
+  ++latency_buckets_[bucket];
+
+  if (largest_functions_.size() < kLargestFunctionCount ||
+      stats.host_size > largest_functions_.back().host_size) {
+    LargeFunction entry = {stats.guest_address, stats.guest_size,
+                           stats.host_size};
+    auto it = std::upper_bound(
+        largest_functions_.begin(), largest_functions_.end(), entry,
+        [](const LargeFunction& a, const LargeFunction& b) {
+          return a.host_size > b.host_size;
+        });
+    largest_functions_.insert(it, entry);
+    if (largest_functions_.size() > kLargestFunctionCount) {
+      largest_functions_.pop_back();
+    }
+  }
+}
+
+void CompileStats::Dump() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!function_count_) {
+    XELOGI("JIT stats: no functions compiled");
+    return;
+  }
+
+  XELOGI("JIT stats: %" PRIu64 " functions, %.1fms total, %.1fus average, "
+         "%.1fms max (%.8X)",
+         function_count_, total_ns_ / 1000000.0,
+         total_ns_ / 1000.0 / function_count_, max_ns_ / 1000000.0,
+         max_ns_address_);
+  XELOGI("  code: %" PRIu64 " guest bytes -> %" PRIu64
+         " host bytes (%.2fx)",
+         guest_bytes_, host_bytes_,
+         guest_bytes_ ? double(host_bytes_) / guest_bytes_ : 0.0);
+
+  auto log_stage = [this](const char* name, uint64_t time_ns,
+                          uint64_t instrs_before, uint64_t instrs_after) {
+    double percent = total_ns_ ? time_ns * 100.0 / total_ns_ : 0.0;
+    if (instrs_before || instrs_after) {
+      XELOGI("  %-32s %10.1fms %5.1f%%  instrs %10" PRIu64 " -> %10" PRIu64
+             " (%+.1f%%)",
+             name, time_ns / 1000000.0, percent, instrs_before, instrs_after,
+             instrs_before ? (double(instrs_after) - double(instrs_before)) *
+                                 100.0 / instrs_before
+                           : 0.0);
+    } else {
+      XELOGI("  %-32s %10.1fms %5.1f%%", name, time_ns / 1000000.0, percent);
+    }
+  };
+  log_stage("PPCScanner::Scan", scan_ns_, 0, 0);
+  log_stage("PPCHIRBuilder::Emit", hir_emit_ns_, 0, 0);
+  for (auto& pass : passes_) {
+    log_stage(pass.name, pass.time_ns, pass.instrs_before, pass.instrs_after);
+  }
+  log_stage("Assembler::Assemble", assemble_ns_, 0, 0);
+
+  XELOGI("  compile latency:");
+  for (size_t i = 0; i < kLatencyBucketCount; ++i) {
+    if (!latency_buckets_[i]) {
+      continue;
+    }
+    XELOGI("    <%8" PRIu64 "us %10" PRIu64 " (%5.1f%%)", uint64_t(1) << i,
+           latency_buckets_[i], latency_buckets_[i] * 100.0 / function_count_);
+  }
+
+  XELOGI("  largest functions:");
+  for (auto& function : largest_functions_) {
+    XELOGI("    %.8X %8u guest bytes -> %8u host bytes (%.2fx)",
+           function.guest_address, function.guest_size, function.host_size,
+           function.guest_size ? double(function.host_size) /
+                                     function.guest_size
+                               : 0.0);
+  }
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,109 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILE_STATS_H_
+#define XENIA_CPU_COMPILE_STATS_H_
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace xe {
+namespace cpu {
+namespace hir {
+class HIRBuilder;
+}  // namespace hir
+}  // namespace cpu
+}  // namespace xe
+
+namespace xe {
+namespace cpu {
+
+// Timings and sizes for a single function translation, filled in as the
+// function moves through the pipeline and then merged into CompileStats.
+struct FunctionCompileStats {
+  struct Pass {
+    const char* name;
+    uint64_t time_ns;
+    uint32_t instrs_before;
+    uint32_t instrs_after;
+  };
+
+  uint32_t guest_address = 0;
+  uint32_t guest_size = 0;
+  uint32_t host_size = 0;
+  uint64_t scan_ns = 0;
+  uint64_t hir_emit_ns = 0;
+  uint64_t assemble_ns = 0;
+  uint64_t total_ns = 0;
+  std::vector<Pass> passes;
+};
+
+// Accumulated JIT pipeline metrics: time spent in each stage and compiler
+// pass, how each pass changes the HIR instruction count, emitted code size
+// and a histogram of whole-function compile latency.
+// Enabled with --jit_stats; dumped to the log on exit and on demand.
+class CompileStats {
+ public:
+  using TimePoint = std::chrono::steady_clock::time_point;
+
+  static TimePoint Now() { return std::chrono::steady_clock::now(); }
+  static uint64_t ElapsedNs(TimePoint start) {
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        Now() - start)
+                        .count());
+  }
+
+  // Counts HIR instructions, ignoring comments, nops and source markers.
+  static uint32_t CountInstrs(hir::HIRBuilder* builder);
+
+  void Record(const FunctionCompileStats& stats);
+
+  // Logs the accumulated metrics. Safe to call at any time.
+  void Dump();
+
+ private:
+  // Latency buckets are powers of two microseconds: <1us, <2us, ... <2^N us.
+  static const size_t kLatencyBucketCount = 24;
+
+  struct StageTotals {
+    const char* name = nullptr;
+    uint64_t time_ns = 0;
+    uint64_t instrs_before = 0;
+    uint64_t instrs_after = 0;
+  };
+
+  struct LargeFunction {
+    uint32_t guest_address;
+    uint32_t guest_size;
+    uint32_t host_size;
+  };
+
+  std::mutex mutex_;
+  uint64_t function_count_ = 0;
+  uint64_t guest_bytes_ = 0;
+  uint64_t host_bytes_ = 0;
+  uint64_t scan_ns_ = 0;
+  uint64_t hir_emit_ns_ = 0;
+  uint64_t assemble_ns_ = 0;
+  uint64_t total_ns_ = 0;
+  uint64_t max_ns_ = 0;
+  uint32_t max_ns_address_ = 0;
+  // Indexed by position in the pass pipeline; a pass type may appear twice.
+  std::vector<StageTotals> passes_;
+  uint64_t latency_buckets_[kLatencyBucketCount] = {0};
+  // Functions with the most emitted code, largest first.
+  std::vector<LargeFunction> largest_functions_;
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILE_STATS_H_
@@ -10,6 +10,7 @@
 #include "xenia/cpu/compiler/compiler.h"
 
 #include "xenia/base/profiling.h"
+#include "xenia/cpu/compile_stats.h"
 #include "xenia/cpu/compiler/compiler_pass.h"
 
 namespace xe {
@@ -27,15 +28,25 @@ void Compiler::AddPass(std::unique_ptr<CompilerPass> pass) {
 
 void Compiler::Reset() {}
 
-bool Compiler::Compile(xe::cpu::hir::HIRBuilder* builder) {
+bool Compiler::Compile(xe::cpu::hir::HIRBuilder* builder,
+                       FunctionCompileStats* stats) {
   // TODO(benvanik): sophisticated stuff. Run passes in parallel, run until they
   //                 stop changing things, etc.
+  uint32_t instr_count = stats ? CompileStats::CountInstrs(builder) : 0;
   for (size_t i = 0; i < passes_.size(); ++i) {
     auto& pass = passes_[i];
     scratch_arena_.Reset();
+    auto start = stats ? CompileStats::Now() : CompileStats::TimePoint();
     if (!pass->Run(builder)) {
       return false;
     }
+    if (stats) {
+      uint64_t time_ns = CompileStats::ElapsedNs(start);
+      uint32_t new_instr_count = CompileStats::CountInstrs(builder);
+      stats->passes.push_back(
+          {pass->name(), time_ns, instr_count, new_instr_count});
+      instr_count = new_instr_count;
+    }
   }
 
   return true;
@@ -19,6 +19,7 @@
 namespace xe {
 namespace cpu {
 class Processor;
+struct FunctionCompileStats;
 }  // namespace cpu
 }  // namespace xe
 
@@ -40,7 +41,10 @@ class Compiler {
 
   void Reset();
 
-  bool Compile(hir::HIRBuilder* builder);
+  // Runs all passes over the builder. If stats is provided the time taken
+  // and the instruction count change of each pass are appended to it.
+  bool Compile(hir::HIRBuilder* builder,
+               FunctionCompileStats* stats = nullptr);
 
  private:
   Processor* processor_;
@@ -0,0 +1,269 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/loop_analysis.h"
+
+#include <algorithm>
+
+#include "xenia/cpu/hir/block.h"
+#include "xenia/cpu/hir/hir_builder.h"
+#include "xenia/cpu/hir/instr.h"
+#include "xenia/cpu/hir/label.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+
+static const uint32_t kInvalid = UINT32_MAX;
+
+bool Loop::Contains(const Block* block) const {
+  return block->ordinal < membership.size() && membership[block->ordinal];
+}
+
+void LoopAnalysis::GetSuccessors(Block* block,
+                                 std::vector<Block*>* out_successors) {
+  out_successors->clear();
+  auto add = [out_successors](Block* successor) {
+    if (std::find(out_successors->begin(), out_successors->end(),
+                  successor) == out_successors->end()) {
+      out_successors->push_back(successor);
+    }
+  };
+
+  // Branches are always grouped at the end of the block.
+  auto instr = block->instr_tail;
+  while (instr && (instr->opcode->flags & OPCODE_FLAG_BRANCH)) {
+    if (instr->opcode == &OPCODE_BRANCH_info) {
+      add(instr->src1.label->block);
+    } else if (instr->opcode == &OPCODE_BRANCH_TRUE_info ||
+               instr->opcode == &OPCODE_BRANCH_FALSE_info) {
+      add(instr->src2.label->block);
+    }
+    instr = instr->prev;
+  }
+
+  // Anything not ending in an unconditional jump falls through.
+  auto tail = block->instr_tail;
+  bool falls_through = true;
+  if (tail) {
+    if (tail->opcode == &OPCODE_BRANCH_info ||
+        tail->opcode == &OPCODE_RETURN_info) {
+      falls_through = false;
+    } else if (tail->opcode == &OPCODE_CALL_info ||
+               tail->opcode == &OPCODE_CALL_INDIRECT_info) {
+      falls_through = (tail->flags & CALL_TAIL) == 0;
+    }
+  }
+  if (falls_through && block->next) {
+    add(block->next);
+  }
+}
+
+void LoopAnalysis::Analyze(HIRBuilder* builder) {
+  blocks_.clear();
+  loops_.clear();
+  for (auto block = builder->first_block(); block; block = block->next) {
+    block->ordinal = uint16_t(blocks_.size());
+    blocks_.push_back(block);
+  }
+  if (blocks_.empty() || blocks_.size() > UINT16_MAX) {
+    // Ordinals are 16-bit; such functions aren't worth analyzing anyway.
+    return;
+  }
+  size_t block_count = blocks_.size();
+
+  successors_.assign(block_count, {});
+  predecessors_.assign(block_count, {});
+  std::vector<Block*> successors;
+  for (uint32_t n = 0; n < block_count; ++n) {
+    GetSuccessors(blocks_[n], &successors);
+    for (auto successor : successors) {
+      successors_[n].push_back(successor->ordinal);
+      predecessors_[successor->ordinal].push_back(n);
+    }
+  }
+
+  ComputeDominators();
+
+  // Any edge into a block that dominates its source is a back edge. The loop
+  // body is everything that can reach the source without passing through the
+  // header.
+  std::vector<int32_t> header_loops(block_count, -1);
+  std::vector<uint32_t> worklist;
+  for (uint32_t source : rpo_) {
+    for (uint32_t header : successors_[source]) {
+      if (!Dominates(header, source)) {
+        continue;
+      }
+      Loop* loop;
+      if (header_loops[header] == -1) {
+        header_loops[header] = int32_t(loops_.size());
+        loops_.push_back(std::make_unique<Loop>());
+        loop = loops_.back().get();
+        loop->header = blocks_[header];
+        loop->membership.resize(block_count);
+        loop->membership[header] = true;
+      } else {
+        loop = loops_[header_loops[header]].get();
+      }
+      if (!loop->membership[source]) {
+        loop->membership[source] = true;
+        worklist.push_back(source);
+      }
+      while (!worklist.empty()) {
+        uint32_t n = worklist.back();
+        worklist.pop_back();
+        for (uint32_t pred : predecessors_[n]) {
+          if (idoms_[pred] != kInvalid && !loop->membership[pred]) {
+            loop->membership[pred] = true;
+            worklist.push_back(pred);
+          }
+        }
+      }
+    }
+  }
+
+  for (auto& loop : loops_) {
+    for (uint32_t n = 0; n < block_count; ++n) {
+      if (loop->membership[n]) {
+        loop->blocks.push_back(blocks_[n]);
+      }
+    }
+
+    // Only an existing preheader is used; the loop has exactly one entering
+    // block and it leads nowhere else.
+    uint32_t header = loop->header->ordinal;
+    uint32_t entering = kInvalid;
+    bool single_entry = true;
+    for (uint32_t pred : predecessors_[header]) {
+      if (loop->membership[pred] || idoms_[pred] == kInvalid) {
+        continue;
+      }
+      if (entering != kInvalid) {
+        single_entry = false;
+        break;
+      }
+      entering = pred;
+    }
+    if (single_entry && entering != kInvalid &&
+        successors_[entering].size() == 1) {
+      loop->preheader = blocks_[entering];
+    }
+  }
+
+  // A loop containing another is always larger, so sorting by size puts inner
+  // loops first and the first larger loop containing the header is the
+  // parent.
+  std::stable_sort(loops_.begin(), loops_.end(),
+                   [](const std::unique_ptr<Loop>& a,
+                      const std::unique_ptr<Loop>& b) {
+                     return a->blocks.size() < b->blocks.size();
+                   });
+  for (size_t i = 0; i < loops_.size(); ++i) {
+    for (size_t j = i + 1; j < loops_.size(); ++j) {
+      if (loops_[j]->blocks.size() > loops_[i]->blocks.size() &&
+          loops_[j]->Contains(loops_[i]->header)) {
+        loops_[i]->parent = loops_[j].get();
+        break;
+      }
+    }
+  }
+}
+
+// Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+void LoopAnalysis::ComputeDominators() {
+  size_t block_count = blocks_.size();
+
+  // Iterative DFS from the entry block for the postorder.
+  rpo_.clear();
+  std::vector<bool> visited(block_count);
+  std::vector<std::pair<uint32_t, size_t>> stack;
+  stack.emplace_back(0, 0);
+  visited[0] = true;
+  while (!stack.empty()) {
+    auto& top = stack.back();
+    uint32_t n = top.first;
+    if (top.second < successors_[n].size()) {
+      uint32_t successor = successors_[n][top.second++];
+      if (!visited[successor]) {
+        visited[successor] = true;
+        stack.emplace_back(successor, 0);
+      }
+    } else {
+      rpo_.push_back(n);
+      stack.pop_back();
+    }
+  }
+  std::reverse(rpo_.begin(), rpo_.end());
+  rpo_index_.assign(block_count, kInvalid);
+  for (uint32_t i = 0; i < rpo_.size(); ++i) {
+    rpo_index_[rpo_[i]] = i;
+  }
+
+  idoms_.assign(block_count, kInvalid);
+  idoms_[0] = 0;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < rpo_.size(); ++i) {
+      uint32_t n = rpo_[i];
+      uint32_t new_idom = kInvalid;
+      for (uint32_t pred : predecessors_[n]) {
+        if (idoms_[pred] == kInvalid) {
+          continue;
+        }
+        if (new_idom == kInvalid) {
+          new_idom = pred;
+          continue;
+        }
+        uint32_t a = pred;
+        uint32_t b = new_idom;
+        while (a != b) {
+          while (rpo_index_[a] > rpo_index_[b]) {
+            a = idoms_[a];
+          }
+          while (rpo_index_[b] > rpo_index_[a]) {
+            b = idoms_[b];
+          }
+        }
+        new_idom = a;
+      }
+      if (idoms_[n] != new_idom) {
+        idoms_[n] = new_idom;
+        changed = true;
+      }
+    }
+  }
+}
+
+bool LoopAnalysis::Dominates(uint32_t a, uint32_t b) const {
+  if (idoms_[a] == kInvalid || idoms_[b] == kInvalid) {
+    return false;
+  }
+  while (true) {
+    if (a == b) {
+      return true;
+    }
+    if (idoms_[b] == b) {
+      return false;
+    }
+    b = idoms_[b];
+  }
+}
+
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,84 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_LOOP_ANALYSIS_H_
+#define XENIA_CPU_COMPILER_LOOP_ANALYSIS_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace xe {
+namespace cpu {
+namespace hir {
+class Block;
+class HIRBuilder;
+}  // namespace hir
+}  // namespace cpu
+}  // namespace xe
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+
+// A natural loop: the header dominates every block in the loop and at least
+// one block in the loop branches back to it.
+struct Loop {
+  hir::Block* header = nullptr;
+  // The single block outside of the loop that enters it, if it only flows
+  // into the header and so can take code hoisted out of the loop.
+  hir::Block* preheader = nullptr;
+  // All blocks in the loop, including the header, in function order.
+  std::vector<hir::Block*> blocks;
+  // Innermost loop containing this one, if any.
+  Loop* parent = nullptr;
+
+  // Indexed by block ordinal.
+  std::vector<bool> membership;
+
+  bool Contains(const hir::Block* block) const;
+};
+
+// Finds the natural loops of a function.
+// Edges are derived from the branches at the tail of each block (as the
+// ControlFlowAnalysisPass does) plus fallthrough into the next block, so the
+// result is valid for the HIR as it stands even if edges are stale.
+// Block ordinals are renumbered in function order.
+class LoopAnalysis {
+ public:
+  void Analyze(hir::HIRBuilder* builder);
+
+  // Loops ordered so that inner loops come before the loops containing them.
+  // Loops sharing a header are merged into one.
+  const std::vector<std::unique_ptr<Loop>>& loops() const { return loops_; }
+
+  // Successors of the block in the flow graph, without duplicates.
+  static void GetSuccessors(hir::Block* block,
+                            std::vector<hir::Block*>* out_successors);
+
+ private:
+  void ComputeDominators();
+  bool Dominates(uint32_t a, uint32_t b) const;
+
+  std::vector<hir::Block*> blocks_;
+  std::vector<std::vector<uint32_t>> successors_;
+  std::vector<std::vector<uint32_t>> predecessors_;
+  // Reverse postorder of reachable blocks and each block's position in it.
+  std::vector<uint32_t> rpo_;
+  std::vector<uint32_t> rpo_index_;
+  // Immediate dominator of each block; kInvalid if unreachable.
+  std::vector<uint32_t> idoms_;
+  std::vector<std::unique_ptr<Loop>> loops_;
+};
+
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_LOOP_ANALYSIS_H_
@@ -23,6 +23,7 @@ class ConstantPropagationPass : public CompilerPass {
   ~ConstantPropagationPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "ConstantPropagation"; }
 
  private:
 };
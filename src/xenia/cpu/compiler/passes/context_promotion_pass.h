@@ -39,6 +39,7 @@ class ContextPromotionPass : public CompilerPass {
   bool Initialize(Compiler* compiler) override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "ContextPromotion"; }
 
  private:
   void PromoteBlock(hir::Block* block);
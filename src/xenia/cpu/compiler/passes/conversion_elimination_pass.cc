@@ -0,0 +1,539 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/conversion_elimination_pass.h"
+
+#include <algorithm>
+
+#include "xenia/base/byte_order.h"
+#include "xenia/base/math.h"
+#include "xenia/base/profiling.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::TypeName;
+using xe::cpu::hir::Value;
+
+namespace {
+
+// Bits of an integer type; 0 for anything else.
+uint64_t GetTypeMask(TypeName type) {
+  switch (type) {
+    case INT8_TYPE:
+      return 0xFF;
+    case INT16_TYPE:
+      return 0xFFFF;
+    case INT32_TYPE:
+      return 0xFFFFFFFF;
+    case INT64_TYPE:
+      return ~0ull;
+    default:
+      return 0;
+  }
+}
+
+// Walks past assignments to the instruction actually computing the value.
+Instr* GetDef(Value* value) {
+  auto def = value->def;
+  while (def && def->opcode == &OPCODE_ASSIGN_info) {
+    def = def->src1.value->def;
+  }
+  return def;
+}
+
+}  // namespace
+
+ConversionEliminationPass::ConversionEliminationPass() : CompilerPass() {}
+
+ConversionEliminationPass::~ConversionEliminationPass() = default;
+
+bool ConversionEliminationPass::Run(HIRBuilder* builder) {
+  // Guest code works on 64-bit registers and big-endian memory, so nearly
+  // every load and store comes wrapped in byte swaps, extends and truncates.
+  // SimplificationPass removes the pairs that directly cancel; this pass
+  // tracks which bits of each value are known to be zero and uses that to
+  // remove the ones it can prove redundant:
+  //   v1.i32 = load_offset v0, 8
+  //   v2.i32 = byte_swap v1
+  //   v3.i64 = zero_extend v2
+  //   v4.i64 = or v3, 0x10
+  //   store_context +40, v4
+  //   v5.i32 = truncate v4
+  //   v6.i32 = byte_swap v5
+  //   store_offset v0, 8, v6
+  //   v7.i32 = load v3
+  // becomes:
+  //   v1.i32 = load_offset v0, 8
+  //   v2.i32 = byte_swap v1
+  //   v3.i64 = zero_extend v2
+  //   v4.i64 = or v3, 0x10
+  //   store_context +40, v4
+  //   v8.i32 = or v1, 0x10000000
+  //   store_offset v0, 8, v8
+  //   v7.i32 = load v3, [zero extended address]
+  // The flag on the last load tells the backend it can use the address as-is
+  // instead of clearing its upper 32 bits first.
+  //
+  // Values are block-local, so a single forward walk sees every definition
+  // before its uses. Replaced instructions become assignments for the
+  // following SimplificationPass and DCE to clean up.
+  SCOPE_profile_cpu_f("cpu");
+
+  known_zeros_.assign(builder->max_value_ordinal(), 0);
+
+  auto block = builder->first_block();
+  while (block) {
+    auto i = block->instr_head;
+    while (i) {
+      switch (i->opcode->num) {
+        case OPCODE_ZERO_EXTEND:
+          CheckZeroExtend(i);
+          break;
+        case OPCODE_SIGN_EXTEND:
+          CheckSignExtend(i);
+          break;
+        case OPCODE_TRUNCATE:
+          CheckTruncate(builder, i);
+          break;
+        case OPCODE_AND:
+          CheckAnd(i);
+          break;
+        case OPCODE_BYTE_SWAP:
+          CheckByteSwap(builder, i);
+          break;
+        case OPCODE_LOAD:
+        case OPCODE_LOAD_OFFSET:
+        case OPCODE_STORE:
+        case OPCODE_STORE_OFFSET:
+          CheckAddress(i);
+          break;
+        default:
+          break;
+      }
+      UpdateKnownZeros(i);
+      i = i->next;
+    }
+    block = block->next;
+  }
+
+  return true;
+}
+
+bool ConversionEliminationPass::CheckZeroExtend(Instr* i) {
+  // Extends of extends only need the innermost value:
+  //   v1.i32 = zero_extend v0.i8
+  //   v2.i64 = zero_extend v1.i32
+  // becomes:
+  //   v2.i64 = zero_extend v0.i8
+  //
+  // Extending a truncated value is a no-op if the truncated bits were zero:
+  //   v1.i64 = and v0.i64, 0xFFFF
+  //   v2.i32 = truncate v1.i64
+  //   v3.i64 = zero_extend v2.i32
+  // becomes:
+  //   v3.i64 = v1.i64
+  auto def = GetDef(i->src1.value);
+  if (!def) {
+    return false;
+  }
+  if (def->opcode == &OPCODE_ZERO_EXTEND_info) {
+    i->set_src1(def->src1.value);
+    return true;
+  } else if (def->opcode == &OPCODE_TRUNCATE_info) {
+    auto value = def->src1.value;
+    uint64_t truncated_mask = GetTypeMask(i->src1.value->type);
+    if (value->type == i->dest->type &&
+        (GetKnownZeros(value) | truncated_mask) == ~0ull) {
+      i->Replace(&OPCODE_ASSIGN_info, 0);
+      i->set_src1(value);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ConversionEliminationPass::CheckSignExtend(Instr* i) {
+  // Same as above, but the truncated value must also have had its new sign
+  // bit clear.
+  auto def = GetDef(i->src1.value);
+  if (!def) {
+    return false;
+  }
+  if (def->opcode == &OPCODE_SIGN_EXTEND_info) {
+    i->set_src1(def->src1.value);
+    return true;
+  } else if (def->opcode == &OPCODE_TRUNCATE_info) {
+    auto value = def->src1.value;
+    uint64_t truncated_mask = GetTypeMask(i->src1.value->type);
+    if (value->type == i->dest->type &&
+        (GetKnownZeros(value) | (truncated_mask >> 1)) == ~0ull) {
+      i->Replace(&OPCODE_ASSIGN_info, 0);
+      i->set_src1(value);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ConversionEliminationPass::CheckTruncate(HIRBuilder* builder, Instr* i) {
+  // Truncates of extends and truncates go straight to the original value:
+  //   v1.i64 = zero_extend v0.i32
+  //   v2.i16 = truncate v1.i64
+  // becomes:
+  //   v2.i16 = truncate v0.i32
+  //
+  // Bitwise operations on extended values are done at the narrower width
+  // instead, so that byte swaps on either side of them can meet:
+  //   v1.i64 = zero_extend v0.i32
+  //   v2.i64 = or v1, 0x10
+  //   v3.i32 = truncate v2
+  // becomes:
+  //   v4.i32 = or v0, 0x10
+  //   v3.i32 = v4
+  // The wide operation stays around if anything else uses it.
+  auto type = i->dest->type;
+  auto def = GetDef(i->src1.value);
+  bool changed = false;
+  while (def && (def->opcode == &OPCODE_TRUNCATE_info ||
+                 def->opcode == &OPCODE_ZERO_EXTEND_info ||
+                 def->opcode == &OPCODE_SIGN_EXTEND_info)) {
+    auto value = def->src1.value;
+    if (value->type == type) {
+      i->Replace(&OPCODE_ASSIGN_info, 0);
+      i->set_src1(value);
+      return true;
+    } else if (GetTypeMask(value->type) < GetTypeMask(type)) {
+      // Narrower than the result: extend it less.
+      i->Replace(def->opcode, 0);
+      i->set_src1(value);
+      return true;
+    }
+    // Still wider; keep walking up the chain.
+    i->set_src1(value);
+    def = GetDef(value);
+    changed = true;
+  }
+  if (!def) {
+    return changed;
+  }
+
+  Value* value1 = nullptr;
+  Value* value2 = nullptr;
+  if (def->opcode == &OPCODE_AND_info || def->opcode == &OPCODE_OR_info ||
+      def->opcode == &OPCODE_XOR_info) {
+    value1 = NarrowOperand(builder, def->src1.value, type);
+    value2 = NarrowOperand(builder, def->src2.value, type);
+    if (!value1 || !value2 ||
+        (value1->IsConstant() && value2->IsConstant())) {
+      return false;
+    }
+  } else if (def->opcode == &OPCODE_NOT_info) {
+    value1 = NarrowOperand(builder, def->src1.value, type);
+    if (!value1 || value1->IsConstant()) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  auto value = EmitBitwise(builder, i, def, value1, value2);
+  i->Replace(&OPCODE_ASSIGN_info, 0);
+  i->set_src1(value);
+  return true;
+}
+
+bool ConversionEliminationPass::CheckAnd(Instr* i) {
+  // Masks that only clear bits that are already zero do nothing:
+  //   v1.i64 = zero_extend v0.i32
+  //   v2.i64 = and v1, 0xFFFFFFFF
+  // becomes:
+  //   v2.i64 = v1
+  Value* value;
+  Value* constant;
+  if (i->src2.value->IsConstant()) {
+    value = i->src1.value;
+    constant = i->src2.value;
+  } else if (i->src1.value->IsConstant()) {
+    value = i->src2.value;
+    constant = i->src1.value;
+  } else {
+    return false;
+  }
+  uint64_t mask = GetTypeMask(i->dest->type);
+  if (!mask || value->IsConstant()) {
+    return false;
+  }
+  if (((GetKnownZeros(value) | constant->AsUint64()) & mask) == mask) {
+    i->Replace(&OPCODE_ASSIGN_info, 0);
+    i->set_src1(value);
+    return true;
+  }
+  return false;
+}
+
+bool ConversionEliminationPass::CheckByteSwap(HIRBuilder* builder,
+                                              Instr* i) {
+  // Bitwise operations commute with byte swaps, so a swapped value that is
+  // only masked before being swapped back doesn't need either swap:
+  //   v1.i32 = byte_swap v0
+  //   v2.i32 = and v1, 0xFFFF0000
+  //   v3.i32 = byte_swap v2
+  // becomes:
+  //   v4.i32 = and v0, 0x0000FFFF
+  //   v3.i32 = v4
+  // This is what a guest read-modify-write of a memory word looks like once
+  // CheckTruncate has narrowed the operation.
+  auto type = i->dest->type;
+  if (type != INT16_TYPE && type != INT32_TYPE && type != INT64_TYPE) {
+    return false;
+  }
+  auto def = GetDef(i->src1.value);
+  if (!def) {
+    return false;
+  }
+  Value* value1 = nullptr;
+  Value* value2 = nullptr;
+  if (def->opcode == &OPCODE_AND_info || def->opcode == &OPCODE_OR_info ||
+      def->opcode == &OPCODE_XOR_info) {
+    value1 = UnswapOperand(builder, def->src1.value);
+    value2 = UnswapOperand(builder, def->src2.value);
+    if (!value1 || !value2 ||
+        (value1->IsConstant() && value2->IsConstant())) {
+      return false;
+    }
+  } else if (def->opcode == &OPCODE_NOT_info) {
+    value1 = UnswapOperand(builder, def->src1.value);
+    if (!value1 || value1->IsConstant()) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  auto value = EmitBitwise(builder, i, def, value1, value2);
+  i->Replace(&OPCODE_ASSIGN_info, 0);
+  i->set_src1(value);
+  return true;
+}
+
+void ConversionEliminationPass::CheckAddress(Instr* i) {
+  // Guest addresses are 32-bit and the backend normally has to clear the
+  // upper half of the register before using it.
+  auto address = i->src1.value;
+  if (address->IsConstant()) {
+    return;
+  }
+  if ((GetKnownZeros(address) >> 32) == 0xFFFFFFFF) {
+    i->flags |= LoadStoreFlags::LOAD_STORE_ADDRESS_ZERO_EXTENDED;
+  }
+}
+
+Value* ConversionEliminationPass::NarrowOperand(HIRBuilder* builder,
+                                                Value* value,
+                                                TypeName type) {
+  // The value truncated to the given type, if that's available for free.
+  if (value->IsConstant()) {
+    auto narrowed = builder->CloneValue(value);
+    narrowed->Truncate(type);
+    return narrowed;
+  }
+  auto def = GetDef(value);
+  if (def &&
+      (def->opcode == &OPCODE_ZERO_EXTEND_info ||
+       def->opcode == &OPCODE_SIGN_EXTEND_info) &&
+      def->src1.value->type == type) {
+    return def->src1.value;
+  }
+  return nullptr;
+}
+
+Value* ConversionEliminationPass::UnswapOperand(HIRBuilder* builder,
+                                                Value* value) {
+  // The value with its bytes swapped, if that's available for free.
+  if (value->IsConstant()) {
+    auto swapped = builder->CloneValue(value);
+    swapped->ByteSwap();
+    return swapped;
+  }
+  auto def = GetDef(value);
+  if (def && def->opcode == &OPCODE_BYTE_SWAP_info) {
+    return def->src1.value;
+  }
+  return nullptr;
+}
+
+Value* ConversionEliminationPass::EmitBitwise(HIRBuilder* builder,
+                                              Instr* insert_point, Instr* op,
+                                              Value* value1, Value* value2) {
+  // Repeats the operation on new operands right before the insertion point.
+  // The builder may fold it away entirely, in which case nothing is added.
+  auto tail = builder->last_instr();
+  Value* result;
+  switch (op->opcode->num) {
+    case OPCODE_AND:
+      result = builder->And(value1, value2);
+      break;
+    case OPCODE_OR:
+      result = builder->Or(value1, value2);
+      break;
+    case OPCODE_XOR:
+      result = builder->Xor(value1, value2);
+      break;
+    case OPCODE_NOT:
+      result = builder->Not(value1);
+      break;
+    default:
+      assert_unhandled_case(op->opcode->num);
+      return nullptr;
+  }
+  auto appended = builder->last_instr();
+  if (appended != tail) {
+    appended->MoveBefore(insert_point);
+    UpdateKnownZeros(appended);
+  }
+  return result;
+}
+
+uint64_t ConversionEliminationPass::GetKnownZeros(Value* value) const {
+  uint64_t mask = GetTypeMask(value->type);
+  if (!mask) {
+    return 0;
+  }
+  if (value->IsConstant()) {
+    return ~(value->AsUint64() & mask);
+  }
+  if (value->ordinal < known_zeros_.size()) {
+    return known_zeros_[value->ordinal] | ~mask;
+  }
+  return ~mask;
+}
+
+void ConversionEliminationPass::UpdateKnownZeros(Instr* i) {
+  auto dest = i->dest;
+  if (!dest) {
+    return;
+  }
+  uint64_t mask = GetTypeMask(dest->type);
+  if (!mask) {
+    return;
+  }
+
+  uint64_t known = 0;
+  switch (i->opcode->num) {
+    case OPCODE_ASSIGN:
+    case OPCODE_ZERO_EXTEND:
+    case OPCODE_TRUNCATE:
+      // Bits above the source type are already set.
+      known = GetKnownZeros(i->src1.value);
+      break;
+    case OPCODE_SIGN_EXTEND: {
+      uint64_t src_mask = GetTypeMask(i->src1.value->type);
+      uint64_t sign_bit = src_mask & ~(src_mask >> 1);
+      known = GetKnownZeros(i->src1.value);
+      if (!(known & sign_bit)) {
+        known &= src_mask;
+      }
+      break;
+    }
+    case OPCODE_AND:
+      known = GetKnownZeros(i->src1.value) | GetKnownZeros(i->src2.value);
+      break;
+    case OPCODE_OR:
+    case OPCODE_XOR:
+      known = GetKnownZeros(i->src1.value) & GetKnownZeros(i->src2.value);
+      break;
+    case OPCODE_SELECT:
+      known = GetKnownZeros(i->src2.value) & GetKnownZeros(i->src3.value);
+      break;
+    case OPCODE_ADD: {
+      // A carry can only set one bit above the highest possibly set bit of
+      // either operand.
+      uint32_t bits = 64 - xe::lzcnt(mask);
+      uint32_t zeros1 =
+          xe::lzcnt(~GetKnownZeros(i->src1.value) & mask) - (64 - bits);
+      uint32_t zeros2 =
+          xe::lzcnt(~GetKnownZeros(i->src2.value) & mask) - (64 - bits);
+      uint32_t zeros = std::min(zeros1, zeros2);
+      if (zeros > 1) {
+        known = mask & ~(mask >> (zeros - 1));
+      }
+      break;
+    }
+    case OPCODE_SHL:
+      if (i->src2.value->IsConstant()) {
+        uint64_t shift = i->src2.value->AsUint64();
+        if (shift < 64 - xe::lzcnt(mask)) {
+          known = (GetKnownZeros(i->src1.value) << shift) |
+                  ((1ull << shift) - 1);
+        }
+      }
+      break;
+    case OPCODE_SHR:
+      if (i->src2.value->IsConstant()) {
+        uint64_t shift = i->src2.value->AsUint64();
+        if (shift < 64 - xe::lzcnt(mask)) {
+          known = ((GetKnownZeros(i->src1.value) & mask) >> shift) |
+                  ~(mask >> shift);
+        }
+      }
+      break;
+    case OPCODE_BYTE_SWAP: {
+      uint64_t src_known = GetKnownZeros(i->src1.value);
+      switch (dest->type) {
+        case INT16_TYPE:
+          known = xe::byte_swap(static_cast<uint16_t>(src_known));
+          break;
+        case INT32_TYPE:
+          known = xe::byte_swap(static_cast<uint32_t>(src_known));
+          break;
+        case INT64_TYPE:
+          known = xe::byte_swap(src_known);
+          break;
+        default:
+          break;
+      }
+      break;
+    }
+    case OPCODE_CNTLZ:
+      known = ~0x7Full;
+      break;
+    case OPCODE_IS_TRUE:
+    case OPCODE_IS_FALSE:
+    case OPCODE_COMPARE_EQ:
+    case OPCODE_COMPARE_NE:
+    case OPCODE_COMPARE_SLT:
+    case OPCODE_COMPARE_SLE:
+    case OPCODE_COMPARE_SGT:
+    case OPCODE_COMPARE_SGE:
+    case OPCODE_COMPARE_ULT:
+    case OPCODE_COMPARE_ULE:
+    case OPCODE_COMPARE_UGT:
+    case OPCODE_COMPARE_UGE:
+      known = ~1ull;
+      break;
+    default:
+      break;
+  }
+
+  if (dest->ordinal >= known_zeros_.size()) {
+    known_zeros_.resize(dest->ordinal + 1);
+  }
+  known_zeros_[dest->ordinal] = known & mask;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,57 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_CONVERSION_ELIMINATION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_CONVERSION_ELIMINATION_PASS_H_
+
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+class ConversionEliminationPass : public CompilerPass {
+ public:
+  ConversionEliminationPass();
+  ~ConversionEliminationPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "ConversionElimination"; }
+
+ private:
+  bool CheckZeroExtend(hir::Instr* i);
+  bool CheckSignExtend(hir::Instr* i);
+  bool CheckTruncate(hir::HIRBuilder* builder, hir::Instr* i);
+  bool CheckAnd(hir::Instr* i);
+  bool CheckByteSwap(hir::HIRBuilder* builder, hir::Instr* i);
+  void CheckAddress(hir::Instr* i);
+  hir::Value* NarrowOperand(hir::HIRBuilder* builder, hir::Value* value,
+                            hir::TypeName type);
+  hir::Value* UnswapOperand(hir::HIRBuilder* builder, hir::Value* value);
+  hir::Value* EmitBitwise(hir::HIRBuilder* builder, hir::Instr* insert_point,
+                          hir::Instr* op, hir::Value* value1,
+                          hir::Value* value2);
+
+  uint64_t GetKnownZeros(hir::Value* value) const;
+  void UpdateKnownZeros(hir::Instr* i);
+
+  // Bits known to be zero, indexed by value ordinal. Bits above the width of
+  // the type are always set.
+  std::vector<uint64_t> known_zeros_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_CONVERSION_ELIMINATION_PASS_H_
@@ -0,0 +1,457 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/compiler/passes/loop_invariant_code_motion_pass.h"
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+
+#include "xenia/base/profiling.h"
+#include "xenia/cpu/compiler/compiler.h"
+#include "xenia/cpu/processor.h"
+
+DECLARE_bool(debug);
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+// TODO(benvanik): remove when enums redefined.
+using namespace xe::cpu::hir;
+
+using xe::cpu::hir::Block;
+using xe::cpu::hir::HIRBuilder;
+using xe::cpu::hir::Instr;
+using xe::cpu::hir::Value;
+
+enum ValueState : uint8_t {
+  kVariant = 0,
+  kInvariant,
+  // Temporarily marked while sizing an expression tree.
+  kVisited,
+  kHoisted,
+};
+
+LoopInvariantCodeMotionPass::LoopInvariantCodeMotionPass()
+    : CompilerPass() {}
+
+LoopInvariantCodeMotionPass::~LoopInvariantCodeMotionPass() {}
+
+bool LoopInvariantCodeMotionPass::Run(HIRBuilder* builder) {
+  // Moves computations that produce the same value on every iteration of a
+  // loop into the block before it:
+  //   preheader:
+  //     branch header
+  //   header:
+  //     v0 = load_context +40     <-- never stored in the loop
+  //     v1 = shl v0, 2
+  //     v2 = add v1, 16
+  //     v3 = load_context +32
+  //     v4 = add v3, v2
+  //     store_context +32, v4
+  //     ...
+  //     branch_true v5, header
+  // becomes:
+  //   preheader:
+  //     v0 = load_context +40
+  //     v1 = shl v0, 2
+  //     v2 = add v1, 16
+  //     store_local l0, v2
+  //     branch header
+  //   header:
+  //     v6 = load_local l0
+  //     v3 = load_context +32
+  //     v4 = add v3, v6
+  //     ...
+  // Values can't live across blocks (the register allocator is block-local),
+  // so hoisted results are carried into the loop in locals. That costs a
+  // stack load per use site, so only expression trees with at least two
+  // instructions are hoisted.
+  SCOPE_profile_cpu_f("cpu");
+
+  slots_.clear();
+  loop_analysis_.Analyze(builder);
+  for (auto& loop : loop_analysis_.loops()) {
+    // Inner loops come first, so code hoisted out of one may be hoisted again
+    // when its parent is processed.
+    if (loop->preheader) {
+      HoistLoop(builder, *loop);
+    }
+  }
+
+  return true;
+}
+
+void LoopInvariantCodeMotionPass::HoistLoop(HIRBuilder* builder,
+                                            const Loop& loop) {
+  // Hoisted code goes at the end of the preheader, before its jump into the
+  // header if it has one. Anything else there (calls, conditional returns)
+  // could change the context so the loop is skipped.
+  Block* preheader = loop.preheader;
+  Instr* insert_point = nullptr;
+  for (auto i = preheader->instr_tail;
+       i && (i->opcode->flags & OPCODE_FLAG_BRANCH); i = i->prev) {
+    if (i->opcode != &OPCODE_BRANCH_info &&
+        i->opcode != &OPCODE_BRANCH_TRUE_info &&
+        i->opcode != &OPCODE_BRANCH_FALSE_info) {
+      return;
+    }
+    insert_point = i;
+  }
+
+  // Context loads are invariant only if nothing in the loop can change the
+  // context behind our back. Float results additionally depend on the
+  // rounding mode, which calls may change.
+  bool has_calls = false;
+  bool has_barriers = false;
+  for (auto block : loop.blocks) {
+    for (auto i = block->instr_head; i; i = i->next) {
+      switch (i->opcode->num) {
+        case OPCODE_SET_ROUNDING_MODE:
+          return;
+        case OPCODE_CALL:
+        case OPCODE_CALL_TRUE:
+        case OPCODE_CALL_INDIRECT:
+        case OPCODE_CALL_INDIRECT_TRUE:
+        case OPCODE_CALL_EXTERN:
+          has_calls = true;
+          break;
+        case OPCODE_DEBUG_BREAK:
+        case OPCODE_DEBUG_BREAK_TRUE:
+        case OPCODE_TRAP:
+        case OPCODE_TRAP_TRUE:
+        case OPCODE_CONTEXT_BARRIER:
+          has_barriers = true;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  context_invariant_ = !has_calls && !has_barriers && !FLAGS_debug;
+  float_invariant_ = !has_calls;
+
+  // Mark invariant values. Values are block-local and blocks are visited in
+  // function order, so operands are always seen before their uses.
+  value_states_.assign(builder->max_value_ordinal(), kVariant);
+  std::vector<Instr*> candidates;
+  for (auto block : loop.blocks) {
+    for (auto i = block->instr_head; i; i = i->next) {
+      if (IsInvariant(loop, i)) {
+        value_states_[i->dest->ordinal] = kInvariant;
+        candidates.push_back(i);
+      }
+    }
+  }
+  if (candidates.empty()) {
+    return;
+  }
+
+  // Roots are invariant values used by code that stays in the loop. Each
+  // root's expression tree is hoisted if it's worth the local load.
+  std::vector<Instr*> roots;
+  for (auto i : candidates) {
+    for (auto use = i->dest->use_head; use; use = use->next) {
+      auto use_dest = use->instr->dest;
+      if (!use_dest || value_states_[use_dest->ordinal] == kVariant) {
+        roots.push_back(i);
+        break;
+      }
+    }
+  }
+  std::vector<Instr*> tree;
+  for (auto root : roots) {
+    tree.clear();
+    uint8_t state = CollectTree(root, &tree) >= 2 ? kHoisted : kInvariant;
+    for (auto i : tree) {
+      value_states_[i->dest->ordinal] = state;
+    }
+  }
+
+  auto is_hoisted = [this](Instr* i) {
+    return i->dest && i->dest->ordinal < value_states_.size() &&
+           value_states_[i->dest->ordinal] == kHoisted;
+  };
+  // Stores into locals added for an inner loop are only done once, so they
+  // move along with the value instead of needing a reload.
+  auto is_carried = [this](Instr* i) {
+    return i->opcode == &OPCODE_STORE_LOCAL_info &&
+           std::find(slots_.begin(), slots_.end(), i->src1.value) !=
+               slots_.end();
+  };
+  std::vector<Instr*> hoisted;
+  uint32_t hoisted_weight = 0;
+  uint32_t load_count = 0;
+  for (auto i : candidates) {
+    if (!is_hoisted(i)) {
+      continue;
+    }
+    hoisted.push_back(i);
+    hoisted_weight += GetWeight(i);
+    for (auto use = i->dest->use_head; use; use = use->next) {
+      if (!is_hoisted(use->instr) && !is_carried(use->instr)) {
+        ++load_count;
+        break;
+      }
+    }
+  }
+  if (hoisted_weight <= load_count) {
+    return;
+  }
+
+  std::vector<Instr*> uses;
+  std::vector<Instr*> carried;
+  for (auto i : hoisted) {
+    Value* dest = i->dest;
+    uses.clear();
+    carried.clear();
+    for (auto use = dest->use_head; use; use = use->next) {
+      if (is_carried(use->instr)) {
+        carried.push_back(use->instr);
+      } else if (!is_hoisted(use->instr)) {
+        uses.push_back(use->instr);
+      }
+    }
+
+    if (!uses.empty()) {
+      // Reload the value in the loop right before its first remaining use.
+      auto first_use = i->next;
+      while (std::find(uses.begin(), uses.end(), first_use) == uses.end()) {
+        first_use = first_use->next;
+      }
+      Value* slot = builder->AllocLocal(dest->type);
+      slots_.push_back(slot);
+      Value* local_value = builder->LoadLocal(slot);
+      local_value->def->MoveBefore(first_use);
+      for (auto use_instr : uses) {
+        if (use_instr->src1.value == dest) {
+          use_instr->set_src1(local_value);
+        }
+        if (use_instr->src2.value == dest) {
+          use_instr->set_src2(local_value);
+        }
+        if (use_instr->src3.value == dest) {
+          use_instr->set_src3(local_value);
+        }
+      }
+
+      MoveToPreheader(i, preheader, insert_point);
+      builder->StoreLocal(slot, dest);
+      MoveToPreheader(builder->last_instr(), preheader, insert_point);
+    } else {
+      MoveToPreheader(i, preheader, insert_point);
+    }
+    for (auto store : carried) {
+      MoveToPreheader(store, preheader, insert_point);
+    }
+  }
+}
+
+bool LoopInvariantCodeMotionPass::IsInvariant(const Loop& loop, Instr* i) {
+  if (!i->dest) {
+    return false;
+  }
+  // Don't split instructions that read flags set by the one before them.
+  if (i->next && (i->next->opcode->flags & OPCODE_FLAG_PAIRED_PREV)) {
+    return false;
+  }
+
+  switch (i->opcode->num) {
+    case OPCODE_LOAD_CONTEXT:
+      return context_invariant_ && !IsContextStored(loop, i);
+    // Pure and unable to fault. Notably DIV is missing as it may trap.
+    case OPCODE_ASSIGN:
+    case OPCODE_CAST:
+    case OPCODE_ZERO_EXTEND:
+    case OPCODE_SIGN_EXTEND:
+    case OPCODE_TRUNCATE:
+    case OPCODE_CONVERT:
+    case OPCODE_ROUND:
+    case OPCODE_VECTOR_CONVERT_I2F:
+    case OPCODE_VECTOR_CONVERT_F2I:
+    case OPCODE_LOAD_VECTOR_SHL:
+    case OPCODE_LOAD_VECTOR_SHR:
+    case OPCODE_MAX:
+    case OPCODE_VECTOR_MAX:
+    case OPCODE_MIN:
+    case OPCODE_VECTOR_MIN:
+    case OPCODE_SELECT:
+    case OPCODE_IS_TRUE:
+    case OPCODE_IS_FALSE:
+    case OPCODE_IS_NAN:
+    case OPCODE_COMPARE_EQ:
+    case OPCODE_COMPARE_NE:
+    case OPCODE_COMPARE_SLT:
+    case OPCODE_COMPARE_SLE:
+    case OPCODE_COMPARE_SGT:
+    case OPCODE_COMPARE_SGE:
+    case OPCODE_COMPARE_ULT:
+    case OPCODE_COMPARE_ULE:
+    case OPCODE_COMPARE_UGT:
+    case OPCODE_COMPARE_UGE:
+    case OPCODE_VECTOR_COMPARE_EQ:
+    case OPCODE_VECTOR_COMPARE_SGT:
+    case OPCODE_VECTOR_COMPARE_SGE:
+    case OPCODE_VECTOR_COMPARE_UGT:
+    case OPCODE_VECTOR_COMPARE_UGE:
+    case OPCODE_ADD:
+    case OPCODE_ADD_CARRY:
+    case OPCODE_VECTOR_ADD:
+    case OPCODE_SUB:
+    case OPCODE_VECTOR_SUB:
+    case OPCODE_MUL:
+    case OPCODE_MUL_HI:
+    case OPCODE_MUL_ADD:
+    case OPCODE_MUL_SUB:
+    case OPCODE_NEG:
+    case OPCODE_ABS:
+    case OPCODE_SQRT:
+    case OPCODE_RSQRT:
+    case OPCODE_RECIP:
+    case OPCODE_POW2:
+    case OPCODE_LOG2:
+    case OPCODE_DOT_PRODUCT_3:
+    case OPCODE_DOT_PRODUCT_4:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_NOT:
+    case OPCODE_SHL:
+    case OPCODE_VECTOR_SHL:
+    case OPCODE_SHR:
+    case OPCODE_VECTOR_SHR:
+    case OPCODE_SHA:
+    case OPCODE_VECTOR_SHA:
+    case OPCODE_ROTATE_LEFT:
+    case OPCODE_VECTOR_ROTATE_LEFT:
+    case OPCODE_VECTOR_AVERAGE:
+    case OPCODE_BYTE_SWAP:
+    case OPCODE_CNTLZ:
+    case OPCODE_INSERT:
+    case OPCODE_EXTRACT:
+    case OPCODE_SPLAT:
+    case OPCODE_PERMUTE:
+    case OPCODE_SWIZZLE:
+    case OPCODE_PACK:
+    case OPCODE_UNPACK:
+      break;
+    default:
+      return false;
+  }
+
+  bool is_float = i->dest->type >= FLOAT32_TYPE;
+  uint32_t signature = i->opcode->signature;
+  Value* srcs[] = {
+      GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V
+          ? i->src1.value
+          : nullptr,
+      GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V
+          ? i->src2.value
+          : nullptr,
+      GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V
+          ? i->src3.value
+          : nullptr,
+  };
+  for (auto src : srcs) {
+    if (!src) {
+      continue;
+    }
+    is_float |= src->type >= FLOAT32_TYPE;
+    // Values defined outside the loop can't be referenced from inside it.
+    if (!src->IsConstant() && value_states_[src->ordinal] != kInvariant) {
+      return false;
+    }
+  }
+  return float_invariant_ || !is_float;
+}
+
+bool LoopInvariantCodeMotionPass::IsContextStored(const Loop& loop,
+                                                  Instr* load) {
+  size_t offset = load->src1.offset;
+  size_t size = GetTypeSize(load->dest->type);
+  for (auto block : loop.blocks) {
+    for (auto i = block->instr_head; i; i = i->next) {
+      if (i->opcode != &OPCODE_STORE_CONTEXT_info) {
+        continue;
+      }
+      size_t store_offset = i->src1.offset;
+      size_t store_size = GetTypeSize(i->src2.value->type);
+      if (store_offset < offset + size && offset < store_offset + store_size) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+uint32_t LoopInvariantCodeMotionPass::GetWeight(Instr* i) {
+  // Assignments are usually folded away.
+  return i->opcode == &OPCODE_ASSIGN_info ? 0 : 1;
+}
+
+uint32_t LoopInvariantCodeMotionPass::CollectTree(Instr* i,
+                                                  std::vector<Instr*>* tree) {
+  // Parts already hoisted with another root are free.
+  if (value_states_[i->dest->ordinal] != kInvariant) {
+    return 0;
+  }
+  value_states_[i->dest->ordinal] = kVisited;
+  tree->push_back(i);
+  uint32_t weight = GetWeight(i);
+  uint32_t signature = i->opcode->signature;
+  if (GET_OPCODE_SIG_TYPE_SRC1(signature) == OPCODE_SIG_TYPE_V &&
+      !i->src1.value->IsConstant()) {
+    weight += CollectTree(i->src1.value->def, tree);
+  }
+  if (GET_OPCODE_SIG_TYPE_SRC2(signature) == OPCODE_SIG_TYPE_V &&
+      !i->src2.value->IsConstant()) {
+    weight += CollectTree(i->src2.value->def, tree);
+  }
+  if (GET_OPCODE_SIG_TYPE_SRC3(signature) == OPCODE_SIG_TYPE_V &&
+      !i->src3.value->IsConstant()) {
+    weight += CollectTree(i->src3.value->def, tree);
+  }
+  return weight;
+}
+
+void LoopInvariantCodeMotionPass::MoveToPreheader(Instr* i, Block* preheader,
+                                                  Instr* insert_point) {
+  if (insert_point) {
+    i->MoveBefore(insert_point);
+    return;
+  }
+
+  // Append to the end of the block.
+  if (i->prev) {
+    i->prev->next = i->next;
+  } else {
+    i->block->instr_head = i->next;
+  }
+  if (i->next) {
+    i->next->prev = i->prev;
+  } else {
+    i->block->instr_tail = i->prev;
+  }
+  i->block = preheader;
+  i->next = nullptr;
+  i->prev = preheader->instr_tail;
+  if (preheader->instr_tail) {
+    preheader->instr_tail->next = i;
+  } else {
+    preheader->instr_head = i;
+  }
+  preheader->instr_tail = i;
+}
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
@@ -0,0 +1,55 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+#define XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
+
+#include <vector>
+
+#include "xenia/cpu/compiler/compiler_pass.h"
+#include "xenia/cpu/compiler/loop_analysis.h"
+
+namespace xe {
+namespace cpu {
+namespace compiler {
+namespace passes {
+
+class LoopInvariantCodeMotionPass : public CompilerPass {
+ public:
+  LoopInvariantCodeMotionPass();
+  ~LoopInvariantCodeMotionPass() override;
+
+  bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "LoopInvariantCodeMotion"; }
+
+ private:
+  void HoistLoop(hir::HIRBuilder* builder, const Loop& loop);
+  bool IsInvariant(const Loop& loop, hir::Instr* i);
+  bool IsContextStored(const Loop& loop, hir::Instr* load);
+  static uint32_t GetWeight(hir::Instr* i);
+  uint32_t CollectTree(hir::Instr* i, std::vector<hir::Instr*>* tree);
+  void MoveToPreheader(hir::Instr* i, hir::Block* preheader,
+                       hir::Instr* insert_point);
+
+  LoopAnalysis loop_analysis_;
+  // State of the loop being processed.
+  bool context_invariant_ = false;
+  bool float_invariant_ = false;
+  // Indexed by value ordinal.
+  std::vector<uint8_t> value_states_;
+  // Locals carrying hoisted values into loops.
+  std::vector<hir::Value*> slots_;
+};
+
+}  // namespace passes
+}  // namespace compiler
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_COMPILER_PASSES_LOOP_INVARIANT_CODE_MOTION_PASS_H_
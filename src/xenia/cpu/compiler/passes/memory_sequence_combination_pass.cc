@@ -62,41 +62,80 @@ void MemorySequenceCombinationPass::CombineLoadSequence(Instr* i) {
   //   v3.i64 = zero_extend v2.i32
   // becomes:
   //   v1.i64 = load_convert v0, [swap|i32->i64,zero]
+  //
+  // Load with swap and store of the original value:
+  //   v1.i32 = load v0
+  //   v2.i32 = byte_swap v1.i32
+  //   store v3, v1.i32
+  // becomes:
+  //   v1.i32 = load v0, [swap]
+  //   v2.i32 = v1.i32
+  //   store v3, v1.i32, [swap]
 
   if (!i->dest->use_head) {
     // No uses of the load result - ignore. Will be killed by DCE.
     return;
   }
 
-  // Ensure all uses of the load result are BYTE_SWAP - if it's mixed we
-  // shouldn't transform as we'd have to introduce new swaps!
+  // Ensure all uses of the load result are BYTE_SWAP or stores of the value
+  // (which can swap it back) - if it's mixed we shouldn't transform as we'd
+  // have to introduce new swaps!
+  bool has_swaps = false;
   auto use = i->dest->use_head;
   while (use) {
-    if (use->instr->opcode != &OPCODE_BYTE_SWAP_info) {
-      // Not a swap.
+    if (use->instr->opcode == &OPCODE_BYTE_SWAP_info) {
+      has_swaps = true;
+    } else if (!IsSwappableStore(use->instr, i->dest)) {
       return;
     }
-    // TODO(benvanik): allow uses by STORE (we can make that swap).
     use = use->next;
   }
+  if (!has_swaps) {
+    // Only stores - nothing to gain.
+    return;
+  }
 
   // Merge byte swap into load.
   // Note that we may have already been a swapped operation - this inverts that.
   i->flags ^= LoadStoreFlags::LOAD_STORE_BYTE_SWAP;
 
   // Replace use of byte swap value with loaded value.
-  // It's byte_swap vN -> assign vN, so not much to do.
+  // It's byte_swap vN -> assign vN, so not much to do. Stores now have to
+  // swap the value back.
   use = i->dest->use_head;
   while (use) {
     auto next_use = use->next;
-    use->instr->opcode = &OPCODE_ASSIGN_info;
-    use->instr->flags = 0;
+    if (use->instr->opcode == &OPCODE_BYTE_SWAP_info) {
+      use->instr->opcode = &OPCODE_ASSIGN_info;
+      use->instr->flags = 0;
+    } else {
+      use->instr->flags ^= LoadStoreFlags::LOAD_STORE_BYTE_SWAP;
+    }
     use = next_use;
   }
 
   // TODO(benvanik): merge in extend/truncate.
 }
 
+bool MemorySequenceCombinationPass::IsSwappableStore(Instr* i, Value* value) {
+  // Only integer stores can be swapped, and only the stored value may be the
+  // loaded one.
+  if (i->opcode == &OPCODE_STORE_info) {
+    if (i->src1.value == value || i->src2.value != value) {
+      return false;
+    }
+  } else if (i->opcode == &OPCODE_STORE_OFFSET_info) {
+    if (i->src1.value == value || i->src2.value == value ||
+        i->src3.value != value) {
+      return false;
+    }
+  } else {
+    return false;
+  }
+  return value->type == INT16_TYPE || value->type == INT32_TYPE ||
+         value->type == INT64_TYPE;
+}
+
 void MemorySequenceCombinationPass::CombineStoreSequence(Instr* i) {
   // Store with swap:
   //   v1.i32 = ...
@@ -29,6 +29,7 @@ class RegisterAllocationPass : public CompilerPass {
   ~RegisterAllocationPass() override;
 
   bool Run(hir::HIRBuilder* builder) override;
+  const char* name() const override { return "RegisterAllocation"; }
 
  private:
   // TODO(benvanik): rewrite all this set shit -- too much indirection, the
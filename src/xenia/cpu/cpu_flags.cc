@@ -27,10 +27,33 @@ DEFINE_bool(trace_function_references, false,
             "Generate tracing for function address references.");
 DEFINE_bool(trace_function_data, false,
             "Generate tracing for function result data.");
+DEFINE_bool(trace_function_atomic_counters, false,
+            "Use locked increments for function trace counters. Counts are "
+            "exact when threads share code but hot paths get much slower; by "
+            "default counts may be slightly low under contention.");
+
+DEFINE_string(guest_profile, "",
+              "Sample guest threads and write folded stacks (flamegraph.pl "
+              "input) to the given path on exit. Linux only.");
+DEFINE_int32(guest_profile_hz, 1000,
+             "Samples per second of thread CPU time for --guest_profile.");
+
+DEFINE_bool(jit_stats, false,
+            "Collect per-pass JIT compile times, HIR instruction counts and "
+            "code sizes, and log them on exit.");
 
 DEFINE_bool(
     disable_global_lock, false,
-    "Disables global lock usage in guest code. Does not affect host code.");
+    "Disables global lock usage in guest code. Does not affect host code. "
+    "Reserved loads/stores do not depend on the lock.");
+DEFINE_bool(reservation_granule_tracking, false,
+            "Version reservation granules so stwcx./stdcx. fail if another "
+            "conditional store hit the granule since lwarx/ldarx, even when "
+            "the value was restored (ABA). Slower conditional stores.");
+
+DEFINE_bool(hoist_loop_invariants, true,
+            "Move loop-invariant computations and context loads out of guest "
+            "loops during compilation.");
 
 DEFINE_bool(validate_hir, false,
             "Perform validation checks on the HIR during compilation.");
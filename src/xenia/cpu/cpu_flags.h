@@ -22,8 +22,17 @@ DECLARE_bool(trace_functions);
 DECLARE_bool(trace_function_coverage);
 DECLARE_bool(trace_function_references);
 DECLARE_bool(trace_function_data);
+DECLARE_bool(trace_function_atomic_counters);
+
+DECLARE_string(guest_profile);
+DECLARE_int32(guest_profile_hz);
+
+DECLARE_bool(jit_stats);
 
 DECLARE_bool(disable_global_lock);
+DECLARE_bool(reservation_granule_tracking);
+
+DECLARE_bool(hoist_loop_invariants);
 
 DECLARE_bool(validate_hir);
 
@@ -37,6 +37,8 @@ enum RoundMode {
 
 enum LoadStoreFlags {
   LOAD_STORE_BYTE_SWAP = 1 << 0,
+  // The upper 32 bits of the address are known to be zero.
+  LOAD_STORE_ADDRESS_ZERO_EXTENDED = 1 << 1,
 };
 
 enum PrefetchFlags {
@@ -259,6 +259,25 @@ bool MMIOHandler::IsRangeWatched(uint32_t physical_address, size_t length) {
   return false;
 }
 
+bool MMIOHandler::IsAnyPageWatched(uint32_t physical_address, size_t length) {
+  // Same rounding as AddPhysicalAccessWatch.
+  uint32_t base_address = physical_address & 0x1FFFFFFF;
+  length = xe::round_up(length + (base_address % xe::memory::page_size()),
+                        xe::memory::page_size());
+  base_address = base_address - (base_address % xe::memory::page_size());
+
+  auto lock = global_critical_region_.Acquire();
+
+  for (auto entry : access_watches_) {
+    if (entry->address < base_address + length &&
+        entry->address + entry->length > base_address) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 bool MMIOHandler::CheckAccessWatch(uint32_t physical_address) {
   auto lock = global_critical_region_.Acquire();
 
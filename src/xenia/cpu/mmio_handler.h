@@ -80,6 +80,10 @@ class MMIOHandler {
   // Returns true if /all/ of this range is watched.
   bool IsRangeWatched(uint32_t physical_address, size_t length);
 
+  // Returns true if any watch overlaps the pages spanning this range; adding a
+  // watch on the range would fire all of them.
+  bool IsAnyPageWatched(uint32_t physical_address, size_t length);
+
  protected:
   struct AccessWatchEntry {
     uint32_t address;
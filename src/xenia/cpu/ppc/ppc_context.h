@@ -425,6 +425,15 @@ typedef struct PPCContext_s {
 
   // Value of last reserved load
   uint64_t reserved_val;
+  // Guest address of the last reserved load, or kNoReservation once a
+  // conditional store has consumed it.
+  uint64_t reserved_addr;
+  // Reservation granule version observed by the last reserved load; only
+  // used with --reservation_granule_tracking.
+  uint64_t reserved_version;
+  uint8_t padding[48];  // Keeps the context 64b padded.
+
+  static const uint64_t kNoReservation = ~0ull;
 
   static std::string GetRegisterName(PPCRegister reg);
   std::string GetStringFromValue(PPCRegister reg) const;
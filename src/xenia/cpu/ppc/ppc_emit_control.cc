@@ -704,9 +704,11 @@ int InstrEmit_mtspr(PPCHIRBuilder& f, const InstrData& i) {
 }
 
 // MSR is used for toggling interrupts (among other things).
-// We track it here for taking a global processor lock, as lots of lockfree
-// code requires it. Sequences of mtmsr/lwar/stcw/mtmsr come up a lot, and
-// without the lock here threads can livelock.
+// We track it here for taking a global processor lock, as code that disables
+// interrupts expects to run exclusively. Reserved loads/stores inside
+// mtmsr/lwarx/stwcx./mtmsr sequences no longer rely on this lock (see
+// ppc_emit_memory.cc), so --disable_global_lock only affects that
+// exclusivity.
 
 int InstrEmit_mfmsr(PPCHIRBuilder& f, const InstrData& i) {
   // bit 48 = EE; interrupt enabled
@@ -10,7 +10,9 @@
 #include "xenia/cpu/ppc/ppc_emit-private.h"
 
 #include "xenia/base/assert.h"
+#include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/ppc/ppc_context.h"
+#include "xenia/cpu/ppc/ppc_frontend.h"
 #include "xenia/cpu/ppc/ppc_hir_builder.h"
 
 #include <stddef.h>
@@ -723,6 +725,80 @@ int InstrEmit_isync(PPCHIRBuilder& f, const InstrData& i) {
   return 0;
 }
 
+// Reservations are kept per thread in the context (address and value) and
+// conditional stores use a host compare-exchange, so atomic sequences need no
+// global lock and threads only contend on the memory they actually share.
+// The compare-exchange alone cannot see a value changed and changed back
+// (ABA); --reservation_granule_tracking additionally versions each granule on
+// every conditional store to catch that, at the cost of a host call.
+
+int InstrEmit_larx_(PPCHIRBuilder& f, const InstrData& i, TypeName type) {
+  Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+  if (FLAGS_reservation_granule_tracking) {
+    // Snapshot the granule version before loading so that a conditional
+    // store landing in between fails ours.
+    f.StoreReserved(ea, f.LoadZeroInt64());
+    f.CallExtern(f.builtins()->reserve_granule);
+    ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+  }
+
+  // We issue a memory barrier here to make sure that we get good values.
+  f.MemoryBarrier();
+
+  Value* rt = f.ByteSwap(f.Load(ea, type));
+  if (type != INT64_TYPE) {
+    rt = f.ZeroExtend(rt, INT64_TYPE);
+  }
+  f.StoreReserved(ea, rt);
+  f.StoreGPR(i.X.RT, rt);
+  return 0;
+}
+
+int InstrEmit_stcx_(PPCHIRBuilder& f, const InstrData& i, TypeName type) {
+  // The store is only performed if this thread still holds a reservation on
+  // EA. Any conditional store consumes the reservation.
+  Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+  auto fail_label = f.NewLabel();
+  auto end_label = f.NewLabel();
+  f.BranchFalse(
+      f.CompareEQ(f.ZeroExtend(f.Truncate(ea, INT32_TYPE), INT64_TYPE),
+                  f.LoadReservedAddress()),
+      fail_label);
+  if (FLAGS_reservation_granule_tracking) {
+    f.StoreContext(offsetof(PPCContext, scratch), f.LoadGPR(i.X.RT));
+    f.CallExtern(type == INT64_TYPE ? f.builtins()->store_conditional_64
+                                    : f.builtins()->store_conditional_32);
+    f.StoreContext(
+        offsetof(PPCContext, cr0.cr0_eq),
+        f.Truncate(f.LoadContext(offsetof(PPCContext, scratch), INT64_TYPE),
+                   INT8_TYPE));
+  } else {
+    // NOTE: need to recalculate ea after the branch as we are in a new block.
+    ea = CalculateEA_0(f, i.X.RA, i.X.RB);
+    Value* rt = f.LoadGPR(i.X.RT);
+    Value* res = f.LoadReserved();
+    if (type != INT64_TYPE) {
+      rt = f.Truncate(rt, type);
+      res = f.Truncate(res, type);
+    }
+    Value* v = f.AtomicCompareExchange(ea, f.ByteSwap(res), f.ByteSwap(rt));
+    f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), v);
+  }
+  f.Branch(end_label);
+  f.MarkLabel(fail_label);
+  f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), f.LoadZeroInt8());
+  f.MarkLabel(end_label);
+
+  f.ClearReserved();
+  f.StoreContext(offsetof(PPCContext, cr0.cr0_lt), f.LoadZeroInt8());
+  f.StoreContext(offsetof(PPCContext, cr0.cr0_gt), f.LoadZeroInt8());
+
+  // Issue memory barrier so others see our updates.
+  f.MemoryBarrier();
+
+  return 0;
+}
+
 int InstrEmit_ldarx(PPCHIRBuilder& f, const InstrData& i) {
   // if RA = 0 then
   //   b <- 0
@@ -733,19 +809,7 @@ int InstrEmit_ldarx(PPCHIRBuilder& f, const InstrData& i) {
   // RESERVE_LENGTH <- 8
   // RESERVE_ADDR <- real_addr(EA)
   // RT <- MEM(EA, 8)
-
-  // NOTE: we assume we are within a global lock.
-  // We could assert here that the block (or its parent) has taken a global lock
-  // already, but I haven't see anything but interrupt callbacks (which are
-  // always under a global lock) do that yet.
-  // We issue a memory barrier here to make sure that we get good values.
-  f.MemoryBarrier();
-
-  Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
-  Value* rt = f.ByteSwap(f.Load(ea, INT64_TYPE));
-  f.StoreReserved(rt);
-  f.StoreGPR(i.X.RT, rt);
-  return 0;
+  return InstrEmit_larx_(f, i, INT64_TYPE);
 }
 
 int InstrEmit_lwarx(PPCHIRBuilder& f, const InstrData& i) {
@@ -758,19 +822,7 @@ int InstrEmit_lwarx(PPCHIRBuilder& f, const InstrData& i) {
   // RESERVE_LENGTH <- 4
   // RESERVE_ADDR <- real_addr(EA)
   // RT <- i32.0 || MEM(EA, 4)
-
-  // NOTE: we assume we are within a global lock.
-  // We could assert here that the block (or its parent) has taken a global lock
-  // already, but I haven't see anything but interrupt callbacks (which are
-  // always under a global lock) do that yet.
-  // We issue a memory barrier here to make sure that we get good values.
-  f.MemoryBarrier();
-
-  Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
-  Value* rt = f.ZeroExtend(f.ByteSwap(f.Load(ea, INT32_TYPE)), INT64_TYPE);
-  f.StoreReserved(rt);
-  f.StoreGPR(i.X.RT, rt);
-  return 0;
+  return InstrEmit_larx_(f, i, INT32_TYPE);
 }
 
 int InstrEmit_stdcx(PPCHIRBuilder& f, const InstrData& i) {
@@ -783,27 +835,7 @@ int InstrEmit_stdcx(PPCHIRBuilder& f, const InstrData& i) {
   // MEM(EA, 8) <- (RS)
   // n <- 1 if store performed
   // CR0[LT GT EQ SO] = 0b00 || n || XER[SO]
-
-  // NOTE: we assume we are within a global lock.
-  // As we have been exclusively executing this entire time, we assume that no
-  // one else could have possibly touched the memory and must always succeed.
-  // We use atomic compare exchange here to support reserved load/store without
-  // being under the global lock (flag disable_global_lock - see mtmsr/mtmsrd).
-  // This will always succeed if under the global lock, however.
-
-  Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
-  Value* rt = f.ByteSwap(f.LoadGPR(i.X.RT));
-  Value* res = f.ByteSwap(f.LoadReserved());
-  Value* v = f.AtomicCompareExchange(ea, res, rt);
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), v);
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_lt), f.LoadZeroInt8());
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_gt), f.LoadZeroInt8());
-
-  // Issue memory barrier for when we go out of lock and want others to see our
-  // updates.
-  f.MemoryBarrier();
-
-  return 0;
+  return InstrEmit_stcx_(f, i, INT64_TYPE);
 }
 
 int InstrEmit_stwcx(PPCHIRBuilder& f, const InstrData& i) {
@@ -816,27 +848,7 @@ int InstrEmit_stwcx(PPCHIRBuilder& f, const InstrData& i) {
   // MEM(EA, 4) <- (RS)[32:63]
   // n <- 1 if store performed
   // CR0[LT GT EQ SO] = 0b00 || n || XER[SO]
-
-  // NOTE: we assume we are within a global lock.
-  // As we have been exclusively executing this entire time, we assume that no
-  // one else could have possibly touched the memory and must always succeed.
-  // We use atomic compare exchange here to support reserved load/store without
-  // being under the global lock (flag disable_global_lock - see mtmsr/mtmsrd).
-  // This will always succeed if under the global lock, however.
-
-  Value* ea = CalculateEA_0(f, i.X.RA, i.X.RB);
-  Value* rt = f.ByteSwap(f.Truncate(f.LoadGPR(i.X.RT), INT32_TYPE));
-  Value* res = f.ByteSwap(f.Truncate(f.LoadReserved(), INT32_TYPE));
-  Value* v = f.AtomicCompareExchange(ea, res, rt);
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_eq), v);
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_lt), f.LoadZeroInt8());
-  f.StoreContext(offsetof(PPCContext, cr0.cr0_gt), f.LoadZeroInt8());
-
-  // Issue memory barrier for when we go out of lock and want others to see our
-  // updates.
-  f.MemoryBarrier();
-
-  return 0;
+  return InstrEmit_stcx_(f, i, INT32_TYPE);
 }
 
 // Floating-point load (A-19)
@@ -10,6 +10,8 @@
 #include "xenia/cpu/ppc/ppc_frontend.h"
 
 #include "xenia/base/atomic.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/threading.h"
 #include "xenia/cpu/ppc/ppc_context.h"
 #include "xenia/cpu/ppc/ppc_emit.h"
 #include "xenia/cpu/ppc/ppc_opcode_info.h"
@@ -78,6 +80,54 @@ void LeaveGlobalLock(PPCContext* ppc_context, void* arg0, void* arg1) {
   global_mutex->unlock();
 }
 
+// Reservations are tracked per 128b granule (the Xenon cache line). Granules
+// are hashed into a fixed table; collisions only cause spurious conditional
+// store failures, which guest code retries.
+const uint32_t kReservationGranuleShift = 7;
+const uint32_t kReservationTableSize = 64 * 1024;
+
+std::atomic<uint32_t>* LookupGranule(std::atomic<uint32_t>* versions,
+                                     uint64_t address) {
+  return &versions[(address >> kReservationGranuleShift) &
+                   (kReservationTableSize - 1)];
+}
+
+// Records the version of the granule holding reserved_addr. Called by
+// lwarx/ldarx before the reserved load.
+void ReserveGranule(PPCContext* ppc_context, void* arg0, void* arg1) {
+  auto version = LookupGranule(reinterpret_cast<std::atomic<uint32_t>*>(arg0),
+                               ppc_context->reserved_addr);
+  uint32_t value;
+  while ((value = version->load(std::memory_order_acquire)) & 1) {
+    // Another thread is mid conditional store.
+    xe::threading::MaybeYield();
+  }
+  ppc_context->reserved_version = value;
+}
+
+// Performs stwcx./stdcx. of scratch to reserved_addr, which the caller has
+// checked matches the store address. The store only happens if no other
+// conditional store has touched the granule since the reservation and the
+// memory still holds reserved_val. scratch is set to 1 on success, else 0.
+template <typename T>
+void StoreConditional(PPCContext* ppc_context, void* arg0, void* arg1) {
+  auto version = LookupGranule(reinterpret_cast<std::atomic<uint32_t>*>(arg0),
+                               ppc_context->reserved_addr);
+  uint32_t expected = uint32_t(ppc_context->reserved_version);
+  if (!version->compare_exchange_strong(expected, expected | 1,
+                                        std::memory_order_acquire)) {
+    ppc_context->scratch = 0;
+    return;
+  }
+  auto host_address = reinterpret_cast<volatile T*>(
+      ppc_context->virtual_membase + uint32_t(ppc_context->reserved_addr));
+  bool stored = xe::atomic_cas(
+      xe::byte_swap(static_cast<T>(ppc_context->reserved_val)),
+      xe::byte_swap(static_cast<T>(ppc_context->scratch)), host_address);
+  version->store(stored ? expected + 2 : expected, std::memory_order_release);
+  ppc_context->scratch = stored ? 1 : 0;
+}
+
 bool PPCFrontend::Initialize() {
   void* arg0 = reinterpret_cast<void*>(&xe::global_critical_region::mutex());
   void* arg1 = reinterpret_cast<void*>(&builtins_.global_lock_count);
@@ -87,6 +137,16 @@ bool PPCFrontend::Initialize() {
       processor_->DefineBuiltin("EnterGlobalLock", EnterGlobalLock, arg0, arg1);
   builtins_.leave_global_lock =
       processor_->DefineBuiltin("LeaveGlobalLock", LeaveGlobalLock, arg0, arg1);
+
+  reservation_versions_.reset(
+      new std::atomic<uint32_t>[kReservationTableSize]());
+  void* versions = reinterpret_cast<void*>(reservation_versions_.get());
+  builtins_.reserve_granule = processor_->DefineBuiltin(
+      "ReserveGranule", ReserveGranule, versions, nullptr);
+  builtins_.store_conditional_32 = processor_->DefineBuiltin(
+      "StoreConditional32", StoreConditional<uint32_t>, versions, nullptr);
+  builtins_.store_conditional_64 = processor_->DefineBuiltin(
+      "StoreConditional64", StoreConditional<uint64_t>, versions, nullptr);
   return true;
 }
 
@@ -10,6 +10,7 @@
 #ifndef XENIA_CPU_PPC_PPC_FRONTEND_H_
 #define XENIA_CPU_PPC_PPC_FRONTEND_H_
 
+#include <atomic>
 #include <memory>
 
 #include "xenia/base/type_pool.h"
@@ -33,6 +34,10 @@ struct PPCBuiltins {
   Function* check_global_lock;
   Function* enter_global_lock;
   Function* leave_global_lock;
+  // Reservation granule tracking (--reservation_granule_tracking).
+  Function* reserve_granule;
+  Function* store_conditional_32;
+  Function* store_conditional_64;
 };
 
 class PPCFrontend {
@@ -52,6 +57,9 @@ class PPCFrontend {
  private:
   Processor* processor_;
   PPCBuiltins builtins_ = {0};
+  // Version per reservation granule; odd while a conditional store is in
+  // progress.
+  std::unique_ptr<std::atomic<uint32_t>[]> reservation_versions_;
   TypePool<PPCTranslator, PPCFrontend*> translator_pool_;
 };
 
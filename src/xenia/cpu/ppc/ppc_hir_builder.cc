@@ -544,8 +544,10 @@ void PPCHIRBuilder::StoreVR(uint32_t reg, Value* value) {
   trace_reg.value = value;
 }
 
-void PPCHIRBuilder::StoreReserved(Value* val) {
+void PPCHIRBuilder::StoreReserved(Value* ea, Value* val) {
   assert_true(val->type == INT64_TYPE);
+  StoreContext(offsetof(PPCContext, reserved_addr),
+               ZeroExtend(Truncate(ea, INT32_TYPE), INT64_TYPE));
   StoreContext(offsetof(PPCContext, reserved_val), val);
 }
 
@@ -553,6 +555,15 @@ Value* PPCHIRBuilder::LoadReserved() {
   return LoadContext(offsetof(PPCContext, reserved_val), INT64_TYPE);
 }
 
+Value* PPCHIRBuilder::LoadReservedAddress() {
+  return LoadContext(offsetof(PPCContext, reserved_addr), INT64_TYPE);
+}
+
+void PPCHIRBuilder::ClearReserved() {
+  StoreContext(offsetof(PPCContext, reserved_addr),
+               LoadConstantUint64(PPCContext::kNoReservation));
+}
+
 }  // namespace ppc
 }  // namespace cpu
 }  // namespace xe
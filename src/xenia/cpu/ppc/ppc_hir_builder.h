@@ -78,8 +78,11 @@ class PPCHIRBuilder : public hir::HIRBuilder {
   Value* LoadVR(uint32_t reg);
   void StoreVR(uint32_t reg, Value* value);
 
-  void StoreReserved(Value* val);
+  // Records a reservation on the (32-bit) guest address ea holding val.
+  void StoreReserved(Value* ea, Value* val);
   Value* LoadReserved();
+  Value* LoadReservedAddress();
+  void ClearReserved();
 
  private:
   void MaybeBreakOnInstruction(uint32_t address);
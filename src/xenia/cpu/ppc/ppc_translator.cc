@@ -16,6 +16,7 @@
 #include "xenia/base/memory.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/reset_scope.h"
+#include "xenia/cpu/compile_stats.h"
 #include "xenia/cpu/compiler/compiler_passes.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
@@ -57,6 +58,9 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   compiler_->AddPass(std::make_unique<passes::ConstantPropagationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  // Cancels swaps and conversions so more of them fold into loads/stores.
+  compiler_->AddPass(std::make_unique<passes::ConversionEliminationPass>());
+  if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
   if (backend->machine_info()->supports_extended_load_store) {
     // Backend supports the advanced LOAD/STORE instructions.
     // These will save us a lot of HIR opcodes.
@@ -67,6 +71,14 @@ PPCTranslator::PPCTranslator(PPCFrontend* frontend) : frontend_(frontend) {
   }
   compiler_->AddPass(std::make_unique<passes::SimplificationPass>());
   if (validate) compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  if (FLAGS_hoist_loop_invariants) {
+    // Runs once the loop bodies are as small as they will get. Leaves dead
+    // code behind for DCE.
+    compiler_->AddPass(
+        std::make_unique<passes::LoopInvariantCodeMotionPass>());
+    if (validate)
+      compiler_->AddPass(std::make_unique<passes::ValidationPass>());
+  }
   // compiler_->AddPass(std::make_unique<passes::DeadStoreEliminationPass>());
   // if (validate)
   // compiler_->AddPass(std::make_unique<passes::ValidationPass>());
@@ -122,10 +134,20 @@ bool PPCTranslator::Translate(GuestFunction* function,
     debug_info.reset(new FunctionDebugInfo());
   }
 
+  // Only timed when requested, as counting HIR between passes is not free.
+  auto compile_stats = frontend_->processor()->compile_stats();
+  FunctionCompileStats stats;
+  auto start_time =
+      compile_stats ? CompileStats::Now() : CompileStats::TimePoint();
+  auto stage_time = start_time;
+
   // Scan the function to find its extents and gather debug data.
   if (!scanner_->Scan(function, debug_info.get())) {
     return false;
   }
+  if (compile_stats) {
+    stats.scan_ns = CompileStats::ElapsedNs(stage_time);
+  }
 
   // Setup trace data, if needed.
   if (debug_info_flags & DebugInfoFlags::kDebugInfoTraceFunctions) {
@@ -160,9 +182,15 @@ bool PPCTranslator::Translate(GuestFunction* function,
   if (debug_info) {
     emit_flags |= PPCHIRBuilder::EMIT_DEBUG_COMMENTS;
   }
+  if (compile_stats) {
+    stage_time = CompileStats::Now();
+  }
   if (!builder_->Emit(function, emit_flags)) {
     return false;
   }
+  if (compile_stats) {
+    stats.hir_emit_ns = CompileStats::ElapsedNs(stage_time);
+  }
 
   // Stash raw HIR.
   if (debug_info_flags & DebugInfoFlags::kDebugInfoDisasmRawHir) {
@@ -172,7 +200,7 @@ bool PPCTranslator::Translate(GuestFunction* function,
   }
 
   // Compile/optimize/etc.
-  if (!compiler_->Compile(builder_.get())) {
+  if (!compiler_->Compile(builder_.get(), compile_stats ? &stats : nullptr)) {
     return false;
   }
 
@@ -184,11 +212,23 @@ bool PPCTranslator::Translate(GuestFunction* function,
   }
 
   // Assemble to backend machine code.
+  if (compile_stats) {
+    stage_time = CompileStats::Now();
+  }
   if (!assembler_->Assemble(function, builder_.get(), debug_info_flags,
                             std::move(debug_info))) {
     return false;
   }
 
+  if (compile_stats) {
+    stats.assemble_ns = CompileStats::ElapsedNs(stage_time);
+    stats.total_ns = CompileStats::ElapsedNs(start_time);
+    stats.guest_address = function->address();
+    stats.guest_size = function->end_address() - function->address() + 4;
+    stats.host_size = uint32_t(function->machine_code_length());
+    compile_stats->Record(stats);
+  }
+
   return true;
 }
 
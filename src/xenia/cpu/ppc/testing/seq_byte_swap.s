@@ -0,0 +1,47 @@
+test_byte_swap_1:
+  # Read-modify-write of a word; the swaps around the or cancel.
+  #_ MEMORY_IN 10001050 11223344 CCCCCCCC
+  #_ REGISTER_IN r4 0x10001050
+  lwz r3, 0(r4)
+  ori r3, r3, 0x10
+  lbz r5, 4(r4)
+  extsb r6, r5
+  stw r3, 4(r4)
+  blr
+  #_ REGISTER_OUT r3 0x11223354
+  #_ REGISTER_OUT r4 0x10001050
+  #_ REGISTER_OUT r5 0xCC
+  #_ REGISTER_OUT r6 0xFFFFFFFFFFFFFFCC
+  #_ MEMORY_OUT 10001050 11223344 11223354
+
+test_byte_swap_2:
+  # Pointer chasing; the loaded pointer is already zero extended.
+  #_ MEMORY_IN 10001050 10001058 00000010 AABBCCDD 12345678
+  #_ REGISTER_IN r4 0x10001050
+  lwz r3, 0(r4)
+  lwz r5, 4(r3)
+  lhz r6, 0(r3)
+  blr
+  #_ REGISTER_OUT r3 0x10001058
+  #_ REGISTER_OUT r4 0x10001050
+  #_ REGISTER_OUT r5 0x12345678
+  #_ REGISTER_OUT r6 0xAABB
+
+test_byte_swap_3:
+  # Copies and bitwise ops on loaded values.
+  #_ MEMORY_IN 10001050 10001058 00000010 AABBCCDD 12345678
+  #_ REGISTER_IN r4 0x10001050
+  lwz r3, 8(r4)
+  lwz r5, 12(r4)
+  xor r6, r3, r5
+  nor r6, r6, r6
+  stw r6, 0(r4)
+  lhz r7, 8(r4)
+  sth r7, 6(r4)
+  blr
+  #_ REGISTER_OUT r3 0xAABBCCDD
+  #_ REGISTER_OUT r4 0x10001050
+  #_ REGISTER_OUT r5 0x12345678
+  #_ REGISTER_OUT r6 0xFFFFFFFF4770655A
+  #_ REGISTER_OUT r7 0xAABB
+  #_ MEMORY_OUT 10001050 4770655A 0000AABB AABBCCDD 12345678
@@ -0,0 +1,63 @@
+test_loop_invariant_1:
+  # (r5 << 2) + r6 is the same on every iteration.
+  #_ REGISTER_IN r4 10
+  #_ REGISTER_IN r5 5
+  #_ REGISTER_IN r6 7
+  li r3, 0
+  mtctr r4
+loop_invariant_1_loop:
+  slwi r7, r5, 2
+  add r7, r7, r6
+  add r3, r3, r7
+  bdnz loop_invariant_1_loop
+  blr
+  #_ REGISTER_OUT r3 270
+  #_ REGISTER_OUT r4 10
+  #_ REGISTER_OUT r5 5
+  #_ REGISTER_OUT r6 7
+  #_ REGISTER_OUT r7 27
+
+test_loop_invariant_2:
+  # r5 changes in the loop, so nothing may be hoisted.
+  #_ REGISTER_IN r4 10
+  #_ REGISTER_IN r5 5
+  #_ REGISTER_IN r6 7
+  li r3, 0
+  mtctr r4
+loop_invariant_2_loop:
+  slwi r7, r5, 2
+  add r7, r7, r6
+  add r3, r3, r7
+  addi r5, r5, 1
+  bdnz loop_invariant_2_loop
+  blr
+  #_ REGISTER_OUT r3 450
+  #_ REGISTER_OUT r4 10
+  #_ REGISTER_OUT r5 15
+  #_ REGISTER_OUT r6 7
+  #_ REGISTER_OUT r7 63
+
+test_loop_invariant_3:
+  # Invariant in both the inner and the outer loop.
+  #_ REGISTER_IN r4 4
+  #_ REGISTER_IN r5 5
+  #_ REGISTER_IN r6 7
+  li r3, 0
+  li r8, 3
+loop_invariant_3_outer:
+  mtctr r4
+loop_invariant_3_inner:
+  mullw r7, r5, r6
+  addi r7, r7, 1
+  add r3, r3, r7
+  bdnz loop_invariant_3_inner
+  addi r8, r8, -1
+  cmpwi r8, 0
+  bne loop_invariant_3_outer
+  blr
+  #_ REGISTER_OUT r3 432
+  #_ REGISTER_OUT r4 4
+  #_ REGISTER_OUT r5 5
+  #_ REGISTER_OUT r6 7
+  #_ REGISTER_OUT r7 36
+  #_ REGISTER_OUT r8 0
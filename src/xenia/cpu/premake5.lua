@@ -20,5 +20,24 @@ project("xenia-cpu")
   local_platform_files("hir")
   local_platform_files("ppc")
 
+project("xenia-cpu-trace-dump")
+  uuid("7c4b2f1e-93d5-4a8b-b6e2-51f0d8a3c947")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "gflags",
+    "xenia-base",
+  })
+  includedirs({
+    project_root.."/third_party/gflags/src",
+  })
+  files({
+    "trace_data_dump_main.cc",
+    project_root.."/src/xenia/base/main_"..platform_suffix..".cc",
+  })
+  resincludedirs({
+    project_root,
+  })
+
 include("testing")
 include("ppc/testing")
@@ -22,11 +22,13 @@
 #include "xenia/base/profiling.h"
 #include "xenia/base/threading.h"
 #include "xenia/cpu/breakpoint.h"
+#include "xenia/cpu/compile_stats.h"
 #include "xenia/cpu/cpu_flags.h"
 #include "xenia/cpu/export_resolver.h"
 #include "xenia/cpu/module.h"
 #include "xenia/cpu/ppc/ppc_decode_data.h"
 #include "xenia/cpu/ppc/ppc_frontend.h"
+#include "xenia/cpu/sampling_profiler.h"
 #include "xenia/cpu/stack_walker.h"
 #include "xenia/cpu/thread.h"
 #include "xenia/cpu/thread_state.h"
@@ -81,6 +83,14 @@ Processor::Processor(xe::Memory* memory, ExportResolver* export_resolver)
     : memory_(memory), export_resolver_(export_resolver) {}
 
 Processor::~Processor() {
+  // Symbolizing samples needs the functions, so write before unloading.
+  if (sampling_profiler_) {
+    sampling_profiler_->WriteFoldedStacks(
+        xe::to_wstring(FLAGS_guest_profile));
+    sampling_profiler_.reset();
+  }
+  DumpCompileStats();
+
   {
     auto global_lock = global_critical_region_.Acquire();
     modules_.clear();
@@ -145,9 +155,31 @@ bool Processor::Setup(std::unique_ptr<backend::Backend> backend) {
         functions_trace_path_, 32 * 1024 * 1024, true);
   }
 
+  if (FLAGS_jit_stats) {
+    compile_stats_ = std::make_unique<CompileStats>();
+  }
+
+  if (!FLAGS_guest_profile.empty()) {
+    if (FLAGS_guest_profile_hz <= 0 ||
+        uint32_t(FLAGS_guest_profile_hz) >
+            SamplingProfiler::kMaxFrequencyHz) {
+      XELOGE("--guest_profile_hz=%d out of range [1, %u]; not profiling",
+             FLAGS_guest_profile_hz, SamplingProfiler::kMaxFrequencyHz);
+    } else {
+      sampling_profiler_ =
+          SamplingProfiler::Create(this, uint32_t(FLAGS_guest_profile_hz));
+    }
+  }
+
   return true;
 }
 
+void Processor::DumpCompileStats() {
+  if (compile_stats_) {
+    compile_stats_->Dump();
+  }
+}
+
 void Processor::PreLaunch() {
   if (FLAGS_break_on_start) {
     // Start paused.
@@ -326,6 +358,10 @@ bool Processor::Execute(ThreadState* thread_state, uint32_t address) {
     return false;
   }
 
+  return Execute(thread_state, function);
+}
+
+bool Processor::Execute(ThreadState* thread_state, Function* function) {
   auto context = thread_state->context();
 
   // Pad out stack a bit, as some games seem to overwrite the caller by about
@@ -365,6 +401,16 @@ uint64_t Processor::Execute(ThreadState* thread_state, uint32_t address,
                             uint64_t args[], size_t arg_count) {
   SCOPE_profile_cpu_f("cpu");
 
+  auto function = ResolveFunction(address);
+  if (!function) {
+    XELOGCPU("Execute(%.8X): failed to find function", address);
+    return 0xDEADBABE;
+  }
+  return Execute(thread_state, function, args, arg_count);
+}
+
+uint64_t Processor::Execute(ThreadState* thread_state, Function* function,
+                            uint64_t args[], size_t arg_count) {
   auto context = thread_state->context();
   for (size_t i = 0; i < std::min(arg_count, static_cast<size_t>(8)); ++i) {
     context->r[3 + i] = args[i];
@@ -381,7 +427,7 @@ uint64_t Processor::Execute(ThreadState* thread_state, uint32_t address,
     }
   }
 
-  if (!Execute(thread_state, address)) {
+  if (!Execute(thread_state, function)) {
     return 0xDEADBABE;
   }
   return context->r[3];
@@ -496,6 +542,19 @@ void Processor::OnThreadExit(uint32_t thread_id) {
   thread_info->state = ThreadDebugInfo::State::kExited;
 }
 
+void Processor::OnThreadEnter(ThreadState* thread_state,
+                              uint32_t stack_limit, uint32_t stack_base) {
+  if (sampling_profiler_) {
+    sampling_profiler_->RegisterThread(thread_state, stack_limit, stack_base);
+  }
+}
+
+void Processor::OnThreadLeave(ThreadState* thread_state) {
+  if (sampling_profiler_) {
+    sampling_profiler_->UnregisterThread(thread_state);
+  }
+}
+
 void Processor::OnThreadDestroyed(uint32_t thread_id) {
   auto global_lock = global_critical_region_.Acquire();
   auto it = thread_debug_infos_.find(thread_id);
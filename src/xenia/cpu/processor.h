@@ -36,6 +36,8 @@ namespace xe {
 namespace cpu {
 
 class Breakpoint;
+class CompileStats;
+class SamplingProfiler;
 class StackWalker;
 class XexModule;
 
@@ -120,6 +122,12 @@ class Processor {
   bool ExecuteRaw(ThreadState* thread_state, uint32_t address);
   uint64_t Execute(ThreadState* thread_state, uint32_t address, uint64_t args[],
                    size_t arg_count);
+  // As above, but with an already resolved function. Callers that invoke the
+  // same guest function repeatedly (such as audio callbacks) can resolve it
+  // once and skip the lookup.
+  bool Execute(ThreadState* thread_state, Function* function);
+  uint64_t Execute(ThreadState* thread_state, Function* function,
+                   uint64_t args[], size_t arg_count);
   uint64_t ExecuteInterrupt(ThreadState* thread_state, uint32_t address,
                             uint64_t args[], size_t arg_count);
 
@@ -191,6 +199,11 @@ class Processor {
   void OnThreadCreated(uint32_t handle, ThreadState* thread_state,
                        Thread* thread);
   void OnThreadExit(uint32_t thread_id);
+  // Called on the thread itself around running guest code. The stack bounds
+  // are used by the guest profiler to walk the back chain.
+  void OnThreadEnter(ThreadState* thread_state, uint32_t stack_limit,
+                     uint32_t stack_base);
+  void OnThreadLeave(ThreadState* thread_state);
   void OnThreadDestroyed(uint32_t thread_id);
   void OnThreadEnteringWait(uint32_t thread_id);
   void OnThreadLeavingWait(uint32_t thread_id);
@@ -200,6 +213,11 @@ class Processor {
 
   uint8_t* AllocateFunctionTraceData(size_t size);
 
+  // JIT metrics, or nullptr if --jit_stats is not set.
+  CompileStats* compile_stats() const { return compile_stats_.get(); }
+  // Logs the JIT metrics gathered so far, if enabled.
+  void DumpCompileStats();
+
  private:
   // Synchronously demands a debug listener.
   void DemandDebugListener();
@@ -239,6 +257,8 @@ class Processor {
 
   Memory* memory_ = nullptr;
   std::unique_ptr<StackWalker> stack_walker_;
+  std::unique_ptr<SamplingProfiler> sampling_profiler_;
+  std::unique_ptr<CompileStats> compile_stats_;
 
   std::function<DebugListener*(Processor*)> debug_listener_handler_;
   DebugListener* debug_listener_ = nullptr;
@@ -0,0 +1,177 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/sampling_profiler.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/math.h"
+#include "xenia/base/memory.h"
+#include "xenia/base/string.h"
+#include "xenia/cpu/backend/code_cache.h"
+#include "xenia/cpu/processor.h"
+#include "xenia/cpu/thread_state.h"
+
+namespace xe {
+namespace cpu {
+
+SamplingProfiler::SamplingProfiler(Processor* processor)
+    : processor_(processor) {}
+
+SamplingProfiler::~SamplingProfiler() = default;
+
+void SamplingProfiler::CaptureSample(ThreadSamples* thread, uint64_t host_pc) {
+  uint32_t write_index = thread->write_index.load(std::memory_order_relaxed);
+  uint32_t read_index = thread->read_index.load(std::memory_order_acquire);
+  if (write_index - read_index >= ThreadSamples::kRingSize) {
+    // Consumer has fallen behind; drop rather than block in the handler.
+    thread->dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  auto& sample = thread->ring[write_index % ThreadSamples::kRingSize];
+  auto context = thread->thread_state->context();
+  sample.thread_id = thread->thread_state->thread_id();
+  sample.host_pc = host_pc;
+  sample.frame_count = 0;
+
+  // Walk the back chain: each frame starts with the caller's stack pointer
+  // and the caller saves LR at -8 from its own stack pointer. Anything that
+  // doesn't move strictly up the registered stack ends the walk, as does a
+  // leaf that hasn't set up its frame yet (its caller is then skipped).
+  uint8_t* membase = context->virtual_membase;
+  uint32_t sp = uint32_t(context->r[1]);
+  while (sample.frame_count < xe::countof(sample.frames)) {
+    if (sp < thread->stack_low || sp >= thread->stack_high || (sp & 3)) {
+      break;
+    }
+    uint32_t next_sp = xe::load_and_swap<uint32_t>(membase + sp);
+    if (next_sp <= sp || next_sp > thread->stack_high ||
+        next_sp - 8 < thread->stack_low) {
+      break;
+    }
+    uint32_t return_address =
+        xe::load_and_swap<uint32_t>(membase + next_sp - 8);
+    if (!return_address || (return_address & 3)) {
+      break;
+    }
+    // Attribute to the bl rather than the instruction after it.
+    sample.frames[sample.frame_count++] = return_address - 4;
+    sp = next_sp;
+  }
+
+  thread->write_index.store(write_index + 1, std::memory_order_release);
+}
+
+void SamplingProfiler::DrainSamples(ThreadSamples* thread) {
+  uint32_t read_index = thread->read_index.load(std::memory_order_relaxed);
+  uint32_t write_index = thread->write_index.load(std::memory_order_acquire);
+  std::vector<uint32_t> key;
+  for (; read_index != write_index; ++read_index) {
+    auto& sample = thread->ring[read_index % ThreadSamples::kRingSize];
+    key.assign({sample.thread_id, uint32_t(sample.host_pc >> 32),
+                uint32_t(sample.host_pc)});
+    key.insert(key.end(), sample.frames, sample.frames + sample.frame_count);
+    ++stacks_[key];
+    ++sample_count_;
+  }
+  thread->read_index.store(read_index, std::memory_order_release);
+  dropped_count_ += thread->dropped_count.exchange(0);
+}
+
+std::string SamplingProfiler::GetFunctionName(uint32_t guest_address) {
+  auto it = function_names_.find(guest_address);
+  if (it != function_names_.end()) {
+    return it->second;
+  }
+  std::string name;
+  auto functions = processor_->FindFunctionsWithAddress(guest_address);
+  if (functions.empty()) {
+    name = xe::format_string("0x%.8X", guest_address);
+  } else if (functions[0]->name().empty()) {
+    name = xe::format_string("sub_%.8X", functions[0]->address());
+  } else {
+    name = functions[0]->name();
+  }
+  function_names_.emplace(guest_address, name);
+  return name;
+}
+
+bool SamplingProfiler::WriteFoldedStacks(const std::wstring& path) {
+  Stop();
+  std::lock_guard<std::mutex> lock(samples_mutex_);
+
+  auto code_cache = processor_->backend()->code_cache();
+  uint64_t code_base = code_cache->base_address();
+  uint64_t code_end = code_base + code_cache->total_size();
+
+  FILE* file = xe::filesystem::OpenFile(path, "w");
+  if (!file) {
+    XELOGE("Unable to open guest profile output %S", path.c_str());
+    return false;
+  }
+
+  std::map<uint32_t, uint64_t> leaf_counts;
+  uint64_t host_count = 0;
+  std::string line;
+  for (auto& it : stacks_) {
+    auto& key = it.first;
+    uint64_t host_pc = (uint64_t(key[1]) << 32) | key[2];
+    uint32_t leaf_address = 0;
+    if (host_pc >= code_base && host_pc < code_end) {
+      auto function = code_cache->LookupFunction(host_pc);
+      if (function) {
+        leaf_address = function->MapMachineCodeToGuestAddress(host_pc);
+      }
+    }
+
+    line = xe::format_string("thread_%.8X", key[0]);
+    for (size_t i = key.size() - 1; i >= 3; --i) {
+      line += ';';
+      line += GetFunctionName(key[i]);
+    }
+    line += ';';
+    if (leaf_address) {
+      line += GetFunctionName(leaf_address);
+      leaf_counts[leaf_address] += it.second;
+    } else {
+      // Kernel exports, builtins and everything else outside the JIT.
+      line += "[host]";
+      host_count += it.second;
+    }
+    std::fprintf(file, "%s %" PRIu64 "\n", line.c_str(), it.second);
+  }
+  fclose(file);
+
+  XELOGI("Guest profile: %" PRIu64 " samples (%" PRIu64
+         " dropped, %" PRIu64 " outside guest code) written to %S",
+         sample_count_, dropped_count_, host_count, path.c_str());
+  if (!sample_count_) {
+    return true;
+  }
+
+  // Hottest instructions, for quick inspection without a flame graph.
+  std::vector<std::pair<uint32_t, uint64_t>> hot(leaf_counts.begin(),
+                                                 leaf_counts.end());
+  std::sort(hot.begin(), hot.end(),
+            [](const auto& a, const auto& b) { return a.second > b.second; });
+  hot.resize(std::min(hot.size(), size_t(16)));
+  for (auto& it : hot) {
+    XELOGI("  %.8X %-32s %8" PRIu64 " (%5.2f%%)", it.first,
+           GetFunctionName(it.first).c_str(), it.second,
+           it.second * 100.0 / sample_count_);
+  }
+  return true;
+}
+
+}  // namespace cpu
+}  // namespace xe
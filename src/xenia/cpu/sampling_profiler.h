@@ -0,0 +1,117 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_CPU_SAMPLING_PROFILER_H_
+#define XENIA_CPU_SAMPLING_PROFILER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace xe {
+namespace cpu {
+
+class Processor;
+class ThreadState;
+
+// Statistical profiler for guest code.
+// Threads running guest code are interrupted on a CPU-time timer and the host
+// PC plus the guest stack (walked through the r1 back chain) are recorded.
+// Unlike --trace_functions this does not change the generated code, so hot
+// paths are measured as they normally run. Samples are symbolized at the end
+// of the run and written as folded stacks, one line per unique stack:
+//   thread;outer_function;...;leaf_function count
+// which is the input format of flamegraph.pl and speedscope.
+class SamplingProfiler {
+ public:
+  // Maximum guest frames recorded per sample, including the leaf.
+  static const uint32_t kMaxFrames = 32;
+  // Highest sampling frequency accepted by Create.
+  static const uint32_t kMaxFrequencyHz = 100000;
+
+  // Returns nullptr if sampling is not supported on this platform or
+  // frequency_hz is not in [1, kMaxFrequencyHz].
+  static std::unique_ptr<SamplingProfiler> Create(Processor* processor,
+                                                  uint32_t frequency_hz);
+
+  virtual ~SamplingProfiler();
+
+  // Starts sampling the calling thread. stack_low/stack_high bound the guest
+  // stack of the thread and are used to validate the back chain walk.
+  virtual void RegisterThread(ThreadState* thread_state, uint32_t stack_low,
+                              uint32_t stack_high) = 0;
+  // Stops sampling the calling thread. Must be called on the thread that
+  // called RegisterThread.
+  virtual void UnregisterThread(ThreadState* thread_state) = 0;
+
+  // Stops sampling on all threads. Samples already taken are kept.
+  virtual void Stop() = 0;
+
+  // Writes all samples as folded stacks and logs the hottest guest
+  // instructions. Functions must still be alive, so this must run before
+  // modules are unloaded.
+  bool WriteFoldedStacks(const std::wstring& path);
+
+  uint64_t sample_count() const { return sample_count_; }
+
+ protected:
+  struct Sample {
+    uint32_t thread_id;
+    uint32_t frame_count;
+    // Host PC at the time of the interrupt.
+    uint64_t host_pc;
+    // Guest call sites from the back chain, innermost first.
+    uint32_t frames[kMaxFrames - 1];
+  };
+
+  // Single producer (the signal handler on the owning thread), single consumer
+  // (whoever holds samples_mutex_) queue of samples for one thread.
+  struct ThreadSamples {
+    static const uint32_t kRingSize = 1024;
+
+    ThreadState* thread_state = nullptr;
+    uint32_t stack_low = 0;
+    uint32_t stack_high = 0;
+    std::atomic<bool> enabled = {false};
+    std::atomic<uint32_t> write_index = {0};
+    std::atomic<uint32_t> read_index = {0};
+    std::atomic<uint64_t> dropped_count = {0};
+    Sample ring[kRingSize];
+  };
+
+  explicit SamplingProfiler(Processor* processor);
+
+  // Records a sample for the thread. Async-signal safe: reads only the guest
+  // context and stack and never locks or allocates.
+  static void CaptureSample(ThreadSamples* thread, uint64_t host_pc);
+
+  // Moves queued samples into the aggregate table.
+  void DrainSamples(ThreadSamples* thread);
+
+  Processor* processor_ = nullptr;
+
+  std::mutex samples_mutex_;
+  // Key is thread id, host pc (split in two) and then guest frames.
+  std::map<std::vector<uint32_t>, uint64_t> stacks_;
+  uint64_t sample_count_ = 0;
+  uint64_t dropped_count_ = 0;
+
+ private:
+  std::string GetFunctionName(uint32_t guest_address);
+  std::map<uint32_t, std::string> function_names_;
+};
+
+}  // namespace cpu
+}  // namespace xe
+
+#endif  // XENIA_CPU_SAMPLING_PROFILER_H_
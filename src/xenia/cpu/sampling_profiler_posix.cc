@@ -0,0 +1,243 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/sampling_profiler.h"
+
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <thread>
+
+#include "xenia/base/logging.h"
+#include "xenia/base/platform.h"
+
+// Older glibc headers don't name the thread id member of sigevent.
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+namespace xe {
+namespace cpu {
+
+class PosixSamplingProfiler : public SamplingProfiler {
+ public:
+  PosixSamplingProfiler(Processor* processor, uint32_t frequency_hz);
+  ~PosixSamplingProfiler() override;
+
+  bool Initialize();
+
+  void RegisterThread(ThreadState* thread_state, uint32_t stack_low,
+                      uint32_t stack_high) override;
+  void UnregisterThread(ThreadState* thread_state) override;
+  void Stop() override;
+
+ private:
+  struct PosixThreadSamples : public ThreadSamples {
+    timer_t timer;
+    bool has_timer = false;
+  };
+
+  static void SignalHandler(int signal, siginfo_t* info, void* context);
+  void CollectorThreadMain();
+
+  static thread_local PosixThreadSamples* current_thread_;
+
+  uint32_t frequency_hz_ = 0;
+  struct timespec interval_ = {};
+  bool handler_installed_ = false;
+  struct sigaction old_action_;
+
+  // Guards threads_ and the collector state. Taken before samples_mutex_.
+  std::mutex threads_mutex_;
+  std::vector<std::unique_ptr<PosixThreadSamples>> threads_;
+  bool stopped_ = false;
+  std::condition_variable collector_cv_;
+  std::thread collector_thread_;
+};
+
+thread_local PosixSamplingProfiler::PosixThreadSamples*
+    PosixSamplingProfiler::current_thread_ = nullptr;
+
+std::unique_ptr<SamplingProfiler> SamplingProfiler::Create(
+    Processor* processor, uint32_t frequency_hz) {
+  auto profiler =
+      std::make_unique<PosixSamplingProfiler>(processor, frequency_hz);
+  if (!profiler->Initialize()) {
+    return nullptr;
+  }
+  return std::move(profiler);
+}
+
+PosixSamplingProfiler::PosixSamplingProfiler(Processor* processor,
+                                             uint32_t frequency_hz)
+    : SamplingProfiler(processor), frequency_hz_(frequency_hz) {}
+
+PosixSamplingProfiler::~PosixSamplingProfiler() {
+  Stop();
+  if (handler_installed_) {
+    sigaction(SIGPROF, &old_action_, nullptr);
+  }
+}
+
+bool PosixSamplingProfiler::Initialize() {
+  if (!frequency_hz_ || frequency_hz_ > kMaxFrequencyHz) {
+    XELOGE("Guest profiler: sampling frequency %u Hz out of range [1, %u]",
+           frequency_hz_, kMaxFrequencyHz);
+    return false;
+  }
+  // tv_nsec must stay below one second, so 1 Hz needs tv_sec.
+  uint64_t interval_ns = 1000000000ull / frequency_hz_;
+  interval_.tv_sec = time_t(interval_ns / 1000000000ull);
+  interval_.tv_nsec = long(interval_ns % 1000000000ull);
+
+  struct sigaction action = {};
+  action.sa_sigaction = SignalHandler;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (sigaction(SIGPROF, &action, &old_action_) != 0) {
+    XELOGE("Guest profiler: unable to install SIGPROF handler (%d)", errno);
+    return false;
+  }
+  handler_installed_ = true;
+  collector_thread_ = std::thread([this]() { CollectorThreadMain(); });
+  return true;
+}
+
+void PosixSamplingProfiler::SignalHandler(int signal, siginfo_t* info,
+                                          void* context) {
+  auto thread = current_thread_;
+  if (!thread || !thread->enabled.load(std::memory_order_acquire)) {
+    return;
+  }
+  int saved_errno = errno;
+  auto mcontext = &static_cast<ucontext_t*>(context)->uc_mcontext;
+#if XE_ARCH_AMD64
+  uint64_t host_pc = uint64_t(mcontext->gregs[REG_RIP]);
+#else
+  uint64_t host_pc = 0;
+#endif  // XE_ARCH_AMD64
+  CaptureSample(thread, host_pc);
+  errno = saved_errno;
+}
+
+void PosixSamplingProfiler::RegisterThread(ThreadState* thread_state,
+                                           uint32_t stack_low,
+                                           uint32_t stack_high) {
+  auto thread = std::make_unique<PosixThreadSamples>();
+  thread->thread_state = thread_state;
+  thread->stack_low = stack_low;
+  thread->stack_high = stack_high;
+
+  // Per-thread CPU time clock so idle and blocked threads cost nothing and
+  // samples land on the thread that burned the time.
+  struct sigevent event = {};
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = SIGPROF;
+  event.sigev_notify_thread_id = pid_t(syscall(SYS_gettid));
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &thread->timer) != 0) {
+    XELOGE("Guest profiler: timer_create failed (%d); thread not sampled",
+           errno);
+    return;
+  }
+  thread->has_timer = true;
+
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  if (stopped_) {
+    timer_delete(thread->timer);
+    return;
+  }
+  struct itimerspec spec = {};
+  spec.it_interval = interval_;
+  spec.it_value = interval_;
+  thread->enabled = true;
+  current_thread_ = thread.get();
+  if (timer_settime(thread->timer, 0, &spec, nullptr) != 0) {
+    XELOGE("Guest profiler: timer_settime failed (%d); thread not sampled",
+           errno);
+    current_thread_ = nullptr;
+    timer_delete(thread->timer);
+    return;
+  }
+  threads_.push_back(std::move(thread));
+}
+
+void PosixSamplingProfiler::UnregisterThread(ThreadState* thread_state) {
+  auto thread = current_thread_;
+  if (!thread || thread->thread_state != thread_state) {
+    return;
+  }
+  // Handler bails once this is cleared, so a signal still in flight after
+  // the timer is gone can't touch the ring.
+  current_thread_ = nullptr;
+
+  std::lock_guard<std::mutex> lock(threads_mutex_);
+  auto it = std::find_if(threads_.begin(), threads_.end(),
+                         [thread](const auto& t) { return t.get() == thread; });
+  if (it == threads_.end()) {
+    return;
+  }
+  if (thread->has_timer) {
+    timer_delete(thread->timer);
+    thread->has_timer = false;
+  }
+  {
+    std::lock_guard<std::mutex> samples_lock(samples_mutex_);
+    DrainSamples(thread);
+  }
+  threads_.erase(it);
+}
+
+void PosixSamplingProfiler::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(threads_mutex_);
+    if (stopped_) {
+      return;
+    }
+    stopped_ = true;
+    // Threads that are still running keep their (now idle) rings until the
+    // profiler goes away; only the owning thread may free them earlier.
+    for (auto& thread : threads_) {
+      thread->enabled = false;
+      if (thread->has_timer) {
+        timer_delete(thread->timer);
+        thread->has_timer = false;
+      }
+    }
+    std::lock_guard<std::mutex> samples_lock(samples_mutex_);
+    for (auto& thread : threads_) {
+      DrainSamples(thread.get());
+    }
+  }
+  collector_cv_.notify_all();
+  if (collector_thread_.joinable()) {
+    collector_thread_.join();
+  }
+}
+
+void PosixSamplingProfiler::CollectorThreadMain() {
+  std::unique_lock<std::mutex> lock(threads_mutex_);
+  while (!stopped_) {
+    // Rings hold ~1s of samples at 1kHz; drain well before they fill.
+    collector_cv_.wait_for(lock, std::chrono::milliseconds(50));
+    std::lock_guard<std::mutex> samples_lock(samples_mutex_);
+    for (auto& thread : threads_) {
+      DrainSamples(thread.get());
+    }
+  }
+}
+
+}  // namespace cpu
+}  // namespace xe
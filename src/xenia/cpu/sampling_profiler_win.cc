@@ -0,0 +1,24 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/cpu/sampling_profiler.h"
+
+#include "xenia/base/logging.h"
+
+namespace xe {
+namespace cpu {
+
+std::unique_ptr<SamplingProfiler> SamplingProfiler::Create(
+    Processor* processor, uint32_t frequency_hz) {
+  XELOGE("Guest profiler: --guest_profile is not supported on Windows");
+  return nullptr;
+}
+
+}  // namespace cpu
+}  // namespace xe
@@ -9,16 +9,387 @@
 
 #include "xenia/cpu/stack_walker.h"
 
+#include <cxxabi.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unwind.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
 #include "xenia/base/logging.h"
+#include "xenia/base/memory.h"
+#include "xenia/cpu/backend/code_cache.h"
 
 namespace xe {
 namespace cpu {
 
+// Walks generated code with the frame layout recorded by the code cache
+// (a single rsp adjustment per function, see X64Emitter::Emit) and host code
+// with the DWARF CFI unwinder from libgcc.
+// Posix has no way to read the context of another suspended thread, so those
+// stacks are captured by the thread itself from a signal handler.
+class PosixStackWalker : public StackWalker {
+ public:
+  explicit PosixStackWalker(backend::CodeCache* code_cache) {
+    code_cache_ = code_cache;
+    code_cache_min_ = code_cache_->base_address();
+    code_cache_max_ = code_cache_->base_address() + code_cache_->total_size();
+  }
+
+  bool Initialize() {
+    struct sigaction action = {};
+    action.sa_sigaction = CaptureSignalHandler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(kCaptureSignal, &action, nullptr) != 0) {
+      XELOGE("Unable to install stack capture signal handler (%d)", errno);
+      return false;
+    }
+    return true;
+  }
+
+  size_t CaptureStackTrace(uint64_t* frame_host_pcs, size_t frame_offset,
+                           size_t frame_count,
+                           uint64_t* out_stack_hash) override {
+    // Skip ourselves.
+    uint64_t host_pcs[kMaxHostFrames];
+    size_t host_count = CaptureHostFrames(host_pcs, kMaxHostFrames);
+    size_t first = std::min(host_count, frame_offset + 1);
+    size_t count = std::min(host_count - first, frame_count);
+    std::memcpy(frame_host_pcs, host_pcs + first, count * sizeof(uint64_t));
+    if (out_stack_hash) {
+      *out_stack_hash = HashStack(frame_host_pcs, count);
+    }
+    return count;
+  }
+
+  size_t CaptureStackTrace(void* thread_handle, uint64_t* frame_host_pcs,
+                           size_t frame_offset, size_t frame_count,
+                           const X64Context* in_host_context,
+                           X64Context* out_host_context,
+                           uint64_t* out_stack_hash) override {
+    auto thread = reinterpret_cast<pthread_t>(thread_handle);
+    bool on_thread = pthread_equal(thread, pthread_self()) != 0;
+    size_t count = 0;
+    if (in_host_context) {
+      // Given a context (exception, breakpoint) we can walk the generated
+      // frames from anywhere, but only continue into host frames on the
+      // thread itself.
+      count = CaptureFromContext(*in_host_context, frame_host_pcs,
+                                 frame_offset, frame_count, on_thread);
+      if (out_host_context) {
+        std::memcpy(out_host_context, in_host_context,
+                    sizeof(*out_host_context));
+      }
+    } else if (on_thread) {
+      count = CaptureStackTrace(frame_host_pcs, frame_offset + 1, frame_count,
+                                nullptr);
+      if (out_host_context) {
+        std::memset(out_host_context, 0, sizeof(*out_host_context));
+        out_host_context->rip = frame_host_pcs[0];
+      }
+    } else {
+      count = CaptureRemote(thread, frame_host_pcs, frame_offset, frame_count,
+                            out_host_context);
+    }
+    if (out_stack_hash) {
+      *out_stack_hash = HashStack(frame_host_pcs, count);
+    }
+    return count;
+  }
+
+  bool ResolveStack(uint64_t* frame_host_pcs, StackFrame* frames,
+                    size_t frame_count) override {
+    for (size_t i = 0; i < frame_count; ++i) {
+      auto& frame = frames[i];
+      std::memset(&frame, 0, sizeof(frame));
+      frame.host_pc = frame_host_pcs[i];
+
+      // If in the generated range, we know it's ours.
+      if (IsGeneratedCode(frame.host_pc)) {
+        frame.type = StackFrame::Type::kGuest;
+        auto function = code_cache_->LookupFunction(frame.host_pc);
+        frame.guest_symbol.function = function;
+        if (function) {
+          // Adjust the host PC by -1 so that we will go back into whatever
+          // instruction was executing before the capture (like a call).
+          frame.guest_pc =
+              function->MapMachineCodeToGuestAddress(frame.host_pc - 1);
+        }
+      } else {
+        // Host symbol, which means either emulator or system. Only exported
+        // symbols resolve; link with -rdynamic for the rest.
+        frame.type = StackFrame::Type::kHost;
+        Dl_info info;
+        if (dladdr(reinterpret_cast<void*>(frame.host_pc), &info) &&
+            info.dli_sname) {
+          frame.host_symbol.address = uint64_t(info.dli_saddr);
+          int status = 0;
+          char* demangled =
+              abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+          std::strncpy(frame.host_symbol.name,
+                       demangled ? demangled : info.dli_sname,
+                       sizeof(frame.host_symbol.name) - 1);
+          std::free(demangled);
+        }
+      }
+    }
+    return true;
+  }
+
+ private:
+  static const int kCaptureSignal = SIGUSR2;
+  static const size_t kMaxHostFrames = 256;
+
+  // A capture handed to another thread's signal handler.
+  struct CaptureRequest {
+    pthread_t thread;
+    uint64_t* frame_host_pcs;
+    size_t frame_offset;
+    size_t frame_count;
+    size_t captured_count;
+    X64Context context;
+    sem_t done;
+  };
+
+  static bool IsGeneratedCode(uint64_t pc) {
+    return pc >= code_cache_min_ && pc < code_cache_max_;
+  }
+
+  static uint64_t HashStack(const uint64_t* frame_host_pcs, size_t count) {
+    // FNV-1a over the return addresses.
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < count; ++i) {
+      hash = (hash ^ frame_host_pcs[i]) * 0x100000001B3ull;
+    }
+    return hash;
+  }
+
+  // Steps from a frame in generated code to its caller. is_leaf is set for
+  // the interrupted frame, which may be mid-prolog or mid-epilog; every other
+  // frame is stopped at a call and has its frame allocated.
+  static bool UnwindGeneratedFrame(bool is_leaf, uint64_t* pc, uint64_t* rsp) {
+    auto info = reinterpret_cast<const backend::UnwindInfo*>(
+        code_cache_->LookupUnwindInfo(*pc));
+    if (!info) {
+      return false;
+    }
+    uint64_t cfa = *rsp + 8;
+    if (info->stack_size) {
+      uint64_t offset = *pc - info->begin_address;
+      auto code = reinterpret_cast<const uint8_t*>(*pc);
+      bool has_frame = true;
+      if (is_leaf) {
+        // Before the sub rsp, at the ret, or just past an add rsp (jmp to
+        // a tail call) the frame isn't there.
+        has_frame = offset >= info->prolog_end && code[0] != 0xC3 &&
+                    !(offset >= 4 && code[-4] == 0x48 && code[-3] == 0x83 &&
+                      code[-2] == 0xC4) &&
+                    !(offset >= 7 && code[-7] == 0x48 && code[-6] == 0x81 &&
+                      code[-5] == 0xC4);
+      }
+      if (has_frame) {
+        cfa += info->stack_size;
+      }
+    }
+    *pc = xe::load<uint64_t>(reinterpret_cast<void*>(cfa - 8));
+    *rsp = cfa;
+    return true;
+  }
+
+  static _Unwind_Reason_Code BacktraceCallback(_Unwind_Context* context,
+                                               void* arg) {
+    auto state = reinterpret_cast<std::pair<uint64_t*, size_t>*>(arg);
+    if (state->second == kMaxHostFrames) {
+      return _URC_END_OF_STACK;
+    }
+    uint64_t pc = _Unwind_GetIP(context);
+    if (!pc) {
+      return _URC_END_OF_STACK;
+    }
+    state->first[state->second++] = pc;
+    return _URC_NO_REASON;
+  }
+
+  // Captures the calling thread with the CFI unwinder. Generated code is
+  // covered through the .eh_frame entries the code cache registers.
+  static size_t CaptureHostFrames(uint64_t* host_pcs, size_t max_count) {
+    std::pair<uint64_t*, size_t> state(host_pcs, 0);
+    _Unwind_Backtrace(BacktraceCallback, &state);
+    return std::min(state.second, max_count);
+  }
+
+  static size_t CaptureFromContext(const X64Context& context,
+                                   uint64_t* frame_host_pcs,
+                                   size_t frame_offset, size_t frame_count,
+                                   bool on_thread) {
+    size_t index = 0;
+    size_t end = frame_offset + frame_count;
+    auto emit = [&](uint64_t pc) {
+      if (index >= frame_offset && index < end) {
+        frame_host_pcs[index - frame_offset] = pc;
+      }
+      ++index;
+    };
+
+    uint64_t pc = context.rip;
+    uint64_t rsp = context.rsp;
+    emit(pc);
+    while (IsGeneratedCode(pc) && index < end) {
+      if (!UnwindGeneratedFrame(index == 1, &pc, &rsp)) {
+        break;
+      }
+      emit(pc);
+    }
+
+    if (!IsGeneratedCode(pc) && on_thread && index < end) {
+      // The CFI unwinder can only start from here, so find where its walk
+      // reaches the host frame we stopped at and continue from there.
+      uint64_t host_pcs[kMaxHostFrames];
+      size_t host_count = CaptureHostFrames(host_pcs, kMaxHostFrames);
+      for (size_t i = 0; i < host_count; ++i) {
+        if (host_pcs[i] == pc) {
+          for (size_t j = i + 1; j < host_count && index < end; ++j) {
+            emit(host_pcs[j]);
+          }
+          break;
+        }
+      }
+    }
+
+    return index > frame_offset ? std::min(index, end) - frame_offset : 0;
+  }
+
+  static void ContextFromUcontext(const ucontext_t* ucontext,
+                                  X64Context* context) {
+    auto& gregs = ucontext->uc_mcontext.gregs;
+    context->rip = gregs[REG_RIP];
+    context->eflags = uint32_t(gregs[REG_EFL]);
+    context->rax = gregs[REG_RAX];
+    context->rcx = gregs[REG_RCX];
+    context->rdx = gregs[REG_RDX];
+    context->rbx = gregs[REG_RBX];
+    context->rsp = gregs[REG_RSP];
+    context->rbp = gregs[REG_RBP];
+    context->rsi = gregs[REG_RSI];
+    context->rdi = gregs[REG_RDI];
+    context->r8 = gregs[REG_R8];
+    context->r9 = gregs[REG_R9];
+    context->r10 = gregs[REG_R10];
+    context->r11 = gregs[REG_R11];
+    context->r12 = gregs[REG_R12];
+    context->r13 = gregs[REG_R13];
+    context->r14 = gregs[REG_R14];
+    context->r15 = gregs[REG_R15];
+    auto fpregs = ucontext->uc_mcontext.fpregs;
+    if (fpregs) {
+      std::memcpy(context->xmm_registers, fpregs->_xmm,
+                  sizeof(context->xmm_registers));
+    }
+  }
+
+  // Runs on the target thread. Walking from the signal handler is not
+  // strictly async-signal safe (the CFI unwinder may take the loader lock),
+  // which is the same caveat as walking a suspended thread on Windows.
+  static void CaptureSignalHandler(int signal, siginfo_t* info,
+                                   void* ucontext) {
+    // A signal from a request that timed out may arrive late; only claim
+    // requests meant for this thread.
+    auto request = pending_request_.load();
+    if (!request || !pthread_equal(request->thread, pthread_self()) ||
+        !pending_request_.compare_exchange_strong(request, nullptr)) {
+      return;
+    }
+    int saved_errno = errno;
+    ContextFromUcontext(static_cast<ucontext_t*>(ucontext), &request->context);
+    request->captured_count = CaptureFromContext(
+        request->context, request->frame_host_pcs, request->frame_offset,
+        request->frame_count, true);
+    sem_post(&request->done);
+    errno = saved_errno;
+  }
+
+  size_t CaptureRemote(pthread_t thread, uint64_t* frame_host_pcs,
+                       size_t frame_offset, size_t frame_count,
+                       X64Context* out_host_context) {
+    std::lock_guard<std::mutex> lock(remote_mutex_);
+    CaptureRequest request;
+    request.thread = thread;
+    request.frame_host_pcs = frame_host_pcs;
+    request.frame_offset = frame_offset;
+    request.frame_count = frame_count;
+    request.captured_count = 0;
+    sem_init(&request.done, 0, 0);
+    pending_request_ = &request;
+    if (pthread_kill(thread, kCaptureSignal) != 0) {
+      pending_request_ = nullptr;
+      sem_destroy(&request.done);
+      return 0;
+    }
+
+    timespec timeout;
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_nsec += 250 * 1000000;
+    if (timeout.tv_nsec >= 1000000000) {
+      timeout.tv_sec += 1;
+      timeout.tv_nsec -= 1000000000;
+    }
+    while (sem_timedwait(&request.done, &timeout) != 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      // Timed out. If the handler hasn't claimed the request it never will;
+      // otherwise it's mid-walk and we have to wait for it.
+      if (pending_request_.exchange(nullptr)) {
+        XELOGW("Timed out capturing remote thread stack");
+        sem_destroy(&request.done);
+        return 0;
+      }
+      while (sem_wait(&request.done) != 0 && errno == EINTR) {
+      }
+      break;
+    }
+    sem_destroy(&request.done);
+
+    if (out_host_context) {
+      std::memcpy(out_host_context, &request.context,
+                  sizeof(*out_host_context));
+    }
+    return request.captured_count;
+  }
+
+  std::mutex remote_mutex_;
+
+  static std::atomic<CaptureRequest*> pending_request_;
+  static xe::cpu::backend::CodeCache* code_cache_;
+  static uint64_t code_cache_min_;
+  static uint64_t code_cache_max_;
+};
+
+std::atomic<PosixStackWalker::CaptureRequest*>
+    PosixStackWalker::pending_request_ = {nullptr};
+xe::cpu::backend::CodeCache* PosixStackWalker::code_cache_ = nullptr;
+uint64_t PosixStackWalker::code_cache_min_ = 0;
+uint64_t PosixStackWalker::code_cache_max_ = 0;
+
 std::unique_ptr<StackWalker> StackWalker::Create(
     backend::CodeCache* code_cache) {
-  XELOGD("Stack walker unimplemented on posix");
-  return nullptr;
+  auto stack_walker = std::make_unique<PosixStackWalker>(code_cache);
+  if (!stack_walker->Initialize()) {
+    XELOGE("Unable to initialize stack walker: debug/save states disabled");
+    return nullptr;
+  }
+  return std::unique_ptr<StackWalker>(stack_walker.release());
 }
 
 }  // namespace cpu
-}  // namespace xe
\ No newline at end of file
+}  // namespace xe
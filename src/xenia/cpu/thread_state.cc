@@ -49,6 +49,7 @@ ThreadState::ThreadState(Processor* processor, uint32_t thread_id,
   context_->processor = processor_;
   context_->thread_state = this;
   context_->thread_id = thread_id_;
+  context_->reserved_addr = ppc::PPCContext::kNoReservation;
 
   // Set initial registers.
   context_->r[1] = stack_base;
@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <bitset>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "xenia/base/filesystem.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/mapped_memory.h"
+#include "xenia/base/string.h"
+#include "xenia/cpu/function_trace_data.h"
+
+DEFINE_string(trace_data_file, "",
+              "Path passed to --trace_function_data_path when tracing.");
+DEFINE_string(trace_dump_sort, "instructions",
+              "Sort functions by 'calls' or 'instructions' executed.");
+DEFINE_int32(trace_dump_top, 40, "Number of functions to list.");
+DEFINE_int32(trace_dump_hot_instructions, 4,
+             "Hottest instructions to list per function (needs "
+             "--trace_function_coverage when tracing).");
+
+namespace xe {
+namespace cpu {
+
+// Totals for one guest function. A function may have been traced more than
+// once (recompiled), so everything is merged by start address.
+struct FunctionTotals {
+  uint32_t start_address = 0;
+  uint32_t end_address = 0;
+  uint64_t call_count = 0;
+  uint64_t thread_use = 0;
+  uint64_t instruction_total = 0;
+  std::vector<uint64_t> instruction_counts;
+};
+
+// Reads every record of one chunk file. Records are packed back to back;
+// a zero size marks the unused tail of a chunk that wasn't truncated.
+bool ReadChunk(const std::wstring& path,
+               std::map<uint32_t, FunctionTotals>* functions) {
+  auto mmap = MappedMemory::Open(path, MappedMemory::Mode::kRead);
+  if (!mmap) {
+    XELOGE("Unable to open %S", path.c_str());
+    return false;
+  }
+  size_t offset = 0;
+  size_t header_size = FunctionTraceData::SizeOfHeader();
+  while (offset + header_size <= mmap->size()) {
+    auto header = reinterpret_cast<const FunctionTraceData::Header*>(
+        mmap->data() + offset);
+    if (header->data_size < header_size ||
+        offset + header->data_size > mmap->size()) {
+      break;
+    }
+
+    auto& totals = (*functions)[header->start_address];
+    totals.start_address = header->start_address;
+    totals.end_address = std::max(totals.end_address, header->end_address);
+    totals.call_count += header->function_call_count;
+    totals.thread_use |= header->function_thread_use;
+
+    size_t count_size = FunctionTraceData::SizeOfInstructionCounts(
+        header->start_address, header->end_address);
+    if (header->data_size >= header_size + count_size) {
+      auto counts = reinterpret_cast<const uint64_t*>(
+          mmap->data() + offset + header_size);
+      size_t count = count_size / 8;
+      if (totals.instruction_counts.size() < count) {
+        totals.instruction_counts.resize(count);
+      }
+      for (size_t i = 0; i < count; ++i) {
+        totals.instruction_counts[i] += counts[i];
+        totals.instruction_total += counts[i];
+      }
+    }
+
+    offset += header->data_size;
+  }
+  return true;
+}
+
+int trace_data_dump_main(const std::vector<std::wstring>& args) {
+  std::wstring path;
+  if (!FLAGS_trace_data_file.empty()) {
+    path = xe::to_wstring(FLAGS_trace_data_file);
+  } else if (args.size() >= 2) {
+    path = args[1];
+  }
+  if (path.empty()) {
+    XELOGE("No trace data file specified");
+    return 1;
+  }
+
+  // The writer appends .0, .1, ... for each chunk.
+  std::map<uint32_t, FunctionTotals> functions;
+  size_t chunk_count = 0;
+  while (true) {
+    auto chunk_path = path + L"." + std::to_wstring(chunk_count);
+    if (!xe::filesystem::PathExists(chunk_path)) {
+      break;
+    }
+    if (!ReadChunk(chunk_path, &functions)) {
+      return 1;
+    }
+    ++chunk_count;
+  }
+  if (!chunk_count) {
+    XELOGE("No trace data chunks found at %S.0", path.c_str());
+    return 1;
+  }
+
+  uint64_t call_total = 0;
+  uint64_t instruction_total = 0;
+  std::vector<const FunctionTotals*> sorted;
+  for (auto& it : functions) {
+    call_total += it.second.call_count;
+    instruction_total += it.second.instruction_total;
+    sorted.push_back(&it.second);
+  }
+  bool by_calls = FLAGS_trace_dump_sort == "calls" || !instruction_total;
+  std::sort(sorted.begin(), sorted.end(),
+            [by_calls](const FunctionTotals* a, const FunctionTotals* b) {
+              return by_calls ? a->call_count > b->call_count
+                              : a->instruction_total > b->instruction_total;
+            });
+
+  std::printf("%zu chunk(s), %zu functions, %" PRIu64 " calls, %" PRIu64
+              " instructions\n",
+              chunk_count, functions.size(), call_total, instruction_total);
+  std::printf("%-19s %14s %7s %16s %7s %7s\n", "function", "calls", "calls%",
+              "instructions", "instr%", "threads");
+  size_t top =
+      std::min(sorted.size(), size_t(std::max(FLAGS_trace_dump_top, 0)));
+  for (size_t i = 0; i < top; ++i) {
+    auto function = sorted[i];
+    std::printf("%.8X-%.8X %14" PRIu64 " %6.2f%% %16" PRIu64 " %6.2f%% %7zu\n",
+                function->start_address, function->end_address,
+                function->call_count,
+                call_total ? function->call_count * 100.0 / call_total : 0.0,
+                function->instruction_total,
+                instruction_total
+                    ? function->instruction_total * 100.0 / instruction_total
+                    : 0.0,
+                std::bitset<64>(function->thread_use).count());
+
+    // Hottest instructions within the function.
+    std::vector<std::pair<uint64_t, uint32_t>> hot;
+    for (size_t j = 0; j < function->instruction_counts.size(); ++j) {
+      if (function->instruction_counts[j]) {
+        hot.emplace_back(function->instruction_counts[j], uint32_t(j));
+      }
+    }
+    size_t hot_count = std::min(
+        hot.size(), size_t(std::max(FLAGS_trace_dump_hot_instructions, 0)));
+    std::partial_sort(hot.begin(), hot.begin() + hot_count, hot.end(),
+                      [](const auto& a, const auto& b) {
+                        return a.first > b.first;
+                      });
+    for (size_t j = 0; j < hot_count; ++j) {
+      std::printf("    %.8X %16" PRIu64 "\n",
+                  function->start_address + hot[j].second * 4, hot[j].first);
+    }
+  }
+  return 0;
+}
+
+}  // namespace cpu
+}  // namespace xe
+
+DEFINE_ENTRY_POINT(L"xenia-cpu-trace-dump",
+                   L"xenia-cpu-trace-dump trace_data_path",
+                   xe::cpu::trace_data_dump_main);
@@ -10,14 +10,18 @@
 #include "xenia/gpu/command_processor.h"
 
 #include <algorithm>
+#include <array>
 #include <cinttypes>
 #include <cmath>
 
 #include "xenia/base/byte_stream.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/mutex.h"
 #include "xenia/base/profiling.h"
 #include "xenia/base/ring_buffer.h"
+#include "xenia/cpu/mmio_handler.h"
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/graphics_system.h"
 #include "xenia/gpu/registers.h"
@@ -41,7 +45,9 @@ CommandProcessor::CommandProcessor(GraphicsSystem* graphics_system,
       trace_writer_(graphics_system->memory()->physical_membase()),
       worker_running_(true),
       write_ptr_index_event_(xe::threading::Event::CreateAutoResetEvent(false)),
-      write_ptr_index_(0) {}
+      write_ptr_index_(0),
+      wait_reg_mem_event_(xe::threading::Event::CreateAutoResetEvent(false)),
+      wait_reg_mem_active_(false) {}
 
 CommandProcessor::~CommandProcessor() = default;
 
@@ -66,8 +72,12 @@ void CommandProcessor::Shutdown() {
 
   worker_running_ = false;
   write_ptr_index_event_->Set();
+  wait_reg_mem_event_->Set();
   worker_thread_->Wait(0, 0, 0, nullptr);
   worker_thread_.reset();
+
+  // Only safe once the worker is no longer updating the counters.
+  DumpPacketStats();
 }
 
 void CommandProcessor::RequestFrameTrace(const std::wstring& root_path) {
@@ -117,7 +127,10 @@ void CommandProcessor::CallInThread(std::function<void()> fn) {
 void CommandProcessor::ClearCaches() {}
 
 void CommandProcessor::WorkerThreadMain() {
-  context_->MakeCurrent();
+  // Headless backends may run without a graphics context.
+  if (context_) {
+    context_->MakeCurrent();
+  }
   if (!SetupContext()) {
     xe::FatalError("Unable to setup command processor internal state");
     return;
@@ -256,6 +269,12 @@ void CommandProcessor::UpdateWritePointer(uint32_t value) {
   write_ptr_index_event_->Set();
 }
 
+void CommandProcessor::NotifyRegisterWrite() {
+  if (wait_reg_mem_active_) {
+    wait_reg_mem_event_->Set();
+  }
+}
+
 void CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   RegisterFile* regs = register_file_;
   if (index >= RegisterFile::kRegisterCount) {
@@ -287,6 +306,47 @@ void CommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   }
 }
 
+void CommandProcessor::WriteRegisters(uint32_t base_index,
+                                      const uint32_t* values, uint32_t count) {
+  RegisterFile* regs = register_file_;
+  if (base_index >= RegisterFile::kRegisterCount) {
+    XELOGW("CommandProcessor::WriteRegisters index out of bounds: %d",
+           base_index);
+    return;
+  }
+  count = std::min(count, uint32_t(RegisterFile::kRegisterCount) - base_index);
+  std::memcpy(&regs->values[base_index], values, count * sizeof(uint32_t));
+  for (uint32_t m = 0; m < count; m++) {
+    if (!regs->GetRegisterInfo(base_index + m)) {
+      XELOGW("GPU: Write to unknown register (%.4X = %.8X)", base_index + m,
+             values[m]);
+    }
+  }
+
+  // Runs are almost always constants, which have no side effects. Only replay
+  // the registers that do.
+  uint32_t end_index = base_index + count;
+  if (base_index <= XE_GPU_REG_COHER_STATUS_HOST &&
+      end_index > XE_GPU_REG_COHER_STATUS_HOST) {
+    regs->values[XE_GPU_REG_COHER_STATUS_HOST].u32 |= 0x80000000ul;
+  }
+  if (base_index <= XE_GPU_REG_SCRATCH_REG7 &&
+      end_index > XE_GPU_REG_SCRATCH_REG0) {
+    uint32_t first = std::max(base_index, uint32_t(XE_GPU_REG_SCRATCH_REG0));
+    uint32_t last = std::min(end_index - 1, uint32_t(XE_GPU_REG_SCRATCH_REG7));
+    for (uint32_t index = first; index <= last; ++index) {
+      uint32_t scratch_reg = index - XE_GPU_REG_SCRATCH_REG0;
+      if ((1 << scratch_reg) & regs->values[XE_GPU_REG_SCRATCH_UMSK].u32) {
+        // Enabled - write to address.
+        uint32_t scratch_addr = regs->values[XE_GPU_REG_SCRATCH_ADDR].u32;
+        uint32_t mem_addr = scratch_addr + (scratch_reg * 4);
+        xe::store_and_swap<uint32_t>(memory_->TranslatePhysical(mem_addr),
+                                     values[index - base_index]);
+      }
+    }
+  }
+}
+
 void CommandProcessor::UpdateGammaRampValue(GammaRampType type,
                                             uint32_t value) {
   RegisterFile* regs = register_file_;
@@ -523,12 +583,23 @@ bool CommandProcessor::ExecutePacketType0(RingBuffer* reader, uint32_t packet) {
 
   trace_writer_.WritePacketStart(uint32_t(reader->read_ptr() - 4), 1 + count);
 
+  uint64_t start_ticks =
+      FLAGS_gpu_packet_stats ? Clock::QueryHostTickCount() : 0;
   uint32_t base_index = (packet & 0x7FFF);
   uint32_t write_one_reg = (packet >> 15) & 0x1;
-  for (uint32_t m = 0; m < count; m++) {
-    uint32_t reg_data = reader->ReadAndSwap<uint32_t>();
-    uint32_t target_index = write_one_reg ? base_index : base_index + m;
-    WriteRegister(target_index, reg_data);
+  if (write_one_reg) {
+    // Streaming into a single register (e.g. gamma ramp data) - every write
+    // has to be seen individually.
+    for (uint32_t m = 0; m < count; m++) {
+      uint32_t reg_data = reader->ReadAndSwap<uint32_t>();
+      WriteRegister(base_index, reg_data);
+    }
+  } else {
+    WriteRegisters(base_index, ReadPacketData(reader, count), count);
+  }
+  if (FLAGS_gpu_packet_stats) {
+    ++type0_packet_stats_.count;
+    type0_packet_stats_.ticks += Clock::QueryHostTickCount() - start_ticks;
   }
 
   trace_writer_.WritePacketEnd();
@@ -589,132 +660,22 @@ bool CommandProcessor::ExecutePacketType3(RingBuffer* reader, uint32_t packet) {
   }
 
   bool result = false;
-  switch (opcode) {
-    case PM4_ME_INIT:
-      result = ExecutePacketType3_ME_INIT(reader, packet, count);
-      break;
-    case PM4_NOP:
-      result = ExecutePacketType3_NOP(reader, packet, count);
-      break;
-    case PM4_INTERRUPT:
-      result = ExecutePacketType3_INTERRUPT(reader, packet, count);
-      break;
-    case PM4_XE_SWAP:
-      result = ExecutePacketType3_XE_SWAP(reader, packet, count);
-      break;
-    case PM4_INDIRECT_BUFFER:
-    case PM4_INDIRECT_BUFFER_PFD:
-      result = ExecutePacketType3_INDIRECT_BUFFER(reader, packet, count);
-      break;
-    case PM4_WAIT_REG_MEM:
-      result = ExecutePacketType3_WAIT_REG_MEM(reader, packet, count);
-      break;
-    case PM4_REG_RMW:
-      result = ExecutePacketType3_REG_RMW(reader, packet, count);
-      break;
-    case PM4_REG_TO_MEM:
-      result = ExecutePacketType3_REG_TO_MEM(reader, packet, count);
-      break;
-    case PM4_MEM_WRITE:
-      result = ExecutePacketType3_MEM_WRITE(reader, packet, count);
-      break;
-    case PM4_COND_WRITE:
-      result = ExecutePacketType3_COND_WRITE(reader, packet, count);
-      break;
-    case PM4_EVENT_WRITE:
-      result = ExecutePacketType3_EVENT_WRITE(reader, packet, count);
-      break;
-    case PM4_EVENT_WRITE_SHD:
-      result = ExecutePacketType3_EVENT_WRITE_SHD(reader, packet, count);
-      break;
-    case PM4_EVENT_WRITE_EXT:
-      result = ExecutePacketType3_EVENT_WRITE_EXT(reader, packet, count);
-      break;
-    case PM4_EVENT_WRITE_ZPD:
-      result = ExecutePacketType3_EVENT_WRITE_ZPD(reader, packet, count);
-      break;
-    case PM4_DRAW_INDX:
-      result = ExecutePacketType3_DRAW_INDX(reader, packet, count);
-      break;
-    case PM4_DRAW_INDX_2:
-      result = ExecutePacketType3_DRAW_INDX_2(reader, packet, count);
-      break;
-    case PM4_SET_CONSTANT:
-      result = ExecutePacketType3_SET_CONSTANT(reader, packet, count);
-      break;
-    case PM4_SET_CONSTANT2:
-      result = ExecutePacketType3_SET_CONSTANT2(reader, packet, count);
-      break;
-    case PM4_LOAD_ALU_CONSTANT:
-      result = ExecutePacketType3_LOAD_ALU_CONSTANT(reader, packet, count);
-      break;
-    case PM4_SET_SHADER_CONSTANTS:
-      result = ExecutePacketType3_SET_SHADER_CONSTANTS(reader, packet, count);
-      break;
-    case PM4_IM_LOAD:
-      result = ExecutePacketType3_IM_LOAD(reader, packet, count);
-      break;
-    case PM4_IM_LOAD_IMMEDIATE:
-      result = ExecutePacketType3_IM_LOAD_IMMEDIATE(reader, packet, count);
-      break;
-    case PM4_INVALIDATE_STATE:
-      result = ExecutePacketType3_INVALIDATE_STATE(reader, packet, count);
-      break;
-    case PM4_VIZ_QUERY:
-      result = ExecutePacketType3_VIZ_QUERY(reader, packet, count);
-      break;
-
-    case PM4_SET_BIN_MASK_LO: {
-      uint32_t value = reader->ReadAndSwap<uint32_t>();
-      bin_mask_ = (bin_mask_ & 0xFFFFFFFF00000000ull) | value;
-      result = true;
-    } break;
-    case PM4_SET_BIN_MASK_HI: {
-      uint32_t value = reader->ReadAndSwap<uint32_t>();
-      bin_mask_ =
-          (bin_mask_ & 0xFFFFFFFFull) | (static_cast<uint64_t>(value) << 32);
-      result = true;
-    } break;
-    case PM4_SET_BIN_SELECT_LO: {
-      uint32_t value = reader->ReadAndSwap<uint32_t>();
-      bin_select_ = (bin_select_ & 0xFFFFFFFF00000000ull) | value;
-      result = true;
-    } break;
-    case PM4_SET_BIN_SELECT_HI: {
-      uint32_t value = reader->ReadAndSwap<uint32_t>();
-      bin_select_ =
-          (bin_select_ & 0xFFFFFFFFull) | (static_cast<uint64_t>(value) << 32);
-      result = true;
-    } break;
-    case PM4_SET_BIN_MASK: {
-      assert_true(count == 2);
-      uint64_t val_hi = reader->ReadAndSwap<uint32_t>();
-      uint64_t val_lo = reader->ReadAndSwap<uint32_t>();
-      bin_mask_ = (val_hi << 32) | val_lo;
-      result = true;
-    } break;
-    case PM4_SET_BIN_SELECT: {
-      assert_true(count == 2);
-      uint64_t val_hi = reader->ReadAndSwap<uint32_t>();
-      uint64_t val_lo = reader->ReadAndSwap<uint32_t>();
-      bin_select_ = (val_hi << 32) | val_lo;
-      result = true;
-    } break;
-    case PM4_CONTEXT_UPDATE: {
-      assert_true(count == 1);
-      uint64_t value = reader->ReadAndSwap<uint32_t>();
-      XELOGGPU("GPU context update = %.8X", value);
-      assert_true(value == 0);
-      result = true;
-      break;
+  auto& info = packet_type3_table()[opcode];
+  if (info.handler) {
+    if (FLAGS_gpu_packet_stats) {
+      uint64_t start_ticks = Clock::QueryHostTickCount();
+      result = (this->*info.handler)(reader, packet, count);
+      auto& stats = type3_packet_stats_[opcode];
+      ++stats.count;
+      stats.ticks += Clock::QueryHostTickCount() - start_ticks;
+    } else {
+      result = (this->*info.handler)(reader, packet, count);
     }
-
-    default:
-      XELOGGPU("Unimplemented GPU OPCODE: 0x%.2X\t\tCOUNT: %d\n", opcode,
-               count);
-      assert_always();
-      reader->AdvanceRead(count * sizeof(uint32_t));
-      break;
+  } else {
+    XELOGGPU("Unimplemented GPU OPCODE: 0x%.2X\t\tCOUNT: %d\n", opcode,
+             count);
+    assert_always();
+    reader->AdvanceRead(count * sizeof(uint32_t));
   }
 
   trace_writer_.WritePacketEnd();
@@ -742,6 +703,82 @@ bool CommandProcessor::ExecutePacketType3(RingBuffer* reader, uint32_t packet) {
   return result;
 }
 
+const CommandProcessor::PacketType3Info*
+CommandProcessor::packet_type3_table() {
+  static const auto table = []() {
+    std::array<PacketType3Info, 128> table = {};
+#define XE_PM4_HANDLER(opcode, fn) \
+  table[PM4_##opcode] = {&CommandProcessor::ExecutePacketType3_##fn, #opcode}
+    XE_PM4_HANDLER(ME_INIT, ME_INIT);
+    XE_PM4_HANDLER(NOP, NOP);
+    XE_PM4_HANDLER(INTERRUPT, INTERRUPT);
+    XE_PM4_HANDLER(XE_SWAP, XE_SWAP);
+    XE_PM4_HANDLER(INDIRECT_BUFFER, INDIRECT_BUFFER);
+    XE_PM4_HANDLER(INDIRECT_BUFFER_PFD, INDIRECT_BUFFER);
+    XE_PM4_HANDLER(WAIT_REG_MEM, WAIT_REG_MEM);
+    XE_PM4_HANDLER(REG_RMW, REG_RMW);
+    XE_PM4_HANDLER(REG_TO_MEM, REG_TO_MEM);
+    XE_PM4_HANDLER(MEM_WRITE, MEM_WRITE);
+    XE_PM4_HANDLER(COND_WRITE, COND_WRITE);
+    XE_PM4_HANDLER(EVENT_WRITE, EVENT_WRITE);
+    XE_PM4_HANDLER(EVENT_WRITE_SHD, EVENT_WRITE_SHD);
+    XE_PM4_HANDLER(EVENT_WRITE_EXT, EVENT_WRITE_EXT);
+    XE_PM4_HANDLER(EVENT_WRITE_ZPD, EVENT_WRITE_ZPD);
+    XE_PM4_HANDLER(DRAW_INDX, DRAW_INDX);
+    XE_PM4_HANDLER(DRAW_INDX_2, DRAW_INDX_2);
+    XE_PM4_HANDLER(SET_CONSTANT, SET_CONSTANT);
+    XE_PM4_HANDLER(SET_CONSTANT2, SET_CONSTANT2);
+    XE_PM4_HANDLER(LOAD_ALU_CONSTANT, LOAD_ALU_CONSTANT);
+    XE_PM4_HANDLER(SET_SHADER_CONSTANTS, SET_SHADER_CONSTANTS);
+    XE_PM4_HANDLER(IM_LOAD, IM_LOAD);
+    XE_PM4_HANDLER(IM_LOAD_IMMEDIATE, IM_LOAD_IMMEDIATE);
+    XE_PM4_HANDLER(INVALIDATE_STATE, INVALIDATE_STATE);
+    XE_PM4_HANDLER(VIZ_QUERY, VIZ_QUERY);
+    XE_PM4_HANDLER(SET_BIN_MASK_LO, SET_BIN_MASK_LO);
+    XE_PM4_HANDLER(SET_BIN_MASK_HI, SET_BIN_MASK_HI);
+    XE_PM4_HANDLER(SET_BIN_SELECT_LO, SET_BIN_SELECT_LO);
+    XE_PM4_HANDLER(SET_BIN_SELECT_HI, SET_BIN_SELECT_HI);
+    XE_PM4_HANDLER(SET_BIN_MASK, SET_BIN_MASK);
+    XE_PM4_HANDLER(SET_BIN_SELECT, SET_BIN_SELECT);
+    XE_PM4_HANDLER(CONTEXT_UPDATE, CONTEXT_UPDATE);
+#undef XE_PM4_HANDLER
+    return table;
+  }();
+  return table.data();
+}
+
+const uint32_t* CommandProcessor::ReadPacketData(RingBuffer* reader,
+                                                 uint32_t count) {
+  if (packet_scratch_.size() < count) {
+    packet_scratch_.resize(count);
+  }
+  reader->ReadAndSwap(packet_scratch_.data(), count);
+  return packet_scratch_.data();
+}
+
+void CommandProcessor::DumpPacketStats() {
+  if (!FLAGS_gpu_packet_stats) {
+    return;
+  }
+  double ticks_to_us = 1000000.0 / Clock::host_tick_frequency();
+  XELOGI("GPU packet stats (inclusive of nested packets):");
+  if (type0_packet_stats_.count) {
+    XELOGI("  %-24s %12" PRIu64 " packets %14.0f us", "TYPE0",
+           type0_packet_stats_.count,
+           type0_packet_stats_.ticks * ticks_to_us);
+  }
+  auto table = packet_type3_table();
+  for (uint32_t opcode = 0; opcode < xe::countof(type3_packet_stats_);
+       ++opcode) {
+    auto& stats = type3_packet_stats_[opcode];
+    if (!stats.count) {
+      continue;
+    }
+    XELOGI("  %-24s %12" PRIu64 " packets %14.0f us", table[opcode].name,
+           stats.count, stats.ticks * ticks_to_us);
+  }
+}
+
 bool CommandProcessor::ExecutePacketType3_ME_INIT(RingBuffer* reader,
                                                   uint32_t packet,
                                                   uint32_t count) {
@@ -830,13 +867,26 @@ bool CommandProcessor::ExecutePacketType3_WAIT_REG_MEM(RingBuffer* reader,
   uint32_t ref = reader->ReadAndSwap<uint32_t>();
   uint32_t mask = reader->ReadAndSwap<uint32_t>();
   uint32_t wait = reader->ReadAndSwap<uint32_t>();
+  bool is_memory = (wait_info & 0x10) != 0;
+  auto endianness = Endian::kUnspecified;
+  if (is_memory) {
+    endianness = static_cast<Endian>(poll_reg_addr & 0x3);
+    poll_reg_addr &= ~0x3;
+  }
+  if (wait >= 0x100) {
+    wait_reg_mem_active_ = true;
+  }
   bool matched = false;
   do {
+    // Arm the watch before sampling so a store landing in between still
+    // wakes us.
+    bool watched = false;
+    if (is_memory && wait >= 0x100) {
+      watched = ArmWaitRegMemWatch(poll_reg_addr);
+    }
     uint32_t value;
-    if (wait_info & 0x10) {
+    if (is_memory) {
       // Memory.
-      auto endianness = static_cast<Endian>(poll_reg_addr & 0x3);
-      poll_reg_addr &= ~0x3;
       value = xe::load<uint32_t>(memory_->TranslatePhysical(poll_reg_addr));
       value = GpuSwap(value, endianness);
       trace_writer_.WriteMemoryRead(CpuToGpu(poll_reg_addr), 4);
@@ -879,17 +929,24 @@ bool CommandProcessor::ExecutePacketType3_WAIT_REG_MEM(RingBuffer* reader,
       // Wait.
       if (wait >= 0x100) {
         PrepareForWait();
-        if (!FLAGS_vsync) {
-          // User wants it fast and dangerous.
+        if (is_memory && !watched && !FLAGS_vsync) {
+          // Can't observe writes to this memory (another watch already owns
+          // the page). User wants it fast and dangerous.
           xe::threading::MaybeYield();
         } else {
-          xe::threading::Sleep(std::chrono::milliseconds(wait / 0x100));
+          // Guest stores to the watched page and register writes wake us
+          // early; the timeout still covers writes we can't observe, such as
+          // host-side stores into pages someone else is watching.
+          xe::threading::Wait(wait_reg_mem_event_.get(), true,
+                              std::chrono::milliseconds(wait / 0x100));
         }
         xe::threading::SyncMemory();
         ReturnFromWait();
 
         if (!worker_running_) {
           // Short-circuited exit.
+          DisarmWaitRegMemWatch();
+          wait_reg_mem_active_ = false;
           return false;
         }
       } else {
@@ -897,10 +954,49 @@ bool CommandProcessor::ExecutePacketType3_WAIT_REG_MEM(RingBuffer* reader,
       }
     }
   } while (!matched);
+  DisarmWaitRegMemWatch();
+  wait_reg_mem_active_ = false;
 
   return true;
 }
 
+bool CommandProcessor::ArmWaitRegMemWatch(uint32_t physical_address) {
+  auto global_lock = global_critical_region::AcquireDirect();
+  if (wait_reg_mem_watch_) {
+    // Still armed from the last poll.
+    return true;
+  }
+  // Adding a watch fires any other watch on the same page, so don't steal
+  // pages other caches are watching (e.g. textures) - that would invalidate
+  // them on every poll.
+  auto mmio_handler = cpu::MMIOHandler::global_handler();
+  if (!mmio_handler || mmio_handler->IsAnyPageWatched(physical_address, 4)) {
+    return false;
+  }
+  wait_reg_mem_watch_ = memory_->AddPhysicalAccessWatch(
+      physical_address, 4, cpu::MMIOHandler::kWatchWrite,
+      &WaitRegMemWatchCallback, this, nullptr);
+  return wait_reg_mem_watch_ != 0;
+}
+
+void CommandProcessor::DisarmWaitRegMemWatch() {
+  auto global_lock = global_critical_region::AcquireDirect();
+  if (wait_reg_mem_watch_) {
+    memory_->CancelAccessWatch(wait_reg_mem_watch_);
+    wait_reg_mem_watch_ = 0;
+  }
+}
+
+void CommandProcessor::WaitRegMemWatchCallback(void* context_ptr,
+                                               void* data_ptr,
+                                               uint32_t address) {
+  // Runs under the global critical region on the writing thread. The watch
+  // is one-shot and removed once we return.
+  auto self = reinterpret_cast<CommandProcessor*>(context_ptr);
+  self->wait_reg_mem_watch_ = 0;
+  self->wait_reg_mem_event_->Set();
+}
+
 bool CommandProcessor::ExecutePacketType3_REG_RMW(RingBuffer* reader,
                                                   uint32_t packet,
                                                   uint32_t count) {
@@ -1229,10 +1325,7 @@ bool CommandProcessor::ExecutePacketType3_SET_CONSTANT(RingBuffer* reader,
       reader->AdvanceRead((count - 1) * sizeof(uint32_t));
       return true;
   }
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegisters(index, ReadPacketData(reader, count - 1), count - 1);
   return true;
 }
 
@@ -1241,10 +1334,7 @@ bool CommandProcessor::ExecutePacketType3_SET_CONSTANT2(RingBuffer* reader,
                                                         uint32_t count) {
   uint32_t offset_type = reader->ReadAndSwap<uint32_t>();
   uint32_t index = offset_type & 0xFFFF;
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegisters(index, ReadPacketData(reader, count - 1), count - 1);
   return true;
 }
 
@@ -1280,11 +1370,13 @@ bool CommandProcessor::ExecutePacketType3_LOAD_ALU_CONSTANT(RingBuffer* reader,
       return true;
   }
   trace_writer_.WriteMemoryRead(CpuToGpu(address), size_dwords * 4);
-  for (uint32_t n = 0; n < size_dwords; n++, index++) {
-    uint32_t data = xe::load_and_swap<uint32_t>(
-        memory_->TranslatePhysical(address + n * 4));
-    WriteRegister(index, data);
+  if (packet_scratch_.size() < size_dwords) {
+    packet_scratch_.resize(size_dwords);
   }
+  xe::copy_and_swap(
+      packet_scratch_.data(),
+      memory_->TranslatePhysical<const uint32_t*>(address), size_dwords);
+  WriteRegisters(index, packet_scratch_.data(), size_dwords);
   return true;
 }
 
@@ -1292,10 +1384,7 @@ bool CommandProcessor::ExecutePacketType3_SET_SHADER_CONSTANTS(
     RingBuffer* reader, uint32_t packet, uint32_t count) {
   uint32_t offset_type = reader->ReadAndSwap<uint32_t>();
   uint32_t index = offset_type & 0xFFFF;
-  for (uint32_t n = 0; n < count - 1; n++, index++) {
-    uint32_t data = reader->ReadAndSwap<uint32_t>();
-    WriteRegister(index, data);
-  }
+  WriteRegisters(index, ReadPacketData(reader, count - 1), count - 1);
   return true;
 }
 
@@ -1396,5 +1485,67 @@ bool CommandProcessor::ExecutePacketType3_VIZ_QUERY(RingBuffer* reader,
   return true;
 }
 
+bool CommandProcessor::ExecutePacketType3_SET_BIN_MASK_LO(RingBuffer* reader,
+                                                          uint32_t packet,
+                                                          uint32_t count) {
+  uint32_t value = reader->ReadAndSwap<uint32_t>();
+  bin_mask_ = (bin_mask_ & 0xFFFFFFFF00000000ull) | value;
+  return true;
+}
+
+bool CommandProcessor::ExecutePacketType3_SET_BIN_MASK_HI(RingBuffer* reader,
+                                                          uint32_t packet,
+                                                          uint32_t count) {
+  uint32_t value = reader->ReadAndSwap<uint32_t>();
+  bin_mask_ =
+      (bin_mask_ & 0xFFFFFFFFull) | (static_cast<uint64_t>(value) << 32);
+  return true;
+}
+
+bool CommandProcessor::ExecutePacketType3_SET_BIN_SELECT_LO(
+    RingBuffer* reader, uint32_t packet, uint32_t count) {
+  uint32_t value = reader->ReadAndSwap<uint32_t>();
+  bin_select_ = (bin_select_ & 0xFFFFFFFF00000000ull) | value;
+  return true;
+}
+
+bool CommandProcessor::ExecutePacketType3_SET_BIN_SELECT_HI(
+    RingBuffer* reader, uint32_t packet, uint32_t count) {
+  uint32_t value = reader->ReadAndSwap<uint32_t>();
+  bin_select_ =
+      (bin_select_ & 0xFFFFFFFFull) | (static_cast<uint64_t>(value) << 32);
+  return true;
+}
+
+bool CommandProcessor::ExecutePacketType3_SET_BIN_MASK(RingBuffer* reader,
+                                                       uint32_t packet,
+                                                       uint32_t count) {
+  assert_true(count == 2);
+  uint64_t val_hi = reader->ReadAndSwap<uint32_t>();
+  uint64_t val_lo = reader->ReadAndSwap<uint32_t>();
+  bin_mask_ = (val_hi << 32) | val_lo;
+  return true;
+}
+
+bool CommandProcessor::ExecutePacketType3_SET_BIN_SELECT(RingBuffer* reader,
+                                                         uint32_t packet,
+                                                         uint32_t count) {
+  assert_true(count == 2);
+  uint64_t val_hi = reader->ReadAndSwap<uint32_t>();
+  uint64_t val_lo = reader->ReadAndSwap<uint32_t>();
+  bin_select_ = (val_hi << 32) | val_lo;
+  return true;
+}
+
+bool CommandProcessor::ExecutePacketType3_CONTEXT_UPDATE(RingBuffer* reader,
+                                                         uint32_t packet,
+                                                         uint32_t count) {
+  assert_true(count == 1);
+  uint64_t value = reader->ReadAndSwap<uint32_t>();
+  XELOGGPU("GPU context update = %.8X", value);
+  assert_true(value == 0);
+  return true;
+}
+
 }  // namespace gpu
 }  // namespace xe
@@ -139,8 +139,15 @@ class CommandProcessor {
 
   void UpdateWritePointer(uint32_t value);
 
+  // Wakes the worker if it is blocked in WAIT_REG_MEM, as a register it polls
+  // may have changed. Called on guest MMIO register writes.
+  void NotifyRegisterWrite();
+
   void ExecutePacket(uint32_t ptr, uint32_t count);
 
+  // Logs the per-opcode packet counters gathered with --gpu_packet_stats.
+  void DumpPacketStats();
+
   bool is_paused() const { return paused_; }
   void Pause();
   void Resume();
@@ -162,6 +169,11 @@ class CommandProcessor {
   virtual void ShutdownContext() = 0;
 
   virtual void WriteRegister(uint32_t index, uint32_t value);
+  // Writes a contiguous run of registers. Equivalent to calling WriteRegister
+  // for each, but subclasses can track dirty state per range instead of per
+  // register.
+  virtual void WriteRegisters(uint32_t base_index, const uint32_t* values,
+                              uint32_t count);
 
   void UpdateGammaRampValue(GammaRampType type, uint32_t value);
 
@@ -169,6 +181,13 @@ class CommandProcessor {
   virtual void PrepareForWait();
   virtual void ReturnFromWait();
 
+  // Write watch on the memory polled by WAIT_REG_MEM, so guest stores to it
+  // wake the worker instead of it sleeping out the full wait interval.
+  bool ArmWaitRegMemWatch(uint32_t physical_address);
+  void DisarmWaitRegMemWatch();
+  static void WaitRegMemWatchCallback(void* context_ptr, void* data_ptr,
+                                      uint32_t address);
+
   virtual void PerformSwap(uint32_t frontbuffer_ptr, uint32_t frontbuffer_width,
                            uint32_t frontbuffer_height) = 0;
 
@@ -228,6 +247,33 @@ class CommandProcessor {
                                            uint32_t count);
   bool ExecutePacketType3_VIZ_QUERY(RingBuffer* reader, uint32_t packet,
                                     uint32_t count);
+  bool ExecutePacketType3_SET_BIN_MASK_LO(RingBuffer* reader, uint32_t packet,
+                                          uint32_t count);
+  bool ExecutePacketType3_SET_BIN_MASK_HI(RingBuffer* reader, uint32_t packet,
+                                          uint32_t count);
+  bool ExecutePacketType3_SET_BIN_SELECT_LO(RingBuffer* reader,
+                                            uint32_t packet, uint32_t count);
+  bool ExecutePacketType3_SET_BIN_SELECT_HI(RingBuffer* reader,
+                                            uint32_t packet, uint32_t count);
+  bool ExecutePacketType3_SET_BIN_MASK(RingBuffer* reader, uint32_t packet,
+                                       uint32_t count);
+  bool ExecutePacketType3_SET_BIN_SELECT(RingBuffer* reader, uint32_t packet,
+                                         uint32_t count);
+  bool ExecutePacketType3_CONTEXT_UPDATE(RingBuffer* reader, uint32_t packet,
+                                         uint32_t count);
+
+  typedef bool (CommandProcessor::*PacketType3Handler)(RingBuffer* reader,
+                                                       uint32_t packet,
+                                                       uint32_t count);
+  struct PacketType3Info {
+    PacketType3Handler handler;
+    const char* name;
+  };
+  // Type-3 handlers indexed by opcode; null for unimplemented opcodes.
+  static const PacketType3Info* packet_type3_table();
+
+  // Reads count dwords of packet payload, swapped, into packet_scratch_.
+  const uint32_t* ReadPacketData(RingBuffer* reader, uint32_t count);
 
   virtual Shader* LoadShader(ShaderType shader_type, uint32_t guest_address,
                              const uint32_t* host_address,
@@ -276,6 +322,12 @@ class CommandProcessor {
   std::unique_ptr<xe::threading::Event> write_ptr_index_event_;
   std::atomic<uint32_t> write_ptr_index_;
 
+  // Set when a WAIT_REG_MEM condition may have changed.
+  std::unique_ptr<xe::threading::Event> wait_reg_mem_event_;
+  std::atomic<bool> wait_reg_mem_active_;
+  // Guarded by the global critical region, which watch callbacks run under.
+  uintptr_t wait_reg_mem_watch_ = 0;
+
   uint64_t bin_select_ = 0xFFFFFFFFull;
   uint64_t bin_mask_ = 0xFFFFFFFFull;
 
@@ -284,6 +336,16 @@ class CommandProcessor {
 
   bool paused_ = false;
 
+  std::vector<uint32_t> packet_scratch_;
+
+  struct PacketStats {
+    uint64_t count;
+    uint64_t ticks;
+  };
+  // Inclusive of nested packets (e.g. INDIRECT_BUFFER).
+  PacketStats type0_packet_stats_ = {};
+  PacketStats type3_packet_stats_[128] = {};
+
   GammaRamp gamma_ramp_ = {};
   int gamma_ramp_rw_subindex_ = 0;
   bool dirty_gamma_ramp_ = true;
@@ -12,8 +12,15 @@
 DEFINE_string(trace_gpu_prefix, "scratch/gpu/",
               "Prefix path for GPU trace files.");
 DEFINE_bool(trace_gpu_stream, false, "Trace all GPU packets.");
+DEFINE_int32(trace_max_decoded_mb, 8192,
+             "Largest decoded size of a GPU trace that will be opened, in MB. "
+             "Traces are fully decoded into memory when opened.");
 
 DEFINE_string(dump_shaders, "",
               "Path to write GPU shaders to as they are compiled.");
 
 DEFINE_bool(vsync, true, "Enable VSYNC.");
+
+DEFINE_bool(gpu_packet_stats, false,
+            "Count and time command processor packets by opcode. Dumped to "
+            "the log on shutdown.");
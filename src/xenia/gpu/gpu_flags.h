@@ -14,9 +14,12 @@
 
 DECLARE_string(trace_gpu_prefix);
 DECLARE_bool(trace_gpu_stream);
+DECLARE_int32(trace_max_decoded_mb);
 
 DECLARE_string(dump_shaders);
 
 DECLARE_bool(vsync);
 
+DECLARE_bool(gpu_packet_stats);
+
 #endif  // XENIA_GPU_GPU_FLAGS_H_
@@ -212,6 +212,7 @@ void GraphicsSystem::WriteRegister(uint32_t addr, uint32_t value) {
 
   assert_true(r < RegisterFile::kRegisterCount);
   register_file_.values[r].u32 = value;
+  command_processor_->NotifyRegisterWrite();
 }
 
 void GraphicsSystem::InitializeRingBuffer(uint32_t ptr, uint32_t log2_size) {
@@ -9,6 +9,15 @@
 
 #include "xenia/gpu/null/null_command_processor.h"
 
+#include <cinttypes>
+
+#include "third_party/xxhash/xxhash.h"
+#include "xenia/base/logging.h"
+#include "xenia/gpu/null/null_gpu_flags.h"
+#include "xenia/gpu/spirv_shader_translator.h"
+#include "xenia/gpu/texture_conversion.h"
+#include "xenia/gpu/texture_info.h"
+
 namespace xe {
 namespace gpu {
 namespace null {
@@ -19,10 +28,16 @@ NullCommandProcessor::NullCommandProcessor(NullGraphicsSystem* graphics_system,
 NullCommandProcessor::~NullCommandProcessor() = default;
 
 bool NullCommandProcessor::SetupContext() {
+  if (FLAGS_null_gpu_cpu_work) {
+    shader_translator_ = std::make_unique<SpirvShaderTranslator>();
+  }
   return CommandProcessor::SetupContext();
 }
 
 void NullCommandProcessor::ShutdownContext() {
+  shader_map_.clear();
+  converted_textures_.clear();
+  shader_translator_.reset();
   return CommandProcessor::ShutdownContext();
 }
 
@@ -34,15 +49,115 @@ Shader* NullCommandProcessor::LoadShader(ShaderType shader_type,
                                          uint32_t guest_address,
                                          const uint32_t* host_address,
                                          uint32_t dword_count) {
-  return nullptr;
+  if (!shader_translator_) {
+    return nullptr;
+  }
+
+  uint64_t data_hash = XXH64(host_address, dword_count * sizeof(uint32_t), 0);
+  auto it = shader_map_.find(data_hash);
+  if (it != shader_map_.end()) {
+    return it->second.get();
+  }
+  auto shader = std::make_unique<Shader>(shader_type, data_hash, host_address,
+                                         dword_count);
+  auto shader_ptr = shader.get();
+  shader_map_.insert({data_hash, std::move(shader)});
+  return shader_ptr;
 }
 
 bool NullCommandProcessor::IssueDraw(PrimitiveType prim_type,
                                      uint32_t index_count,
                                      IndexBufferInfo* index_buffer_info) {
+  if (!shader_translator_) {
+    return true;
+  }
+
+  auto vertex_shader = active_vertex_shader();
+  auto pixel_shader = active_pixel_shader();
+  if (vertex_shader) {
+    TranslateShader(vertex_shader);
+    ConvertTextures(vertex_shader->texture_bindings());
+  }
+  if (pixel_shader) {
+    TranslateShader(pixel_shader);
+    ConvertTextures(pixel_shader->texture_bindings());
+  }
   return true;
 }
 
+void NullCommandProcessor::TranslateShader(Shader* shader) {
+  if (shader->is_translated()) {
+    return;
+  }
+  xenos::xe_gpu_program_cntl_t sq_program_cntl;
+  sq_program_cntl.dword_0 =
+      register_file_->values[XE_GPU_REG_SQ_PROGRAM_CNTL].u32;
+  if (!shader_translator_->Translate(shader, sq_program_cntl)) {
+    XELOGE("Shader %.16" PRIX64 " failed translation",
+           shader->ucode_data_hash());
+  }
+}
+
+void NullCommandProcessor::ConvertTextures(
+    const std::vector<Shader::TextureBinding>& bindings) {
+  for (auto& binding : bindings) {
+    int r = XE_GPU_REG_SHADER_CONSTANT_FETCH_00_0 + binding.fetch_constant * 6;
+    auto group = reinterpret_cast<const xenos::xe_gpu_fetch_group_t*>(
+        &register_file_->values[r]);
+    TextureInfo texture_info;
+    if (!TextureInfo::Prepare(group->texture_fetch, &texture_info)) {
+      continue;
+    }
+    if (!converted_textures_.insert(texture_info.hash()).second) {
+      // Already converted; a real backend would have it cached too.
+      continue;
+    }
+
+    // Only the base level is converted, which is the bulk of the work.
+    uint32_t offset_x = 0;
+    uint32_t offset_y = 0;
+    uint32_t address = texture_info.GetMipLocation(
+        texture_info.mip_min_level, &offset_x, &offset_y, true);
+    if (!address) {
+      continue;
+    }
+    auto format_info = texture_info.format_info();
+    auto extent = texture_info.GetMipExtent(texture_info.mip_min_level, true);
+    uint32_t pitch = extent.block_pitch_h * format_info->bytes_per_block();
+    texture_scratch_.resize(size_t(pitch) * extent.block_pitch_v *
+                            extent.depth);
+    auto src = memory_->TranslatePhysical<const uint8_t*>(address);
+    auto dest = texture_scratch_.data();
+    for (uint32_t face = 0; face < extent.depth; face++) {
+      if (!texture_info.is_tiled) {
+        for (uint32_t y = 0; y < extent.block_height; y++) {
+          texture_conversion::CopySwapBlock(texture_info.endianness,
+                                            dest + y * pitch,
+                                            src + y * pitch, pitch);
+        }
+      } else {
+        texture_conversion::UntileInfo untile_info;
+        std::memset(&untile_info, 0, sizeof(untile_info));
+        untile_info.offset_x = offset_x;
+        untile_info.offset_y = offset_y;
+        untile_info.width = extent.block_width;
+        untile_info.height = extent.block_height;
+        untile_info.input_pitch = extent.block_pitch_h;
+        untile_info.output_pitch = extent.block_pitch_h;
+        untile_info.input_format_info = format_info;
+        untile_info.output_format_info = format_info;
+        Endian endianness = texture_info.endianness;
+        untile_info.copy_callback = [=](auto o, auto i, auto l) {
+          texture_conversion::CopySwapBlock(endianness, o, i, l);
+        };
+        texture_conversion::Untile(dest, src, &untile_info);
+      }
+      src += pitch * extent.block_pitch_v;
+      dest += pitch * extent.block_pitch_v;
+    }
+  }
+}
+
 bool NullCommandProcessor::IssueCopy() { return true; }
 
 }  // namespace null
@@ -10,8 +10,14 @@
 #ifndef XENIA_GPU_NULL_NULL_COMMAND_PROCESSOR_H_
 #define XENIA_GPU_NULL_NULL_COMMAND_PROCESSOR_H_
 
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
 #include "xenia/gpu/command_processor.h"
 #include "xenia/gpu/null/null_graphics_system.h"
+#include "xenia/gpu/shader_translator.h"
 #include "xenia/gpu/xenos.h"
 #include "xenia/kernel/kernel_state.h"
 
@@ -39,6 +45,17 @@ class NullCommandProcessor : public CommandProcessor {
   bool IssueDraw(PrimitiveType prim_type, uint32_t index_count,
                  IndexBufferInfo* index_buffer_info) override;
   bool IssueCopy() override;
+
+  // With --null_gpu_cpu_work, performs the CPU side of a draw the way a real
+  // backend would: shader translation and texture untiling/conversion.
+  void TranslateShader(Shader* shader);
+  void ConvertTextures(const std::vector<Shader::TextureBinding>& bindings);
+
+  std::unique_ptr<ShaderTranslator> shader_translator_;
+  std::unordered_map<uint64_t, std::unique_ptr<Shader>> shader_map_;
+  // Hashes of all textures converted so far.
+  std::unordered_set<uint64_t> converted_textures_;
+  std::vector<uint8_t> texture_scratch_;
 };
 
 }  // namespace null
@@ -0,0 +1,14 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2016 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/null/null_gpu_flags.h"
+
+DEFINE_bool(null_gpu_cpu_work, false,
+            "Translate shaders and convert textures in the null GPU backend, "
+            "as a real backend would. Used for benchmarking.");
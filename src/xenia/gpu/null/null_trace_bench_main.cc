@@ -0,0 +1,273 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2016 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <gflags/gflags.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "xenia/base/clock.h"
+#include "xenia/base/logging.h"
+#include "xenia/base/main.h"
+#include "xenia/base/string.h"
+#include "xenia/base/threading.h"
+#include "xenia/emulator.h"
+#include "xenia/gpu/command_processor.h"
+#include "xenia/gpu/graphics_system.h"
+#include "xenia/gpu/null/null_command_processor.h"
+#include "xenia/gpu/null/null_gpu_flags.h"
+#include "xenia/gpu/null/null_graphics_system.h"
+#include "xenia/gpu/packet_disassembler.h"
+#include "xenia/gpu/trace_reader.h"
+#include "xenia/memory.h"
+
+DEFINE_string(target_trace_file, "", "Specifies the trace file to replay.");
+DEFINE_int32(trace_bench_iterations, 5,
+             "Number of times to replay the trace. The first replay warms the "
+             "shader and texture caches and is reported separately.");
+
+namespace xe {
+namespace gpu {
+namespace null {
+
+// Replays a trace through the null backend's command processor without a
+// window or GPU, timing every packet.
+class TraceBenchmark : public TraceReader {
+ public:
+  struct OpcodeStats {
+    uint64_t count = 0;
+    uint64_t ticks = 0;
+  };
+  struct Results {
+    uint64_t packet_count = 0;
+    uint64_t draw_count = 0;
+    uint64_t total_ticks = 0;
+    std::map<std::string, OpcodeStats> opcodes;
+  };
+
+  bool Setup() {
+    emulator_ = std::make_unique<Emulator>(L"");
+    X_STATUS result = emulator_->Setup(
+        nullptr, nullptr,
+        []() {
+          return std::unique_ptr<GraphicsSystem>(new NullGraphicsSystem());
+        },
+        nullptr);
+    if (XFAILED(result)) {
+      XELOGE("Failed to setup emulator: %.8X", result);
+      return false;
+    }
+    graphics_system_ = emulator_->graphics_system();
+
+    // Need to allocate all of physical memory so that we can write to it
+    // during playback.
+    graphics_system_->memory()
+        ->LookupHeapByType(true, 4096)
+        ->AllocFixed(0, 0x1FFFFFFF, 4096,
+                     kMemoryAllocationReserve | kMemoryAllocationCommit,
+                     kMemoryProtectRead | kMemoryProtectWrite);
+
+    playback_event_ = xe::threading::Event::CreateAutoResetEvent(false);
+    return true;
+  }
+
+  void Shutdown() { emulator_.reset(); }
+
+  // Replays the whole trace once on the command processor thread.
+  void Replay(Results* results) {
+    graphics_system_->command_processor()->CallInThread(
+        [this, results]() { ReplayOnThread(results); });
+    xe::threading::Wait(playback_event_.get(), false);
+  }
+
+ private:
+  void ReplayOnThread(Results* results) {
+    auto memory = graphics_system_->memory();
+    auto command_processor = graphics_system_->command_processor();
+    command_processor->set_swap_mode(SwapMode::kIgnored);
+
+    uint64_t start_ticks = Clock::QueryHostTickCount();
+    auto trace_ptr = trace_data_ + sizeof(TraceHeader);
+    const PacketStartCommand* pending_packet = nullptr;
+    while (trace_ptr < trace_data_ + trace_size_) {
+      auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
+      switch (type) {
+        case TraceCommandType::kPrimaryBufferStart: {
+          auto cmd =
+              reinterpret_cast<const PrimaryBufferStartCommand*>(trace_ptr);
+          trace_ptr += sizeof(*cmd) + cmd->count * 4;
+          break;
+        }
+        case TraceCommandType::kPrimaryBufferEnd:
+          trace_ptr += sizeof(PrimaryBufferEndCommand);
+          break;
+        case TraceCommandType::kIndirectBufferStart: {
+          auto cmd =
+              reinterpret_cast<const IndirectBufferStartCommand*>(trace_ptr);
+          trace_ptr += sizeof(*cmd) + cmd->count * 4;
+          break;
+        }
+        case TraceCommandType::kIndirectBufferEnd:
+          trace_ptr += sizeof(IndirectBufferEndCommand);
+          break;
+        case TraceCommandType::kPacketStart: {
+          auto cmd = reinterpret_cast<const PacketStartCommand*>(trace_ptr);
+          trace_ptr += sizeof(*cmd);
+          std::memcpy(memory->TranslatePhysical(cmd->base_ptr), trace_ptr,
+                      cmd->count * 4);
+          trace_ptr += cmd->count * 4;
+          pending_packet = cmd;
+          break;
+        }
+        case TraceCommandType::kPacketEnd: {
+          trace_ptr += sizeof(PacketEndCommand);
+          if (!pending_packet) {
+            break;
+          }
+          auto packet_ptr =
+              reinterpret_cast<const uint8_t*>(pending_packet + 1);
+          uint64_t packet_start_ticks = Clock::QueryHostTickCount();
+          command_processor->ExecutePacket(pending_packet->base_ptr,
+                                           pending_packet->count);
+          uint64_t packet_ticks =
+              Clock::QueryHostTickCount() - packet_start_ticks;
+
+          PacketInfo packet_info;
+          const char* name = "<invalid>";
+          if (PacketDisassembler::DisasmPacket(packet_ptr, &packet_info)) {
+            name = packet_info.type_info->name;
+            if (packet_info.type_info->category == PacketCategory::kDraw) {
+              ++results->draw_count;
+            }
+          }
+          auto& opcode_stats = results->opcodes[name];
+          ++opcode_stats.count;
+          opcode_stats.ticks += packet_ticks;
+          ++results->packet_count;
+          pending_packet = nullptr;
+          break;
+        }
+        case TraceCommandType::kMemoryRead: {
+          auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
+          trace_ptr += sizeof(*cmd);
+          DecompressMemory(cmd->encoding_format, trace_ptr, cmd->encoded_length,
+                           memory->TranslatePhysical(cmd->base_ptr),
+                           cmd->decoded_length);
+          trace_ptr += cmd->encoded_length;
+          break;
+        }
+        case TraceCommandType::kMemoryWrite: {
+          auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
+          trace_ptr += sizeof(*cmd) + cmd->encoded_length;
+          break;
+        }
+        case TraceCommandType::kEvent:
+          trace_ptr += sizeof(EventCommand);
+          break;
+        default:
+          // Broken trace file?
+          assert_unhandled_case(type);
+          trace_ptr = trace_data_ + trace_size_;
+          break;
+      }
+    }
+    results->total_ticks += Clock::QueryHostTickCount() - start_ticks;
+
+    command_processor->set_swap_mode(SwapMode::kNormal);
+    playback_event_->Set();
+  }
+
+  std::unique_ptr<Emulator> emulator_;
+  GraphicsSystem* graphics_system_ = nullptr;
+  std::unique_ptr<xe::threading::Event> playback_event_;
+};
+
+void PrintResults(const char* label, const TraceBenchmark::Results& results,
+                  int iterations) {
+  double frequency = double(Clock::host_tick_frequency());
+  double seconds = results.total_ticks / frequency;
+  std::printf("%s: %d replay(s), %.3f ms/replay\n", label, iterations,
+              seconds * 1000.0 / iterations);
+  std::printf("  packets: %" PRIu64 " (%.0f packets/s)\n",
+              results.packet_count, results.packet_count / seconds);
+  std::printf("  draws:   %" PRIu64 " (%.0f draws/s)\n", results.draw_count,
+              results.draw_count / seconds);
+
+  // Most expensive opcodes first.
+  std::vector<std::pair<std::string, TraceBenchmark::OpcodeStats>> opcodes(
+      results.opcodes.begin(), results.opcodes.end());
+  std::sort(opcodes.begin(), opcodes.end(), [](const auto& a, const auto& b) {
+    return a.second.ticks > b.second.ticks;
+  });
+  std::printf("  %-28s %10s %12s %10s %7s\n", "opcode", "count", "total us",
+              "avg ns", "time%");
+  for (auto& it : opcodes) {
+    double opcode_seconds = it.second.ticks / frequency;
+    std::printf("  %-28s %10" PRIu64 " %12.0f %10.1f %6.2f%%\n",
+                it.first.c_str(), it.second.count, opcode_seconds * 1000000.0,
+                opcode_seconds * 1000000000.0 / it.second.count,
+                opcode_seconds * 100.0 / seconds);
+  }
+}
+
+int trace_bench_main(const std::vector<std::wstring>& args) {
+  // Grab path from the flag or unnamed argument.
+  std::wstring path;
+  if (!FLAGS_target_trace_file.empty()) {
+    path = xe::to_wstring(FLAGS_target_trace_file);
+  } else if (args.size() >= 2) {
+    path = args[1];
+  }
+  if (path.empty()) {
+    XELOGE("No trace file specified");
+    return 5;
+  }
+
+  // The point of the benchmark is the CPU side of the GPU pipeline, so always
+  // do the shader/texture work a real backend would.
+  FLAGS_null_gpu_cpu_work = true;
+
+  TraceBenchmark benchmark;
+  if (!benchmark.Setup()) {
+    XELOGE("Unable to setup trace benchmark");
+    return 4;
+  }
+  if (!benchmark.Open(xe::to_absolute_path(path))) {
+    XELOGE("Unable to load trace file; not found?");
+    return 5;
+  }
+
+  int iterations = std::max(FLAGS_trace_bench_iterations, 1);
+  TraceBenchmark::Results cold_results;
+  benchmark.Replay(&cold_results);
+  PrintResults("cold", cold_results, 1);
+  if (iterations > 1) {
+    TraceBenchmark::Results warm_results;
+    for (int i = 1; i < iterations; ++i) {
+      benchmark.Replay(&warm_results);
+    }
+    PrintResults("warm", warm_results, iterations - 1);
+  }
+
+  benchmark.Close();
+  benchmark.Shutdown();
+  return 0;
+}
+
+}  // namespace null
+}  // namespace gpu
+}  // namespace xe
+
+DEFINE_ENTRY_POINT(L"xenia-gpu-null-trace-bench",
+                   L"xenia-gpu-null-trace-bench some.xtr",
+                   xe::gpu::null::trace_bench_main);
@@ -19,3 +19,54 @@ project("xenia-gpu-null")
     project_root.."/third_party/gflags/src",
   })
   local_platform_files()
+
+group("src")
+project("xenia-gpu-null-trace-bench")
+  uuid("b6f6a1e2-3c1d-4f52-9a77-5d0e8c2b41f3")
+  kind("ConsoleApp")
+  language("C++")
+  links({
+    "capstone",
+    "gflags",
+    "glslang-spirv",
+    "imgui",
+    "libavcodec",
+    "libavutil",
+    "snappy",
+    "spirv-tools",
+    "volk",
+    "xenia-apu",
+    "xenia-apu-nop",
+    "xenia-base",
+    "xenia-core",
+    "xenia-cpu",
+    "xenia-cpu-backend-x64",
+    "xenia-gpu",
+    "xenia-gpu-null",
+    "xenia-hid",
+    "xenia-hid-nop",
+    "xenia-kernel",
+    "xenia-ui",
+    "xenia-ui-spirv",
+    "xenia-ui-vulkan",
+    "xenia-vfs",
+    "xxhash",
+  })
+  defines({
+  })
+  includedirs({
+    project_root.."/third_party/gflags/src",
+  })
+  files({
+    "null_trace_bench_main.cc",
+    "../../base/main_"..platform_suffix..".cc",
+  })
+
+  filter("platforms:Linux")
+    links({
+      "X11",
+      "xcb",
+      "X11-xcb",
+      "GL",
+      "vulkan",
+    })
@@ -33,10 +33,12 @@ project("xenia-gpu-shader-compiler")
   links({
     "gflags",
     "glslang-spirv",
+    "snappy",
     "spirv-tools",
     "xenia-base",
     "xenia-gpu",
     "xenia-ui-spirv",
+    "xxhash",
   })
   defines({
   })
@@ -9,30 +9,358 @@
 
 #include <gflags/gflags.h>
 
+#include <atomic>
 #include <cinttypes>
 #include <cstring>
+#include <memory>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include "third_party/xxhash/xxhash.h"
+#include "xenia/base/byte_order.h"
+#include "xenia/base/clock.h"
+#include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/main.h"
+#include "xenia/base/math.h"
 #include "xenia/base/string.h"
+#include "xenia/base/threading.h"
 #include "xenia/gpu/glsl_shader_translator.h"
 #include "xenia/gpu/shader_translator.h"
 #include "xenia/gpu/spirv_shader_translator.h"
+#include "xenia/gpu/trace_reader.h"
+#include "xenia/gpu/xenos.h"
 #include "xenia/ui/spirv/spirv_disassembler.h"
 
-DEFINE_string(shader_input, "", "Input shader binary file path.");
+DEFINE_string(shader_input, "",
+              "Input shader binary file path. May also be a directory of "
+              ".vs/.ps files or a .xtr trace to translate in batch mode.");
 DEFINE_string(shader_input_type, "",
               "'vs', 'ps', or unspecified to infer from the given filename.");
-DEFINE_string(shader_output, "", "Output shader file path.");
+DEFINE_string(shader_output, "",
+              "Output shader file path. In batch mode, a directory.");
 DEFINE_string(shader_output_type, "ucode",
               "Translator to use: [ucode, glsl45, spirv, spirvtext].");
+DEFINE_string(shader_batch_csv, "",
+              "Batch mode: path of the per-shader CSV report (stdout if "
+              "unspecified).");
+DEFINE_int32(shader_batch_threads, 0,
+             "Batch mode: number of translation threads (0 = all cores).");
 
 namespace xe {
 namespace gpu {
 
+std::unique_ptr<ShaderTranslator> CreateTranslator() {
+  if (FLAGS_shader_output_type == "spirv" ||
+      FLAGS_shader_output_type == "spirvtext") {
+    return std::make_unique<SpirvShaderTranslator>();
+  } else if (FLAGS_shader_output_type == "glsl45") {
+    return std::make_unique<GlslShaderTranslator>(
+        GlslShaderTranslator::Dialect::kGL45);
+  } else {
+    return std::make_unique<UcodeShaderTranslator>();
+  }
+}
+
+// Translates the shader and returns the output in the requested format.
+bool TranslateShader(ShaderTranslator* translator, Shader* shader,
+                     std::vector<uint8_t>* out_data) {
+  bool success = translator->Translate(shader);
+
+  const void* source_data = shader->translated_binary().data();
+  size_t source_data_size = shader->translated_binary().size();
+
+  std::unique_ptr<xe::ui::spirv::SpirvDisassembler::Result> spirv_disasm_result;
+  if (success && FLAGS_shader_output_type == "spirvtext") {
+    // Disassemble SPIRV.
+    spirv_disasm_result = xe::ui::spirv::SpirvDisassembler().Disassemble(
+        reinterpret_cast<const uint32_t*>(source_data), source_data_size / 4);
+    source_data = spirv_disasm_result->text();
+    source_data_size = std::strlen(spirv_disasm_result->text()) + 1;
+  }
+
+  out_data->resize(source_data_size);
+  std::memcpy(out_data->data(), source_data, source_data_size);
+  return success;
+}
+
+// Infers the shader type from a .vs/.ps file extension.
+bool GetShaderTypeFromPath(const std::string& path, ShaderType* out_type) {
+  auto last_dot = path.find_last_of('.');
+  if (last_dot == std::string::npos) {
+    return false;
+  }
+  if (path.substr(last_dot) == ".vs") {
+    *out_type = ShaderType::kVertex;
+    return true;
+  } else if (path.substr(last_dot) == ".ps") {
+    *out_type = ShaderType::kPixel;
+    return true;
+  }
+  return false;
+}
+
+bool ReadShaderFile(const std::wstring& path,
+                    std::vector<uint32_t>* out_ucode_dwords) {
+  auto input_file = xe::filesystem::OpenFile(path, "rb");
+  if (!input_file) {
+    return false;
+  }
+  fseek(input_file, 0, SEEK_END);
+  size_t input_file_size = ftell(input_file);
+  fseek(input_file, 0, SEEK_SET);
+  out_ucode_dwords->resize(input_file_size / 4);
+  fread(out_ucode_dwords->data(), 4, out_ucode_dwords->size(), input_file);
+  fclose(input_file);
+  return true;
+}
+
+// A single shader queued for batch translation. Ucode is in guest
+// (big-endian) order, as it appears in memory and in dumped files.
+struct BatchShader {
+  std::string name;
+  ShaderType type;
+  std::vector<uint32_t> ucode_dwords;
+
+  // Results.
+  bool success = false;
+  uint64_t translation_time_us = 0;
+  size_t output_size = 0;
+};
+
+// Gathers all .vs/.ps files in the given directory.
+void GatherShadersFromFolder(const std::wstring& path,
+                             std::vector<BatchShader>* out_shaders) {
+  for (auto& file_info : xe::filesystem::ListFiles(path)) {
+    if (file_info.type != xe::filesystem::FileInfo::Type::kFile) {
+      continue;
+    }
+    BatchShader shader;
+    shader.name = xe::to_string(file_info.name);
+    if (!GetShaderTypeFromPath(shader.name, &shader.type)) {
+      continue;
+    }
+    if (!ReadShaderFile(xe::join_paths(path, file_info.name),
+                        &shader.ucode_dwords)) {
+      XELOGE("Unable to read %s", shader.name.c_str());
+      continue;
+    }
+    out_shaders->push_back(std::move(shader));
+  }
+}
+
+// Walks the raw trace stream to find all shaders loaded with IM_LOAD and
+// IM_LOAD_IMMEDIATE. Shaders are deduplicated by their ucode hash.
+class TraceShaderGatherer : public TraceReader {
+ public:
+  void Gather(std::vector<BatchShader>* out_shaders) {
+    std::unordered_set<uint64_t> seen_hashes;
+    auto AddShader = [&](ShaderType type, const uint32_t* ucode_dwords,
+                         uint32_t dword_count) {
+      uint64_t hash = XXH64(ucode_dwords, dword_count * 4, 0);
+      if (!seen_hashes.insert(hash).second) {
+        return;
+      }
+      BatchShader shader;
+      char name[64];
+      std::snprintf(name, xe::countof(name), "shader_%.16" PRIX64 ".%s", hash,
+                    type == ShaderType::kVertex ? "vs" : "ps");
+      shader.name = name;
+      shader.type = type;
+      shader.ucode_dwords.assign(ucode_dwords, ucode_dwords + dword_count);
+      out_shaders->push_back(std::move(shader));
+    };
+
+    // IM_LOAD reads the shader from memory; the read follows its packet.
+    uint32_t pending_load_address = 0;
+    ShaderType pending_load_type = ShaderType::kVertex;
+
+    auto trace_ptr = trace_data_ + sizeof(TraceHeader);
+    while (trace_ptr < trace_data_ + trace_size_) {
+      auto type = static_cast<TraceCommandType>(xe::load<uint32_t>(trace_ptr));
+      switch (type) {
+        case TraceCommandType::kPrimaryBufferStart:
+          trace_ptr += sizeof(PrimaryBufferStartCommand);
+          break;
+        case TraceCommandType::kPrimaryBufferEnd:
+          trace_ptr += sizeof(PrimaryBufferEndCommand);
+          break;
+        case TraceCommandType::kIndirectBufferStart:
+          trace_ptr += sizeof(IndirectBufferStartCommand);
+          break;
+        case TraceCommandType::kIndirectBufferEnd:
+          trace_ptr += sizeof(IndirectBufferEndCommand);
+          break;
+        case TraceCommandType::kPacketStart: {
+          auto cmd = reinterpret_cast<const PacketStartCommand*>(trace_ptr);
+          trace_ptr += sizeof(*cmd);
+          auto packet_dwords = reinterpret_cast<const uint32_t*>(trace_ptr);
+          trace_ptr += cmd->count * 4;
+          if (cmd->count < 3) {
+            break;
+          }
+          uint32_t packet = xe::byte_swap(packet_dwords[0]);
+          if (packet >> 30 != 0x3) {
+            break;
+          }
+          uint32_t opcode = (packet >> 8) & 0x7F;
+          if (opcode == xenos::PM4_IM_LOAD) {
+            uint32_t addr_type = xe::byte_swap(packet_dwords[1]);
+            pending_load_type = static_cast<ShaderType>(addr_type & 0x3);
+            pending_load_address = addr_type & ~0x3;
+          } else if (opcode == xenos::PM4_IM_LOAD_IMMEDIATE) {
+            auto shader_type =
+                static_cast<ShaderType>(xe::byte_swap(packet_dwords[1]));
+            uint32_t size_dwords = xe::byte_swap(packet_dwords[2]) & 0xFFFF;
+            if (size_dwords + 3 <= cmd->count) {
+              AddShader(shader_type, packet_dwords + 3, size_dwords);
+            }
+          }
+          break;
+        }
+        case TraceCommandType::kPacketEnd:
+          trace_ptr += sizeof(PacketEndCommand);
+          break;
+        case TraceCommandType::kMemoryRead:
+        case TraceCommandType::kMemoryWrite: {
+          auto cmd = reinterpret_cast<const MemoryCommand*>(trace_ptr);
+          trace_ptr += sizeof(*cmd);
+          if (type == TraceCommandType::kMemoryRead && pending_load_address &&
+              (pending_load_address & 0x1FFFFFFF) == cmd->base_ptr) {
+            std::vector<uint32_t> ucode_dwords(cmd->decoded_length / 4);
+            if (DecompressMemory(cmd->encoding_format, trace_ptr,
+                                 cmd->encoded_length,
+                                 reinterpret_cast<uint8_t*>(
+                                     ucode_dwords.data()),
+                                 ucode_dwords.size() * 4)) {
+              AddShader(pending_load_type, ucode_dwords.data(),
+                        uint32_t(ucode_dwords.size()));
+            }
+            pending_load_address = 0;
+          }
+          trace_ptr += cmd->encoded_length;
+          break;
+        }
+        case TraceCommandType::kEvent:
+          trace_ptr += sizeof(EventCommand);
+          break;
+        default:
+          // Broken trace file?
+          assert_unhandled_case(type);
+          return;
+      }
+    }
+  }
+};
+
+int shader_compiler_batch_main() {
+  auto input_path = xe::to_wstring(FLAGS_shader_input);
+  std::vector<BatchShader> shaders;
+  if (xe::filesystem::IsFolder(input_path)) {
+    GatherShadersFromFolder(input_path, &shaders);
+  } else {
+    TraceShaderGatherer gatherer;
+    if (!gatherer.Open(input_path)) {
+      XELOGE("Unable to open trace file: %s", FLAGS_shader_input.c_str());
+      return 1;
+    }
+    gatherer.Gather(&shaders);
+  }
+  XELOGI("Translating %" PRId64 " shaders from %s", shaders.size(),
+         FLAGS_shader_input.c_str());
+
+  auto output_path = xe::to_wstring(FLAGS_shader_output);
+  if (!output_path.empty()) {
+    xe::filesystem::CreateFolder(output_path);
+  }
+
+  uint32_t thread_count = FLAGS_shader_batch_threads > 0
+                              ? uint32_t(FLAGS_shader_batch_threads)
+                              : xe::threading::logical_processor_count();
+  std::atomic<size_t> next_shader_index(0);
+  uint64_t start_ticks = Clock::QueryHostTickCount();
+  std::vector<std::unique_ptr<xe::threading::Thread>> threads;
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    threads.push_back(xe::threading::Thread::Create({}, [&]() {
+      // Translators carry per-shader state and can't be shared.
+      auto translator = CreateTranslator();
+      std::vector<uint8_t> output_data;
+      while (true) {
+        size_t index = next_shader_index++;
+        if (index >= shaders.size()) {
+          break;
+        }
+        auto& batch_shader = shaders[index];
+        uint64_t shader_start_ticks = Clock::QueryHostTickCount();
+        Shader shader(batch_shader.type, 0, batch_shader.ucode_dwords.data(),
+                      batch_shader.ucode_dwords.size());
+        batch_shader.success =
+            TranslateShader(translator.get(), &shader, &output_data);
+        batch_shader.translation_time_us =
+            (Clock::QueryHostTickCount() - shader_start_ticks) * 1000000 /
+            Clock::host_tick_frequency();
+        batch_shader.output_size = output_data.size();
+        if (batch_shader.success && !output_path.empty()) {
+          auto output_file = xe::filesystem::OpenFile(
+              xe::join_paths(output_path,
+                             xe::to_wstring(batch_shader.name + "." +
+                                            FLAGS_shader_output_type)),
+              "wb");
+          if (output_file) {
+            fwrite(output_data.data(), 1, output_data.size(), output_file);
+            fclose(output_file);
+          }
+        }
+      }
+    }));
+  }
+  for (auto& thread : threads) {
+    xe::threading::Wait(thread.get(), false);
+  }
+  uint64_t total_time_us = (Clock::QueryHostTickCount() - start_ticks) *
+                           1000000 / Clock::host_tick_frequency();
+
+  FILE* csv_file = stdout;
+  if (!FLAGS_shader_batch_csv.empty()) {
+    csv_file = xe::filesystem::OpenFile(
+        xe::to_wstring(FLAGS_shader_batch_csv), "wt");
+    if (!csv_file) {
+      XELOGE("Unable to open CSV file: %s", FLAGS_shader_batch_csv.c_str());
+      return 1;
+    }
+  }
+  size_t failure_count = 0;
+  fprintf(csv_file, "name,type,ucode_bytes,success,time_us,output_bytes\n");
+  for (auto& batch_shader : shaders) {
+    if (!batch_shader.success) {
+      ++failure_count;
+    }
+    fprintf(csv_file, "%s,%s,%" PRId64 ",%d,%" PRIu64 ",%" PRId64 "\n",
+            batch_shader.name.c_str(),
+            batch_shader.type == ShaderType::kVertex ? "vs" : "ps",
+            batch_shader.ucode_dwords.size() * 4, batch_shader.success ? 1 : 0,
+            batch_shader.translation_time_us, batch_shader.output_size);
+  }
+  if (csv_file != stdout) {
+    fclose(csv_file);
+  }
+
+  XELOGI("Translated %" PRId64 " shaders (%" PRId64 " failed) in %" PRIu64
+         "us on %u threads",
+         shaders.size(), failure_count, total_time_us, thread_count);
+  return failure_count ? 1 : 0;
+}
+
 int shader_compiler_main(const std::vector<std::wstring>& args) {
+  // Directories and traces are translated in batch.
+  auto input_path = xe::to_wstring(FLAGS_shader_input);
+  if (xe::filesystem::IsFolder(input_path) ||
+      xe::find_name_from_path(input_path).find(
+          std::wstring(L".") + kTraceExtension) != std::wstring::npos) {
+    return shader_compiler_batch_main();
+  }
+
   ShaderType shader_type;
   if (!FLAGS_shader_input_type.empty()) {
     if (FLAGS_shader_input_type == "vs") {
@@ -43,37 +371,18 @@ int shader_compiler_main(const std::vector<std::wstring>& args) {
       XELOGE("Invalid --shader_input_type; must be 'vs' or 'ps'.");
       return 1;
     }
-  } else {
-    auto last_dot = FLAGS_shader_input.find_last_of('.');
-    bool valid_type = false;
-    if (last_dot != std::string::npos) {
-      if (FLAGS_shader_input.substr(last_dot) == ".vs") {
-        shader_type = ShaderType::kVertex;
-        valid_type = true;
-      } else if (FLAGS_shader_input.substr(last_dot) == ".ps") {
-        shader_type = ShaderType::kPixel;
-        valid_type = true;
-      }
-    }
-    if (!valid_type) {
-      XELOGE(
-          "File type not recognized (use .vs, .ps or "
-          "--shader_input_type=vs|ps).");
-      return 1;
-    }
+  } else if (!GetShaderTypeFromPath(FLAGS_shader_input, &shader_type)) {
+    XELOGE(
+        "File type not recognized (use .vs, .ps or "
+        "--shader_input_type=vs|ps).");
+    return 1;
   }
 
-  auto input_file = fopen(FLAGS_shader_input.c_str(), "rb");
-  if (!input_file) {
+  std::vector<uint32_t> ucode_dwords;
+  if (!ReadShaderFile(input_path, &ucode_dwords)) {
     XELOGE("Unable to open input file: %s", FLAGS_shader_input.c_str());
     return 1;
   }
-  fseek(input_file, 0, SEEK_END);
-  size_t input_file_size = ftell(input_file);
-  fseek(input_file, 0, SEEK_SET);
-  std::vector<uint32_t> ucode_dwords(input_file_size / 4);
-  fread(ucode_dwords.data(), 4, ucode_dwords.size(), input_file);
-  fclose(input_file);
 
   XELOGI("Opened %s as a %s shader, %" PRId64 " words (%" PRId64 " bytes).",
          FLAGS_shader_input.c_str(),
@@ -85,34 +394,13 @@ int shader_compiler_main(const std::vector<std::wstring>& args) {
   auto shader = std::make_unique<Shader>(
       shader_type, ucode_data_hash, ucode_dwords.data(), ucode_dwords.size());
 
-  std::unique_ptr<ShaderTranslator> translator;
-  if (FLAGS_shader_output_type == "spirv" ||
-      FLAGS_shader_output_type == "spirvtext") {
-    translator = std::make_unique<SpirvShaderTranslator>();
-  } else if (FLAGS_shader_output_type == "glsl45") {
-    translator = std::make_unique<GlslShaderTranslator>(
-        GlslShaderTranslator::Dialect::kGL45);
-  } else {
-    translator = std::make_unique<UcodeShaderTranslator>();
-  }
-
-  translator->Translate(shader.get());
-
-  const void* source_data = shader->translated_binary().data();
-  size_t source_data_size = shader->translated_binary().size();
-
-  std::unique_ptr<xe::ui::spirv::SpirvDisassembler::Result> spirv_disasm_result;
-  if (FLAGS_shader_output_type == "spirvtext") {
-    // Disassemble SPIRV.
-    spirv_disasm_result = xe::ui::spirv::SpirvDisassembler().Disassemble(
-        reinterpret_cast<const uint32_t*>(source_data), source_data_size / 4);
-    source_data = spirv_disasm_result->text();
-    source_data_size = std::strlen(spirv_disasm_result->text()) + 1;
-  }
+  auto translator = CreateTranslator();
+  std::vector<uint8_t> output_data;
+  TranslateShader(translator.get(), shader.get(), &output_data);
 
   if (!FLAGS_shader_output.empty()) {
     auto output_file = fopen(FLAGS_shader_output.c_str(), "wb");
-    fwrite(source_data, 1, source_data_size, output_file);
+    fwrite(output_data.data(), 1, output_data.size(), output_file);
     fclose(output_file);
   }
 
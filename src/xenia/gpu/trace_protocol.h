@@ -23,7 +23,7 @@ static const wchar_t kTraceExtension[] = L"xtr";
 // Other changes besides the file format may require bumps, such as
 // anything that changes what is recorded into the files (new GPU
 // command processor commands, etc).
-constexpr uint32_t kTraceFormatVersion = 1;
+constexpr uint32_t kTraceFormatVersion = 2;
 
 // Trace file header identifying information about the trace.
 // This must be positioned at the start of the file and must only occur once.
@@ -40,6 +40,26 @@ struct TraceHeader {
   uint32_t title_id;
 };
 
+// The compression format used for trace blocks.
+enum class BlockEncodingFormat : uint32_t {
+  // Data is in its raw form. encoded_length == decoded_length.
+  kNone,
+  // Data is compressed with third_party/snappy.
+  kSnappy,
+};
+
+// Everything following the TraceHeader is a sequence of blocks, each a
+// TraceBlockHeader followed by encoded_length bytes of data. The decoded
+// contents of all blocks concatenated form the command stream. Commands may
+// span block boundaries.
+struct TraceBlockHeader {
+  BlockEncodingFormat encoding_format;
+  // Number of bytes the block occupies in the trace file after this header.
+  uint32_t encoded_length;
+  // Number of bytes of command stream the block decodes to.
+  uint32_t decoded_length;
+};
+
 // Tags each command in the trace file stream as one of the *Command types.
 // Each command has this value as its first dword.
 enum class TraceCommandType : uint32_t {
@@ -92,6 +112,16 @@ enum class MemoryEncodingFormat {
   kNone,
   // Data is compressed with third_party/snappy.
   kSnappy,
+  // Data is identical to that of an earlier memory command. The encoded data
+  // is a MemoryReference locating that command.
+  kReference,
+};
+
+// Payload of a MemoryEncodingFormat::kReference memory command.
+struct MemoryReference {
+  // Offset of the referenced MemoryCommand from the start of the command
+  // stream (the first byte after the TraceHeader).
+  uint64_t command_offset;
 };
 
 // Represents the GPU reading or writing data from or to memory.
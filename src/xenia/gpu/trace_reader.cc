@@ -9,6 +9,7 @@
 
 #include "xenia/gpu/trace_reader.h"
 
+#include <algorithm>
 #include <cinttypes>
 
 #include "third_party/snappy/snappy.h"
@@ -16,6 +17,7 @@
 #include "xenia/base/logging.h"
 #include "xenia/base/mapped_memory.h"
 #include "xenia/base/math.h"
+#include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/packet_disassembler.h"
 #include "xenia/gpu/trace_protocol.h"
 #include "xenia/memory.h"
@@ -34,6 +36,11 @@ bool TraceReader::Open(const std::wstring& path) {
   trace_data_ = reinterpret_cast<const uint8_t*>(mmap_->data());
   trace_size_ = mmap_->size();
 
+  if (trace_size_ < sizeof(TraceHeader)) {
+    XELOGE("Trace file is too small to be a trace");
+    return false;
+  }
+
   // Verify version.
   auto header = reinterpret_cast<const TraceHeader*>(trace_data_);
   if (header->version != kTraceFormatVersion) {
@@ -47,6 +54,19 @@ bool TraceReader::Open(const std::wstring& path) {
 
   auto path_str = xe::to_string(path);
   XELOGI("Mapped %" PRId64 "b trace from %s", trace_size_, path_str.c_str());
+
+  // Everything after the header is block encoded; decode it so that the rest
+  // of the reader can walk a flat command stream. Frames and commands hold
+  // raw pointers into that stream which the player and viewer use from
+  // different threads, so it is decoded whole rather than block by block.
+  if (!DecodeBlocks()) {
+    XELOGE("Unable to decode trace blocks");
+    return false;
+  }
+  header = reinterpret_cast<const TraceHeader*>(trace_data_);
+  // Nothing reads the file after decoding; don't keep it mapped as well.
+  mmap_.reset();
+
   XELOGI("   Version: %u", header->version);
   auto commit_str = std::string(header->build_commit_sha,
                                 xe::countof(header->build_commit_sha));
@@ -60,10 +80,86 @@ bool TraceReader::Open(const std::wstring& path) {
 
 void TraceReader::Close() {
   mmap_.reset();
+  stream_data_.clear();
+  stream_data_.shrink_to_fit();
   trace_data_ = nullptr;
   trace_size_ = 0;
 }
 
+bool TraceReader::DecodeBlocks() {
+  auto file_data = reinterpret_cast<const uint8_t*>(mmap_->data());
+  auto file_end = file_data + mmap_->size();
+
+  // Sum up the block sizes first so we can decode in place.
+  size_t stream_size = 0;
+  auto block_ptr = file_data + sizeof(TraceHeader);
+  while (block_ptr + sizeof(TraceBlockHeader) <= file_end) {
+    auto block = reinterpret_cast<const TraceBlockHeader*>(block_ptr);
+    block_ptr += sizeof(*block);
+    if (block->encoded_length > size_t(file_end - block_ptr)) {
+      // Block data runs past the end of the file.
+      return false;
+    }
+    block_ptr += block->encoded_length;
+    stream_size += block->decoded_length;
+  }
+  if (block_ptr != file_end) {
+    // Truncated block.
+    return false;
+  }
+  uint64_t max_stream_size =
+      uint64_t(std::max(FLAGS_trace_max_decoded_mb, 0)) * 1024 * 1024;
+  if (stream_size > max_stream_size) {
+    XELOGE("Trace decodes to %" PRIu64 "MB, over --trace_max_decoded_mb=%d",
+           uint64_t(stream_size / (1024 * 1024)),
+           FLAGS_trace_max_decoded_mb);
+    return false;
+  }
+
+  // The header is kept at the front so offsets match the file layout.
+  stream_data_.resize(sizeof(TraceHeader) + stream_size);
+  std::memcpy(stream_data_.data(), file_data, sizeof(TraceHeader));
+  auto stream_ptr = stream_data_.data() + sizeof(TraceHeader);
+  block_ptr = file_data + sizeof(TraceHeader);
+  while (block_ptr < file_end) {
+    auto block = reinterpret_cast<const TraceBlockHeader*>(block_ptr);
+    block_ptr += sizeof(*block);
+    switch (block->encoding_format) {
+      case BlockEncodingFormat::kNone:
+        if (block->encoded_length != block->decoded_length) {
+          return false;
+        }
+        std::memcpy(stream_ptr, block_ptr, block->decoded_length);
+        break;
+      case BlockEncodingFormat::kSnappy: {
+        // Corrupt data could otherwise decode past the end of the stream.
+        size_t uncompressed_length = 0;
+        if (!snappy::GetUncompressedLength(
+                reinterpret_cast<const char*>(block_ptr),
+                block->encoded_length, &uncompressed_length) ||
+            uncompressed_length != block->decoded_length) {
+          return false;
+        }
+        if (!snappy::RawUncompress(reinterpret_cast<const char*>(block_ptr),
+                                   block->encoded_length,
+                                   reinterpret_cast<char*>(stream_ptr))) {
+          return false;
+        }
+        break;
+      }
+      default:
+        assert_unhandled_case(block->encoding_format);
+        return false;
+    }
+    block_ptr += block->encoded_length;
+    stream_ptr += block->decoded_length;
+  }
+
+  trace_data_ = stream_data_.data();
+  trace_size_ = stream_data_.size();
+  return true;
+}
+
 void TraceReader::ParseTrace() {
   // Skip file header.
   auto trace_ptr = trace_data_;
@@ -218,12 +314,47 @@ bool TraceReader::DecompressMemory(MemoryEncodingFormat encoding_format,
                                    uint8_t* dest, size_t dest_size) {
   switch (encoding_format) {
     case MemoryEncodingFormat::kNone:
-      assert_true(src_size == dest_size);
+      if (src_size != dest_size) {
+        return false;
+      }
       std::memcpy(dest, src, src_size);
       return true;
-    case MemoryEncodingFormat::kSnappy:
+    case MemoryEncodingFormat::kSnappy: {
+      size_t uncompressed_length = 0;
+      if (!snappy::GetUncompressedLength(reinterpret_cast<const char*>(src),
+                                         src_size, &uncompressed_length) ||
+          uncompressed_length != dest_size) {
+        return false;
+      }
       return snappy::RawUncompress(reinterpret_cast<const char*>(src), src_size,
                                    reinterpret_cast<char*>(dest));
+    }
+    case MemoryEncodingFormat::kReference: {
+      // Same contents as an earlier command; decode that one instead. The
+      // offset comes from the file, so check it lands on a whole command.
+      if (src_size != sizeof(MemoryReference)) {
+        return false;
+      }
+      uint64_t command_offset = xe::load<uint64_t>(src);
+      size_t stream_size = trace_size_ - sizeof(TraceHeader);
+      if (command_offset > stream_size ||
+          sizeof(MemoryCommand) > stream_size - command_offset) {
+        return false;
+      }
+      auto cmd = reinterpret_cast<const MemoryCommand*>(
+          trace_data_ + sizeof(TraceHeader) + command_offset);
+      if ((cmd->type != TraceCommandType::kMemoryRead &&
+           cmd->type != TraceCommandType::kMemoryWrite) ||
+          cmd->encoded_length >
+              stream_size - command_offset - sizeof(MemoryCommand) ||
+          cmd->decoded_length != dest_size ||
+          cmd->encoding_format == MemoryEncodingFormat::kReference) {
+        return false;
+      }
+      return DecompressMemory(cmd->encoding_format,
+                              reinterpret_cast<const uint8_t*>(cmd + 1),
+                              cmd->encoded_length, dest, dest_size);
+    }
     default:
       assert_unhandled_case(encoding_format);
       return false;
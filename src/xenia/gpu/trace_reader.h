@@ -134,12 +134,16 @@ class TraceReader {
   void Close();
 
  protected:
+  // Decodes the blocks following the header into stream_data_.
+  bool DecodeBlocks();
   void ParseTrace();
   bool DecompressMemory(MemoryEncodingFormat encoding_format,
                         const uint8_t* src, size_t src_size, uint8_t* dest,
                         size_t dest_size);
 
   std::unique_ptr<MappedMemory> mmap_;
+  // Header followed by the decoded command stream.
+  std::vector<uint8_t> stream_data_;
   const uint8_t* trace_data_ = nullptr;
   size_t trace_size_ = 0;
   std::vector<Frame> frames_;
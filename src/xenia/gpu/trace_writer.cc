@@ -11,8 +11,8 @@
 
 #include <cstring>
 
-#include "third_party/snappy/snappy-sinksource.h"
 #include "third_party/snappy/snappy.h"
+#include "third_party/xxhash/xxhash.h"
 
 #include "build/version.h"
 #include "xenia/base/assert.h"
@@ -25,7 +25,7 @@ namespace gpu {
 TraceWriter::TraceWriter(uint8_t* membase)
     : membase_(membase), file_(nullptr) {}
 
-TraceWriter::~TraceWriter() = default;
+TraceWriter::~TraceWriter() { Close(); }
 
 bool TraceWriter::Open(const std::wstring& path, uint32_t title_id) {
   Close();
@@ -48,18 +48,41 @@ bool TraceWriter::Open(const std::wstring& path, uint32_t title_id) {
   fwrite(&header, sizeof(header), 1, file_);
 
   cached_memory_reads_.clear();
+  memory_payloads_.clear();
+  stream_offset_ = 0;
+
+  current_block_ = std::make_unique<std::vector<uint8_t>>();
+  current_block_->reserve(kBlockSize);
+  block_count_ = 1;
+  write_thread_running_ = true;
+  write_thread_ =
+      xe::threading::Thread::Create({}, [this]() { WriteThreadMain(); });
+  write_thread_->set_name("GPU Trace Writer");
   return true;
 }
 
 void TraceWriter::Flush() {
   if (file_) {
-    fflush(file_);
+    SubmitBlock();
   }
 }
 
 void TraceWriter::Close() {
   if (file_) {
+    SubmitBlock();
+    {
+      std::lock_guard<std::mutex> lock(block_mutex_);
+      write_thread_running_ = false;
+    }
+    block_cond_.notify_all();
+    xe::threading::Wait(write_thread_.get(), false);
+    write_thread_.reset();
+
+    current_block_.reset();
+    free_blocks_.clear();
+    block_count_ = 0;
     cached_memory_reads_.clear();
+    memory_payloads_.clear();
 
     fflush(file_);
     fclose(file_);
@@ -67,6 +90,95 @@ void TraceWriter::Close() {
   }
 }
 
+void TraceWriter::Write(const void* data, size_t length) {
+  if (current_block_->size() + length > kBlockSize &&
+      !current_block_->empty()) {
+    SubmitBlock();
+  }
+  auto bytes = reinterpret_cast<const uint8_t*>(data);
+  current_block_->insert(current_block_->end(), bytes, bytes + length);
+  stream_offset_ += length;
+}
+
+void TraceWriter::SubmitBlock() {
+  if (current_block_->empty()) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(block_mutex_);
+  pending_blocks_.push_back(std::move(current_block_));
+  block_cond_.notify_all();
+
+  // Grab a recycled block, or allocate one if we're under the limit.
+  // Otherwise wait for the write thread to catch up.
+  while (free_blocks_.empty() && block_count_ >= kMaxBlockCount) {
+    block_cond_.wait(lock);
+  }
+  if (!free_blocks_.empty()) {
+    current_block_ = std::move(free_blocks_.back());
+    free_blocks_.pop_back();
+  } else {
+    current_block_ = std::make_unique<std::vector<uint8_t>>();
+    current_block_->reserve(kBlockSize);
+    ++block_count_;
+  }
+}
+
+void TraceWriter::WriteThreadMain() {
+  std::vector<char> compressed_data;
+  while (true) {
+    std::unique_ptr<std::vector<uint8_t>> block;
+    {
+      std::unique_lock<std::mutex> lock(block_mutex_);
+      while (pending_blocks_.empty() && write_thread_running_) {
+        block_cond_.wait(lock);
+      }
+      if (pending_blocks_.empty()) {
+        // Shutting down and everything has been written.
+        break;
+      }
+      block = std::move(pending_blocks_.front());
+      pending_blocks_.pop_front();
+    }
+
+    TraceBlockHeader header;
+    header.encoding_format = BlockEncodingFormat::kNone;
+    header.decoded_length = static_cast<uint32_t>(block->size());
+    header.encoded_length = header.decoded_length;
+    const void* block_data = block->data();
+    if (compress_output_) {
+      compressed_data.resize(snappy::MaxCompressedLength(block->size()));
+      size_t compressed_length = 0;
+      snappy::RawCompress(reinterpret_cast<const char*>(block->data()),
+                          block->size(), compressed_data.data(),
+                          &compressed_length);
+      if (compressed_length < block->size()) {
+        header.encoding_format = BlockEncodingFormat::kSnappy;
+        header.encoded_length = static_cast<uint32_t>(compressed_length);
+        block_data = compressed_data.data();
+      }
+    }
+    fwrite(&header, 1, sizeof(header), file_);
+    fwrite(block_data, 1, header.encoded_length, file_);
+
+    bool idle;
+    {
+      std::lock_guard<std::mutex> lock(block_mutex_);
+      block->clear();
+      if (block->capacity() > kBlockSize * 2) {
+        // Don't hang on to the memory of huge one-off commands.
+        block->shrink_to_fit();
+        block->reserve(kBlockSize);
+      }
+      free_blocks_.push_back(std::move(block));
+      idle = pending_blocks_.empty();
+    }
+    block_cond_.notify_all();
+    if (idle) {
+      fflush(file_);
+    }
+  }
+}
+
 void TraceWriter::WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count) {
   if (!file_) {
     return;
@@ -76,7 +188,7 @@ void TraceWriter::WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  Write(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WritePrimaryBufferEnd() {
@@ -86,7 +198,7 @@ void TraceWriter::WritePrimaryBufferEnd() {
   PrimaryBufferEndCommand cmd = {
       TraceCommandType::kPrimaryBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  Write(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
@@ -98,7 +210,7 @@ void TraceWriter::WriteIndirectBufferStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       0,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  Write(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteIndirectBufferEnd() {
@@ -108,7 +220,7 @@ void TraceWriter::WriteIndirectBufferEnd() {
   IndirectBufferEndCommand cmd = {
       TraceCommandType::kIndirectBufferEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  Write(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
@@ -120,8 +232,8 @@ void TraceWriter::WritePacketStart(uint32_t base_ptr, uint32_t count) {
       base_ptr,
       count,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
-  fwrite(membase_ + base_ptr, 4, count, file_);
+  Write(&cmd, sizeof(cmd));
+  Write(membase_ + base_ptr, count * 4);
 }
 
 void TraceWriter::WritePacketEnd() {
@@ -131,7 +243,7 @@ void TraceWriter::WritePacketEnd() {
   PacketEndCommand cmd = {
       TraceCommandType::kPacketEnd,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  Write(&cmd, sizeof(cmd));
 }
 
 void TraceWriter::WriteMemoryRead(uint32_t base_ptr, size_t length) {
@@ -173,18 +285,6 @@ void TraceWriter::WriteMemoryWrite(uint32_t base_ptr, size_t length) {
   WriteMemoryCommand(TraceCommandType::kMemoryWrite, base_ptr, length);
 }
 
-class SnappySink : public snappy::Sink {
- public:
-  SnappySink(FILE* file) : file_(file) {}
-
-  void Append(const char* bytes, size_t n) override {
-    fwrite(bytes, 1, n, file_);
-  }
-
- private:
-  FILE* file_ = nullptr;
-};
-
 void TraceWriter::WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
                                      size_t length) {
   MemoryCommand cmd;
@@ -193,32 +293,26 @@ void TraceWriter::WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
   cmd.encoding_format = MemoryEncodingFormat::kNone;
   cmd.encoded_length = cmd.decoded_length = static_cast<uint32_t>(length);
 
-  bool compress = compress_output_ && length > compression_threshold_;
-  if (compress) {
-    // Write the header now so we reserve space in the buffer.
-    long header_position = std::ftell(file_);
-    cmd.encoding_format = MemoryEncodingFormat::kSnappy;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-
-    // Stream the content right to the buffer.
-    snappy::ByteArraySource snappy_source(
-        reinterpret_cast<const char*>(membase_ + cmd.base_ptr),
-        cmd.decoded_length);
-    SnappySink snappy_sink(file_);
-    cmd.encoded_length =
-        static_cast<uint32_t>(snappy::Compress(&snappy_source, &snappy_sink));
-
-    // Seek back and overwrite the header with our final size.
-    std::fseek(file_, header_position, SEEK_SET);
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    std::fseek(file_, header_position + sizeof(cmd) + cmd.encoded_length,
-               SEEK_SET);
-  } else {
-    // Uncompressed - write buffer directly to the file.
-    cmd.encoding_format = MemoryEncodingFormat::kNone;
-    fwrite(&cmd, 1, sizeof(cmd), file_);
-    fwrite(membase_ + cmd.base_ptr, 1, cmd.decoded_length, file_);
+  // Payloads are written raw; whole blocks are compressed by the write thread.
+  // Content we've already written is replaced with a reference to it.
+  const uint8_t* data = membase_ + cmd.base_ptr;
+  if (length >= dedupe_threshold_) {
+    uint64_t hash = XXH64(data, length, 0);
+    auto it = memory_payloads_.find(hash);
+    if (it != memory_payloads_.end() && it->second.length == length) {
+      MemoryReference reference;
+      reference.command_offset = it->second.command_offset;
+      cmd.encoding_format = MemoryEncodingFormat::kReference;
+      cmd.encoded_length = static_cast<uint32_t>(sizeof(reference));
+      Write(&cmd, sizeof(cmd));
+      Write(&reference, sizeof(reference));
+      return;
+    }
+    memory_payloads_[hash] = {stream_offset_, length};
   }
+
+  Write(&cmd, sizeof(cmd));
+  Write(data, cmd.decoded_length);
 }
 
 void TraceWriter::WriteEvent(EventCommand::Type event_type) {
@@ -229,7 +323,7 @@ void TraceWriter::WriteEvent(EventCommand::Type event_type) {
       TraceCommandType::kEvent,
       event_type,
   };
-  fwrite(&cmd, 1, sizeof(cmd), file_);
+  Write(&cmd, sizeof(cmd));
 }
 
 }  //  namespace gpu
@@ -10,15 +10,26 @@
 #ifndef XENIA_GPU_TRACE_WRITER_H_
 #define XENIA_GPU_TRACE_WRITER_H_
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <set>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/base/filesystem.h"
+#include "xenia/base/threading.h"
 #include "xenia/gpu/trace_protocol.h"
 
 namespace xe {
 namespace gpu {
 
+// Records GPU command streams to a trace file.
+// Commands are appended to in-memory blocks on the calling thread. Full blocks
+// (and partial ones on Flush) are handed to a background thread that
+// compresses and writes them, so capture doesn't block on file I/O.
 class TraceWriter {
  public:
   explicit TraceWriter(uint8_t* membase);
@@ -27,7 +38,10 @@ class TraceWriter {
   bool is_open() const { return file_ != nullptr; }
 
   bool Open(const std::wstring& path, uint32_t title_id);
+  // Hands all buffered commands to the write thread. Does not wait for them
+  // to reach the file.
   void Flush();
+  // Writes all buffered commands and closes the file.
   void Close();
 
   void WritePrimaryBufferStart(uint32_t base_ptr, uint32_t count);
@@ -43,6 +57,15 @@ class TraceWriter {
   void WriteEvent(EventCommand::Type event_type);
 
  private:
+  // Size blocks are submitted at. Single large commands may exceed this.
+  static const size_t kBlockSize = 4 * 1024 * 1024;
+  // Maximum number of blocks buffered before the writer blocks on the write
+  // thread.
+  static const size_t kMaxBlockCount = 16;
+
+  void Write(const void* data, size_t length);
+  void SubmitBlock();
+  void WriteThreadMain();
   void WriteMemoryCommand(TraceCommandType type, uint32_t base_ptr,
                           size_t length);
 
@@ -50,8 +73,31 @@ class TraceWriter {
   uint8_t* membase_;
   FILE* file_;
 
+  // Total bytes of command stream written so far.
+  uint64_t stream_offset_ = 0;
+  // Command stream offset of the first memory command with a given payload,
+  // keyed by payload hash. Repeated payloads are written as references.
+  struct MemoryPayload {
+    uint64_t command_offset;
+    size_t length;
+  };
+  std::unordered_map<uint64_t, MemoryPayload> memory_payloads_;
+
+  // Block being filled by the command processor thread.
+  std::unique_ptr<std::vector<uint8_t>> current_block_;
+  // Blocks recycled by the write thread.
+  std::vector<std::unique_ptr<std::vector<uint8_t>>> free_blocks_;
+  // Blocks waiting to be written.
+  std::deque<std::unique_ptr<std::vector<uint8_t>>> pending_blocks_;
+  size_t block_count_ = 0;
+  std::mutex block_mutex_;
+  std::condition_variable block_cond_;
+  bool write_thread_running_ = false;
+  std::unique_ptr<xe::threading::Thread> write_thread_;
+
   bool compress_output_ = true;
-  size_t compression_threshold_ = 1024;  // Min. number of bytes to compress.
+  // Min. payload size to dedupe; smaller payloads aren't worth a reference.
+  size_t dedupe_threshold_ = 64;
 };
 
 }  // namespace gpu
@@ -0,0 +1,74 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#ifndef XENIA_GPU_VULKAN_CONSTANT_DIRTY_BITS_H_
+#define XENIA_GPU_VULKAN_CONSTANT_DIRTY_BITS_H_
+
+#include <algorithm>
+#include <cstdint>
+
+#include "xenia/gpu/register_file.h"
+
+namespace xe {
+namespace gpu {
+namespace vulkan {
+
+// Dirty tracking for shader constant registers. Constants are tracked in
+// reversed order: the first group is the highest bit of the mask.
+namespace constant_dirty_bits {
+
+// Float constants are tracked in groups of 4 (16 registers). Only the first 64
+// groups (the vertex shader half) fit in the mask; the rest are untracked.
+const uint32_t kFloatGroupCount = 64;
+
+// Mask with bits [lo, hi] set; hi must be below 64.
+inline uint64_t BitRange(uint32_t lo, uint32_t hi) {
+  uint32_t width = hi - lo + 1;
+  return (width >= 64 ? ~0ull : (1ull << width) - 1) << lo;
+}
+
+// Mask with the bits of groups [first, last] of bit_count tracked groups set.
+// Groups at or past bit_count are ignored.
+inline uint64_t GroupRange(uint32_t first, uint32_t last, uint32_t bit_count) {
+  if (first >= bit_count) {
+    return 0;
+  }
+  last = std::min(last, bit_count - 1);
+  return BitRange(bit_count - 1 - last, bit_count - 1 - first);
+}
+
+// Dirty bits for float constant registers [first_index, last_index], which
+// must lie within the float constant range.
+inline uint64_t Float(uint32_t first_index, uint32_t last_index) {
+  return GroupRange((first_index - XE_GPU_REG_SHADER_CONSTANT_000_X) / 16,
+                    (last_index - XE_GPU_REG_SHADER_CONSTANT_000_X) / 16,
+                    kFloatGroupCount);
+}
+
+// Dirty bits for bool constant registers [first_index, last_index].
+inline uint8_t Bool(uint32_t first_index, uint32_t last_index) {
+  return uint8_t(
+      GroupRange(first_index - XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031,
+                 last_index - XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031, 8));
+}
+
+// Dirty bits for loop constant registers [first_index, last_index].
+inline uint32_t Loop(uint32_t first_index, uint32_t last_index) {
+  return uint32_t(
+      GroupRange(first_index - XE_GPU_REG_SHADER_CONSTANT_LOOP_00,
+                 last_index - XE_GPU_REG_SHADER_CONSTANT_LOOP_00, 32));
+}
+
+}  // namespace constant_dirty_bits
+
+}  // namespace vulkan
+}  // namespace gpu
+}  // namespace xe
+
+#endif  // XENIA_GPU_VULKAN_CONSTANT_DIRTY_BITS_H_
@@ -10,6 +10,7 @@
 #include "xenia/gpu/vulkan/pipeline_cache.h"
 
 #include "third_party/xxhash/xxhash.h"
+#include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
@@ -17,6 +18,7 @@
 #include "xenia/gpu/gpu_flags.h"
 #include "xenia/gpu/vulkan/vulkan_gpu_flags.h"
 
+#include <algorithm>
 #include <cinttypes>
 #include <string>
 
@@ -166,10 +168,22 @@ VkResult PipelineCache::Initialize(
                             VK_DEBUG_REPORT_OBJECT_TYPE_SHADER_MODULE_EXT,
                             "S(p): Dummy");
 
+  if (FLAGS_vulkan_async_pipelines) {
+    StartCompileThreads();
+  }
+
   return VK_SUCCESS;
 }
 
 void PipelineCache::Shutdown() {
+  if (compile_threads_running_) {
+    XELOGGPU(
+        "Pipeline cache: %" PRIu64 " misses, %" PRIu64
+        "us spent compiling, %" PRIu64 " draws skipped",
+        pipeline_miss_count_.load(), pipeline_compile_time_us_.load(),
+        skipped_draw_count_);
+  }
+  StopCompileThreads();
   ClearCache();
 
   // Destroy geometry shaders.
@@ -261,12 +275,21 @@ PipelineCache::UpdateStatus PipelineCache::ConfigurePipeline(
   if (!pipeline) {
     // Should have a hash key produced by the UpdateState pass.
     uint64_t hash_key = XXH64_digest(&hash_state_);
-    pipeline = GetPipeline(render_state, hash_key);
+    bool pending = false;
+    pipeline = GetPipeline(render_state, hash_key, &pending);
     current_pipeline_ = pipeline;
+    if (pending) {
+      // Still compiling. The next draw will look it up again.
+      ++skipped_draw_count_;
+      COUNT_profile_add("gpu/pipeline_cache/skipped_draws", 1);
+      return UpdateStatus::kPending;
+    }
     if (!pipeline) {
       // Unable to create pipeline.
       return UpdateStatus::kError;
     }
+    // A different pipeline than the last one bound, so it must be rebound.
+    update_status = UpdateStatus::kMismatch;
   }
 
   *pipeline_out = pipeline;
@@ -274,6 +297,11 @@ PipelineCache::UpdateStatus PipelineCache::ConfigurePipeline(
 }
 
 void PipelineCache::ClearCache() {
+  // In-flight compiles reference our shader modules, so let them finish.
+  WaitForPendingCompiles();
+  ResolveCompiledPipelines();
+  pending_pipelines_.clear();
+
   // Destroy all pipelines.
   for (auto it : cached_pipelines_) {
     vkDestroyPipeline(*device_, it.second, nullptr);
@@ -289,7 +317,14 @@ void PipelineCache::ClearCache() {
 }
 
 VkPipeline PipelineCache::GetPipeline(const RenderState* render_state,
-                                      uint64_t hash_key) {
+                                      uint64_t hash_key, bool* out_pending) {
+  *out_pending = false;
+
+  // Pick up anything the compile threads have finished.
+  if (compile_threads_running_) {
+    ResolveCompiledPipelines();
+  }
+
   // Lookup the pipeline in the cache.
   auto it = cached_pipelines_.find(hash_key);
   if (it != cached_pipelines_.end()) {
@@ -297,6 +332,68 @@ VkPipeline PipelineCache::GetPipeline(const RenderState* render_state,
     return it->second;
   }
 
+  if (pending_pipelines_.count(hash_key)) {
+    // Already queued; don't bother snapshotting the state again.
+    *out_pending = true;
+    return nullptr;
+  }
+
+  ++pipeline_miss_count_;
+  COUNT_profile_add("gpu/pipeline_cache/misses", 1);
+
+  auto request = std::make_unique<PipelineCreateRequest>();
+  SnapshotPipelineState(render_state, hash_key, request.get());
+
+  if (compile_threads_running_) {
+    // Hand off to the compile threads and skip draws until it's ready.
+    pending_pipelines_.insert(hash_key);
+    ++compiles_in_flight_;
+    {
+      std::lock_guard<std::mutex> lock(compile_mutex_);
+      compile_queue_.push_back(std::move(request));
+    }
+    compile_semaphore_->Release(1, nullptr);
+    *out_pending = true;
+    return nullptr;
+  }
+
+  VkPipeline pipeline = CreatePipeline(*request);
+  if (!pipeline) {
+    assert_always();
+    return nullptr;
+  }
+
+  // Add to cache with the hash key for reuse.
+  cached_pipelines_.insert({hash_key, pipeline});
+  COUNT_profile_set("gpu/pipeline_cache/pipelines", cached_pipelines_.size());
+
+  return pipeline;
+}
+
+void PipelineCache::SnapshotPipelineState(const RenderState* render_state,
+                                          uint64_t hash_key,
+                                          PipelineCreateRequest* request) {
+  request->hash_key = hash_key;
+  request->render_pass = render_state->render_pass_handle;
+  request->stage_count = update_shader_stages_stage_count_;
+  std::memcpy(request->stages, update_shader_stages_info_,
+              sizeof(request->stages));
+  request->vertex_input_state = update_vertex_input_state_info_;
+  request->input_assembly_state = update_input_assembly_state_info_;
+  request->viewport_state = update_viewport_state_info_;
+  request->rasterization_state = update_rasterization_state_info_;
+  request->multisample_state = update_multisample_state_info_;
+  request->depth_stencil_state = update_depth_stencil_state_info_;
+  request->color_blend_state = update_color_blend_state_info_;
+  std::memcpy(request->color_blend_attachments,
+              update_color_blend_attachment_states_,
+              sizeof(request->color_blend_attachments));
+  // Repoint at our own copy of the attachments.
+  request->color_blend_state.pAttachments = request->color_blend_attachments;
+}
+
+VkPipeline PipelineCache::CreatePipeline(
+    const PipelineCreateRequest& request) {
   VkPipelineDynamicStateCreateInfo dynamic_state_info;
   dynamic_state_info.sType =
       VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
@@ -321,28 +418,33 @@ VkPipeline PipelineCache::GetPipeline(const RenderState* render_state,
   pipeline_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
   pipeline_info.pNext = nullptr;
   pipeline_info.flags = VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT;
-  pipeline_info.stageCount = update_shader_stages_stage_count_;
-  pipeline_info.pStages = update_shader_stages_info_;
-  pipeline_info.pVertexInputState = &update_vertex_input_state_info_;
-  pipeline_info.pInputAssemblyState = &update_input_assembly_state_info_;
+  pipeline_info.stageCount = request.stage_count;
+  pipeline_info.pStages = request.stages;
+  pipeline_info.pVertexInputState = &request.vertex_input_state;
+  pipeline_info.pInputAssemblyState = &request.input_assembly_state;
   pipeline_info.pTessellationState = nullptr;
-  pipeline_info.pViewportState = &update_viewport_state_info_;
-  pipeline_info.pRasterizationState = &update_rasterization_state_info_;
-  pipeline_info.pMultisampleState = &update_multisample_state_info_;
-  pipeline_info.pDepthStencilState = &update_depth_stencil_state_info_;
-  pipeline_info.pColorBlendState = &update_color_blend_state_info_;
+  pipeline_info.pViewportState = &request.viewport_state;
+  pipeline_info.pRasterizationState = &request.rasterization_state;
+  pipeline_info.pMultisampleState = &request.multisample_state;
+  pipeline_info.pDepthStencilState = &request.depth_stencil_state;
+  pipeline_info.pColorBlendState = &request.color_blend_state;
   pipeline_info.pDynamicState = &dynamic_state_info;
   pipeline_info.layout = pipeline_layout_;
-  pipeline_info.renderPass = render_state->render_pass_handle;
+  pipeline_info.renderPass = request.render_pass;
   pipeline_info.subpass = 0;
   pipeline_info.basePipelineHandle = nullptr;
   pipeline_info.basePipelineIndex = -1;
   VkPipeline pipeline = nullptr;
+  uint64_t start_ticks = Clock::QueryHostTickCount();
   auto result = vkCreateGraphicsPipelines(*device_, pipeline_cache_, 1,
                                           &pipeline_info, nullptr, &pipeline);
+  uint64_t compile_time_us = (Clock::QueryHostTickCount() - start_ticks) *
+                             1000000 / Clock::host_tick_frequency();
+  pipeline_compile_time_us_ += compile_time_us;
+  COUNT_profile_add("gpu/pipeline_cache/compile_time_us", compile_time_us);
   if (result != VK_SUCCESS) {
+    // May be on a compile thread; callers report the failure as kError.
     XELOGE("vkCreateGraphicsPipelines failed with code %d", result);
-    assert_always();
     return nullptr;
   }
 
@@ -356,11 +458,89 @@ VkPipeline PipelineCache::GetPipeline(const RenderState* render_state,
     }
   }
 
-  // Add to cache with the hash key for reuse.
-  cached_pipelines_.insert({hash_key, pipeline});
+  return pipeline;
+}
+
+void PipelineCache::StartCompileThreads() {
+  uint32_t thread_count =
+      uint32_t(std::max(FLAGS_vulkan_pipeline_compile_threads, 1));
+  compile_semaphore_ = xe::threading::Semaphore::Create(0, INT32_MAX);
+  compile_threads_running_ = true;
+  for (uint32_t i = 0; i < thread_count; ++i) {
+    auto thread = xe::threading::Thread::Create(
+        {}, [this]() { CompileThreadMain(); });
+    thread->set_name("Vulkan Pipeline Compiler");
+    compile_threads_.push_back(std::move(thread));
+  }
+}
+
+void PipelineCache::StopCompileThreads() {
+  if (!compile_threads_running_) {
+    return;
+  }
+  compile_threads_running_ = false;
+  compile_semaphore_->Release(int(compile_threads_.size()), nullptr);
+  for (auto& thread : compile_threads_) {
+    xe::threading::Wait(thread.get(), false);
+  }
+  compile_threads_.clear();
+  compile_semaphore_.reset();
+
+  // Anything left in the queue was never started.
+  compiles_in_flight_ -= uint32_t(compile_queue_.size());
+  compile_queue_.clear();
+  ResolveCompiledPipelines();
+  pending_pipelines_.clear();
+}
+
+void PipelineCache::CompileThreadMain() {
+  while (true) {
+    xe::threading::Wait(compile_semaphore_.get(), false);
+    if (!compile_threads_running_) {
+      break;
+    }
+
+    std::unique_ptr<PipelineCreateRequest> request;
+    {
+      std::lock_guard<std::mutex> lock(compile_mutex_);
+      if (compile_queue_.empty()) {
+        continue;
+      }
+      request = std::move(compile_queue_.front());
+      compile_queue_.pop_front();
+    }
+
+    // Failures are still posted so the draw thread stops waiting on them.
+    VkPipeline pipeline = CreatePipeline(*request);
+    {
+      std::lock_guard<std::mutex> lock(compile_mutex_);
+      compiled_pipelines_.push_back({request->hash_key, pipeline});
+    }
+    --compiles_in_flight_;
+  }
+}
+
+void PipelineCache::ResolveCompiledPipelines() {
+  std::vector<std::pair<uint64_t, VkPipeline>> compiled_pipelines;
+  {
+    std::lock_guard<std::mutex> lock(compile_mutex_);
+    if (compiled_pipelines_.empty()) {
+      return;
+    }
+    compiled_pipelines.swap(compiled_pipelines_);
+  }
+  for (auto& it : compiled_pipelines) {
+    // Failed compiles are cached as null so we don't keep retrying them.
+    pending_pipelines_.erase(it.first);
+    cached_pipelines_.insert(it);
+  }
   COUNT_profile_set("gpu/pipeline_cache/pipelines", cached_pipelines_.size());
+}
 
-  return pipeline;
+void PipelineCache::WaitForPendingCompiles() {
+  while (compile_threads_running_ && compiles_in_flight_) {
+    xe::threading::MaybeYield();
+  }
 }
 
 bool PipelineCache::TranslateShader(VulkanShader* shader,
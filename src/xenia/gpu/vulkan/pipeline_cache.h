@@ -10,10 +10,17 @@
 #ifndef XENIA_GPU_VULKAN_PIPELINE_CACHE_H_
 #define XENIA_GPU_VULKAN_PIPELINE_CACHE_H_
 
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 #include "third_party/xxhash/xxhash.h"
 
+#include "xenia/base/threading.h"
 #include "xenia/gpu/glsl_shader_translator.h"
 #include "xenia/gpu/register_file.h"
 #include "xenia/gpu/spirv_shader_translator.h"
@@ -37,6 +44,9 @@ class PipelineCache {
     kCompatible,
     kMismatch,
     kError,
+    // The pipeline for the current state is being compiled in the background
+    // and is not yet available. The draw should be skipped.
+    kPending,
   };
 
   PipelineCache(RegisterFile* register_file, ui::vulkan::VulkanDevice* device);
@@ -55,7 +65,9 @@ class PipelineCache {
   // pass. If a previously available pipeline is available it will be used,
   // otherwise a new one may be created. Any state that can be set dynamically
   // in the command buffer is issued at this time.
-  // Returns whether the pipeline could be successfully created.
+  // Returns whether the pipeline could be successfully created. When
+  // asynchronous compilation is enabled kPending is returned while the
+  // pipeline is still being built and the caller should skip the draw.
   UpdateStatus ConfigurePipeline(VkCommandBuffer command_buffer,
                                  const RenderState* render_state,
                                  VulkanShader* vertex_shader,
@@ -75,9 +87,44 @@ class PipelineCache {
   void ClearCache();
 
  private:
+  // A self-contained copy of all state required to create a pipeline.
+  // Asynchronous compiles own one of these so that the update state may keep
+  // changing on the command processor thread while the driver works.
+  struct PipelineCreateRequest {
+    uint64_t hash_key;
+    VkRenderPass render_pass;
+    uint32_t stage_count;
+    VkPipelineShaderStageCreateInfo stages[3];
+    VkPipelineVertexInputStateCreateInfo vertex_input_state;
+    VkPipelineInputAssemblyStateCreateInfo input_assembly_state;
+    VkPipelineViewportStateCreateInfo viewport_state;
+    VkPipelineRasterizationStateCreateInfo rasterization_state;
+    VkPipelineMultisampleStateCreateInfo multisample_state;
+    VkPipelineDepthStencilStateCreateInfo depth_stencil_state;
+    VkPipelineColorBlendStateCreateInfo color_blend_state;
+    VkPipelineColorBlendAttachmentState color_blend_attachments[4];
+  };
+
   // Creates or retrieves an existing pipeline for the currently configured
-  // state.
-  VkPipeline GetPipeline(const RenderState* render_state, uint64_t hash_key);
+  // state. Returns nullptr with *out_pending set if the pipeline has been
+  // queued for asynchronous compilation.
+  VkPipeline GetPipeline(const RenderState* render_state, uint64_t hash_key,
+                         bool* out_pending);
+  // Captures the current update state into the given request.
+  void SnapshotPipelineState(const RenderState* render_state,
+                             uint64_t hash_key,
+                             PipelineCreateRequest* request);
+  // Creates a pipeline from a request. Safe to call from any thread.
+  VkPipeline CreatePipeline(const PipelineCreateRequest& request);
+
+  // Asynchronous pipeline compilation.
+  void StartCompileThreads();
+  void StopCompileThreads();
+  void CompileThreadMain();
+  // Moves pipelines finished by the compile threads into cached_pipelines_.
+  void ResolveCompiledPipelines();
+  // Blocks until all queued compiles have completed.
+  void WaitForPendingCompiles();
 
   bool TranslateShader(VulkanShader* shader, xenos::xe_gpu_program_cntl_t cntl);
 
@@ -129,6 +176,23 @@ class PipelineCache {
   // changed.
   VkPipeline current_pipeline_ = nullptr;
 
+  // Background pipeline compilation, enabled by --vulkan_async_pipelines.
+  // Only the command processor thread touches pending_pipelines_; the compile
+  // threads communicate through the queues guarded by compile_mutex_.
+  std::vector<std::unique_ptr<xe::threading::Thread>> compile_threads_;
+  std::unique_ptr<xe::threading::Semaphore> compile_semaphore_;
+  std::atomic<bool> compile_threads_running_ = {false};
+  std::mutex compile_mutex_;
+  std::deque<std::unique_ptr<PipelineCreateRequest>> compile_queue_;
+  std::vector<std::pair<uint64_t, VkPipeline>> compiled_pipelines_;
+  std::atomic<uint32_t> compiles_in_flight_ = {0};
+  std::unordered_set<uint64_t> pending_pipelines_;
+
+  // Statistics, reported through the profiler counters and on shutdown.
+  std::atomic<uint64_t> pipeline_miss_count_ = {0};
+  std::atomic<uint64_t> pipeline_compile_time_us_ = {0};
+  uint64_t skipped_draw_count_ = 0;
+
  private:
   UpdateStatus UpdateState(VulkanShader* vertex_shader,
                            VulkanShader* pixel_shader,
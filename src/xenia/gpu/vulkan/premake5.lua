@@ -160,3 +160,5 @@ project("xenia-gpu-vulkan-trace-dump")
         "1>scratch/stdout-trace-dump.txt",
       })
     end
+
+include("testing")
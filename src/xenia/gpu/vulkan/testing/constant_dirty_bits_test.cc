@@ -0,0 +1,90 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include "xenia/gpu/vulkan/constant_dirty_bits.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace gpu {
+namespace vulkan {
+namespace test {
+
+// Float constant bits as set one register at a time.
+uint64_t FloatBitsPerRegister(uint32_t first_index, uint32_t last_index) {
+  uint64_t bits = 0;
+  for (uint32_t index = first_index; index <= last_index; ++index) {
+    uint32_t group = (index - XE_GPU_REG_SHADER_CONSTANT_000_X) / 16;
+    if (group < constant_dirty_bits::kFloatGroupCount) {
+      bits |= 1ull << (group ^ 0x3F);
+    }
+    REQUIRE(constant_dirty_bits::Float(index, index) ==
+            (group < constant_dirty_bits::kFloatGroupCount
+                 ? 1ull << (group ^ 0x3F)
+                 : 0));
+  }
+  return bits;
+}
+
+TEST_CASE("float_constant_dirty_bits", "Constant dirty bits") {
+  const uint32_t kFirst = XE_GPU_REG_SHADER_CONSTANT_000_X;
+  const uint32_t kLast = XE_GPU_REG_SHADER_CONSTANT_511_W;
+  // Group 63/64 is the vertex/pixel shader boundary.
+  const uint32_t kBoundary = kFirst + 64 * 16;
+  struct {
+    uint32_t first;
+    uint32_t last;
+  } ranges[] = {
+      {kFirst, kFirst},
+      {kFirst, kLast},
+      {kFirst, kBoundary - 1},
+      {kBoundary - 1, kBoundary},
+      {kFirst + 60 * 16, kFirst + 70 * 16 + 3},
+      {kBoundary - 17, kLast},
+      {kBoundary, kLast},
+      {kBoundary + 5, kBoundary + 100},
+      {kLast, kLast},
+  };
+  for (auto& range : ranges) {
+    REQUIRE(constant_dirty_bits::Float(range.first, range.last) ==
+            FloatBitsPerRegister(range.first, range.last));
+  }
+  REQUIRE(constant_dirty_bits::Float(kFirst, kLast) == ~0ull);
+  REQUIRE(constant_dirty_bits::Float(kBoundary, kLast) == 0);
+}
+
+TEST_CASE("bool_loop_constant_dirty_bits", "Constant dirty bits") {
+  const uint32_t kBoolFirst = XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031;
+  const uint32_t kLoopFirst = XE_GPU_REG_SHADER_CONSTANT_LOOP_00;
+  for (uint32_t first = 0; first < 8; ++first) {
+    for (uint32_t last = first; last < 8; ++last) {
+      uint8_t bits = 0;
+      for (uint32_t i = first; i <= last; ++i) {
+        bits |= uint8_t(1 << (i ^ 0x7));
+      }
+      REQUIRE(constant_dirty_bits::Bool(kBoolFirst + first,
+                                        kBoolFirst + last) == bits);
+    }
+  }
+  for (uint32_t first = 0; first < 32; ++first) {
+    for (uint32_t last = first; last < 32; ++last) {
+      uint32_t bits = 0;
+      for (uint32_t i = first; i <= last; ++i) {
+        bits |= 1u << (i ^ 0x1F);
+      }
+      REQUIRE(constant_dirty_bits::Loop(kLoopFirst + first,
+                                        kLoopFirst + last) == bits);
+    }
+  }
+}
+
+}  // namespace test
+}  // namespace vulkan
+}  // namespace gpu
+}  // namespace xe
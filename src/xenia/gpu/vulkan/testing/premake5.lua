@@ -0,0 +1,11 @@
+project_root = "../../../../.."
+include(project_root.."/tools/build")
+
+test_suite("xenia-gpu-vulkan-tests", project_root, ".", {
+  includedirs = {
+    project_root.."/third_party/gflags/src",
+  },
+  links = {
+    "xenia-base",
+  },
+})
@@ -18,6 +18,7 @@
 #include "xenia/gpu/registers.h"
 #include "xenia/gpu/sampler_info.h"
 #include "xenia/gpu/texture_info.h"
+#include "xenia/gpu/vulkan/constant_dirty_bits.h"
 #include "xenia/gpu/vulkan/vulkan_gpu_flags.h"
 #include "xenia/gpu/vulkan/vulkan_graphics_system.h"
 #include "xenia/gpu/xenos.h"
@@ -195,23 +196,13 @@ void VulkanCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
 
   if (index >= XE_GPU_REG_SHADER_CONSTANT_000_X &&
       index <= XE_GPU_REG_SHADER_CONSTANT_511_W) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_000_X;
-    offset /= 4 * 4;
-    offset ^= 0x3F;
-
-    dirty_float_constants_ |= (1ull << offset);
+    dirty_float_constants_ |= constant_dirty_bits::Float(index, index);
   } else if (index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031 &&
              index <= XE_GPU_REG_SHADER_CONSTANT_BOOL_224_255) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031;
-    offset ^= 0x7;
-
-    dirty_bool_constants_ |= (1 << offset);
+    dirty_bool_constants_ |= constant_dirty_bits::Bool(index, index);
   } else if (index >= XE_GPU_REG_SHADER_CONSTANT_LOOP_00 &&
              index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31) {
-    uint32_t offset = index - XE_GPU_REG_SHADER_CONSTANT_LOOP_00;
-    offset ^= 0x1F;
-
-    dirty_loop_constants_ |= (1 << offset);
+    dirty_loop_constants_ |= constant_dirty_bits::Loop(index, index);
   } else if (index == XE_GPU_REG_DC_LUT_PWL_DATA) {
     UpdateGammaRampValue(GammaRampType::kPWL, value);
   } else if (index == XE_GPU_REG_DC_LUT_30_COLOR) {
@@ -229,6 +220,45 @@ void VulkanCommandProcessor::WriteRegister(uint32_t index, uint32_t value) {
   }
 }
 
+void VulkanCommandProcessor::WriteRegisters(uint32_t base_index,
+                                            const uint32_t* values,
+                                            uint32_t count) {
+  uint32_t end_index = base_index + count;
+  if (base_index <= XE_GPU_REG_DC_LUTA_CONTROL &&
+      end_index > XE_GPU_REG_DC_LUT_RW_MODE) {
+    // The gamma ramp registers are FIFOs - take the slow path.
+    for (uint32_t i = 0; i < count; ++i) {
+      WriteRegister(base_index + i, values[i]);
+    }
+    return;
+  }
+
+  CommandProcessor::WriteRegisters(base_index, values, count);
+
+  // Same dirty bits as WriteRegister, set a whole range at a time.
+  uint32_t last_index = end_index - 1;
+  if (base_index <= XE_GPU_REG_SHADER_CONSTANT_511_W &&
+      last_index >= XE_GPU_REG_SHADER_CONSTANT_000_X) {
+    dirty_float_constants_ |= constant_dirty_bits::Float(
+        std::max(base_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_000_X)),
+        std::min(last_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_511_W)));
+  }
+  if (base_index <= XE_GPU_REG_SHADER_CONSTANT_BOOL_224_255 &&
+      last_index >= XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031) {
+    dirty_bool_constants_ |= constant_dirty_bits::Bool(
+        std::max(base_index,
+                 uint32_t(XE_GPU_REG_SHADER_CONSTANT_BOOL_000_031)),
+        std::min(last_index,
+                 uint32_t(XE_GPU_REG_SHADER_CONSTANT_BOOL_224_255)));
+  }
+  if (base_index <= XE_GPU_REG_SHADER_CONSTANT_LOOP_31 &&
+      last_index >= XE_GPU_REG_SHADER_CONSTANT_LOOP_00) {
+    dirty_loop_constants_ |= constant_dirty_bits::Loop(
+        std::max(base_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_LOOP_00)),
+        std::min(last_index, uint32_t(XE_GPU_REG_SHADER_CONSTANT_LOOP_31)));
+  }
+}
+
 void VulkanCommandProcessor::CreateSwapImage(VkCommandBuffer setup_buffer,
                                              VkExtent2D extents) {
   VkImageCreateInfo image_info;
@@ -632,7 +662,8 @@ bool VulkanCommandProcessor::IssueDraw(PrimitiveType primitive_type,
     return true;
   }
 
-  bool full_update = false;
+  bool full_update = pending_full_update_;
+  pending_full_update_ = false;
   if (!frame_open_) {
     BeginFrame();
     full_update = true;
@@ -666,6 +697,11 @@ bool VulkanCommandProcessor::IssueDraw(PrimitiveType primitive_type,
       primitive_type, &pipeline);
   if (pipeline_status == PipelineCache::UpdateStatus::kError) {
     return false;
+  } else if (pipeline_status == PipelineCache::UpdateStatus::kPending) {
+    // Pipeline is still compiling in the background; drop this draw. Nothing
+    // has been bound or set, so carry the full update over to the next draw.
+    pending_full_update_ = full_update;
+    return true;
   } else if (pipeline_status == PipelineCache::UpdateStatus::kMismatch ||
              full_update) {
     vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -64,6 +64,8 @@ class VulkanCommandProcessor : public CommandProcessor {
   void ReturnFromWait() override;
 
   void WriteRegister(uint32_t index, uint32_t value) override;
+  void WriteRegisters(uint32_t base_index, const uint32_t* values,
+                      uint32_t count) override;
 
   void BeginFrame();
   void EndFrame();
@@ -134,6 +136,9 @@ class VulkanCommandProcessor : public CommandProcessor {
 
   bool frame_open_ = false;
   const RenderState* current_render_state_ = nullptr;
+  // A draw needing a full state update was dropped while its pipeline was
+  // compiling, so the next accepted draw has to do it instead.
+  bool pending_full_update_ = false;
   VkCommandBuffer current_command_buffer_ = nullptr;
   VkCommandBuffer current_setup_buffer_ = nullptr;
   VkFence current_batch_fence_;
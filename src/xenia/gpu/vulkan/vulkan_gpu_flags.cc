@@ -14,3 +14,8 @@ DEFINE_bool(vulkan_renderdoc_capture_all, false,
 DEFINE_bool(vulkan_native_msaa, false, "Use native MSAA");
 DEFINE_bool(vulkan_dump_disasm, false,
             "Dump shader disassembly. NVIDIA only supported.");
+DEFINE_bool(vulkan_async_pipelines, false,
+            "Compile pipelines on background threads. Draws using a pipeline "
+            "that is not yet ready are skipped until it is available.");
+DEFINE_int32(vulkan_pipeline_compile_threads, 2,
+             "Number of threads used by --vulkan_async_pipelines.");
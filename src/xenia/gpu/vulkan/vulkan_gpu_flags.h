@@ -17,5 +17,7 @@
 DECLARE_bool(vulkan_renderdoc_capture_all);
 DECLARE_bool(vulkan_native_msaa);
 DECLARE_bool(vulkan_dump_disasm);
+DECLARE_bool(vulkan_async_pipelines);
+DECLARE_int32(vulkan_pipeline_compile_threads);
 
 #endif  // XENIA_GPU_VULKAN_VULKAN_GPU_FLAGS_H_
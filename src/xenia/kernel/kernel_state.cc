@@ -11,6 +11,7 @@
 
 #include <gflags/gflags.h>
 
+#include <algorithm>
 #include <string>
 
 #include "xenia/base/assert.h"
@@ -33,6 +34,10 @@ DEFINE_bool(headless, false,
             "Don't display any UI, using defaults for prompts as needed.");
 DEFINE_string(content_root, "content",
               "Root path for content (save/etc) storage.");
+DEFINE_bool(async_file_io, true,
+            "Complete overlapped guest file reads/writes on background I/O "
+            "threads instead of on the calling thread.");
+DEFINE_int32(file_io_threads, 2, "Number of background file I/O threads.");
 
 namespace xe {
 namespace kernel {
@@ -50,7 +55,8 @@ KernelState::KernelState(Emulator* emulator)
     : emulator_(emulator),
       memory_(emulator->memory()),
       dispatch_thread_running_(false),
-      dpc_list_(emulator->memory()) {
+      dpc_list_(emulator->memory()),
+      file_io_running_(false) {
   processor_ = emulator->processor();
   file_system_ = emulator->file_system();
 
@@ -79,6 +85,19 @@ KernelState::~KernelState() {
     dispatch_thread_->Wait(0, 0, 0, nullptr);
   }
 
+  if (file_io_running_) {
+    // Workers drain whatever is still queued before exiting.
+    {
+      std::lock_guard<std::mutex> lock(file_io_mutex_);
+      file_io_running_ = false;
+    }
+    file_io_cond_.notify_all();
+    for (auto& thread : file_io_threads_) {
+      thread->Wait(0, 0, 0, nullptr);
+    }
+    file_io_threads_.clear();
+  }
+
   executable_module_.reset();
   user_modules_.clear();
   kernel_modules_.clear();
@@ -689,6 +708,39 @@ void KernelState::CompleteOverlappedDeferredEx(
   dispatch_cond_.notify_all();
 }
 
+void KernelState::QueueFileIO(std::function<void()> fn) {
+  std::unique_lock<std::mutex> lock(file_io_mutex_);
+  if (!file_io_running_) {
+    file_io_running_ = true;
+    int thread_count = std::max(FLAGS_file_io_threads, 1);
+    for (int i = 0; i < thread_count; ++i) {
+      auto thread = object_ref<XHostThread>(
+          new XHostThread(this, 128 * 1024, 0, [this]() {
+            while (true) {
+              std::unique_lock<std::mutex> lock(file_io_mutex_);
+              file_io_cond_.wait(lock, [this]() {
+                return !file_io_queue_.empty() || !file_io_running_;
+              });
+              if (file_io_queue_.empty()) {
+                break;
+              }
+              auto fn = std::move(file_io_queue_.front());
+              file_io_queue_.pop_front();
+              lock.unlock();
+              fn();
+            }
+            return 0;
+          }));
+      thread->set_name(xe::format_string("File I/O Worker %d", i));
+      thread->Create();
+      file_io_threads_.push_back(std::move(thread));
+    }
+  }
+  file_io_queue_.push_back(std::move(fn));
+  lock.unlock();
+  file_io_cond_.notify_one();
+}
+
 bool KernelState::Save(ByteStream* stream) {
   XELOGD("Serializing the kernel...");
   stream->Write('KRNL');
@@ -17,6 +17,7 @@
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 #include "xenia/base/bit_map.h"
@@ -176,6 +177,10 @@ class KernelState {
                                     uint32_t overlapped_ptr, X_RESULT result,
                                     uint32_t extended_error, uint32_t length);
 
+  // Runs fn on the file I/O worker pool, spinning it up on first use.
+  // Overlapped file reads/writes complete here so guest threads keep running.
+  void QueueFileIO(std::function<void()> fn);
+
   bool Save(ByteStream* stream);
   bool Restore(ByteStream* stream);
 
@@ -214,6 +219,12 @@ class KernelState {
   std::condition_variable_any dispatch_cond_;
   std::list<std::function<void()>> dispatch_queue_;
 
+  std::atomic<bool> file_io_running_;
+  std::vector<object_ref<XHostThread>> file_io_threads_;
+  std::mutex file_io_mutex_;
+  std::condition_variable file_io_cond_;
+  std::list<std::function<void()>> file_io_queue_;
+
   BitMap tls_bitmap_;
 
   friend class XObject;
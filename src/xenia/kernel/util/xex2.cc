@@ -21,14 +21,39 @@
 #include "third_party/mspack/mspack.h"
 #include "third_party/pe/pe_image.h"
 
+#include "xenia/base/clock.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
 #include "xenia/base/memory.h"
 #include "xenia/base/platform.h"
+#include "xenia/base/threading.h"
+
+#if XE_ARCH_AMD64
+#include <wmmintrin.h>
+#if XE_COMPILER_MSVC
+#include <intrin.h>
+#define XE_XEX2_TARGET_AES
+#else
+#include <cpuid.h>
+#define XE_XEX2_TARGET_AES __attribute__((target("aes")))
+#endif  // XE_COMPILER_MSVC
+#endif  // XE_ARCH_AMD64
 
 namespace xe {}  // namespace xe
 
 DEFINE_bool(xex_dev_key, false, "Use the devkit key.");
+DEFINE_bool(xex_aesni, true,
+            "Use AES-NI to decrypt XEX images when the host supports it.");
+
+// Host ticks spent in each phase of xe_xex2_load, logged as xex_load.
+typedef struct {
+  uint64_t header;
+  uint64_t decrypt;
+  uint64_t deblock;
+  uint64_t decompress;
+  uint64_t load_pe;
+  uint64_t imports;
+} xe_xex2_load_timing_t;
 
 typedef struct xe_xex2 {
   xe::Memory* memory;
@@ -47,7 +72,8 @@ int xe_xex2_read_header(const uint8_t* addr, const size_t length,
                         xe_xex2_header_t* header);
 int xe_xex2_decrypt_key(xe_xex2_header_t* header);
 int xe_xex2_read_image(xe_xex2_ref xex, const uint8_t* xex_addr,
-                       const uint32_t xex_length, xe::Memory* memory);
+                       const uint32_t xex_length, xe::Memory* memory,
+                       xe_xex2_load_timing_t* timing);
 int xe_xex2_load_pe(xe_xex2_ref xex);
 int xe_xex2_find_import_infos(xe_xex2_ref xex,
                               const xe_xex2_import_library_t* library);
@@ -59,6 +85,16 @@ xe_xex2_ref xe_xex2_load(xe::Memory* memory, const void* addr,
   xex->memory = memory;
   xex->sections = new std::vector<PESection*>();
 
+  xe_xex2_load_timing_t timing = {0};
+  uint64_t start_ticks = xe::Clock::QueryHostTickCount();
+  uint64_t phase_ticks = start_ticks;
+  auto end_phase = [&phase_ticks]() {
+    uint64_t now = xe::Clock::QueryHostTickCount();
+    uint64_t elapsed = now - phase_ticks;
+    phase_ticks = now;
+    return elapsed;
+  };
+
   if (xe_xex2_read_header((const uint8_t*)addr, length, &xex->header)) {
     xe_xex2_dealloc(xex);
     return nullptr;
@@ -68,16 +104,20 @@ xe_xex2_ref xe_xex2_load(xe::Memory* memory, const void* addr,
     xe_xex2_dealloc(xex);
     return nullptr;
   }
+  timing.header = end_phase();
 
-  if (xe_xex2_read_image(xex, (const uint8_t*)addr, uint32_t(length), memory)) {
+  if (xe_xex2_read_image(xex, (const uint8_t*)addr, uint32_t(length), memory,
+                         &timing)) {
     xe_xex2_dealloc(xex);
     return nullptr;
   }
+  end_phase();
 
   if (xe_xex2_load_pe(xex)) {
     xe_xex2_dealloc(xex);
     return nullptr;
   }
+  timing.load_pe = end_phase();
 
   for (size_t n = 0; n < xex->header.import_library_count; n++) {
     auto library = &xex->header.import_libraries[n];
@@ -86,6 +126,15 @@ xe_xex2_ref xe_xex2_load(xe::Memory* memory, const void* addr,
       return nullptr;
     }
   }
+  timing.imports = end_phase();
+
+  double ms = 1000.0 / xe::Clock::host_tick_frequency();
+  XELOGI(
+      "xex_load: %.2fms (header %.2fms, decrypt %.2fms, deblock %.2fms, "
+      "decompress %.2fms, pe %.2fms, imports %.2fms) for %u bytes",
+      (phase_ticks - start_ticks) * ms, timing.header * ms,
+      timing.decrypt * ms, timing.deblock * ms, timing.decompress * ms,
+      timing.load_pe * ms, timing.imports * ms, uint32_t(length));
 
   return xex;
 }
@@ -515,31 +564,188 @@ struct mspack_system* mspack_memory_sys_create() {
 }
 void mspack_memory_sys_destroy(struct mspack_system* sys) { free(sys); }
 
-void xe_xex2_decrypt_buffer(const uint8_t* session_key,
-                            const uint8_t* input_buffer,
-                            const size_t input_size, uint8_t* output_buffer,
-                            const size_t output_size) {
+// AES-128-CBC decryption state; ivec carries the chain between calls.
+// Decrypting a CBC block only needs its own and the previous ciphertext
+// block, so large buffers are split across threads and, with AES-NI, several
+// blocks are kept in flight per thread.
+typedef struct {
   uint32_t rk[4 * (MAXNR + 1)];
-  uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, session_key, 128);
-  const uint8_t* ct = input_buffer;
-  uint8_t* pt = output_buffer;
-  for (size_t n = 0; n < input_size; n += 16, ct += 16, pt += 16) {
+  int32_t nr;
+  bool use_aesni;
+  alignas(16) uint8_t aesni_rk[MAXNR + 1][16];
+  uint8_t ivec[16];
+} xe_xex2_aes_cbc_t;
+
+// Buffers smaller than this are not worth waking threads for.
+const size_t kXex2ParallelDecryptSize = 4 * 1024 * 1024;
+
+static bool xe_xex2_host_has_aesni() {
+#if XE_ARCH_AMD64
+#if XE_COMPILER_MSVC
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] >> 25) & 1;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+    return false;
+  }
+  return (ecx >> 25) & 1;
+#endif  // XE_COMPILER_MSVC
+#else
+  return false;
+#endif  // XE_ARCH_AMD64
+}
+
+void xe_xex2_aes_cbc_init(xe_xex2_aes_cbc_t* aes, const uint8_t* key) {
+  static const bool has_aesni = xe_xex2_host_has_aesni();
+  aes->nr = rijndaelKeySetupDec(aes->rk, key, 128);
+  aes->use_aesni = has_aesni && FLAGS_xex_aesni;
+  if (aes->use_aesni) {
+    // The decryption schedule is already in the equivalent inverse cipher
+    // form AESDEC expects; it only needs the words back in byte order.
+    for (int32_t i = 0; i <= aes->nr; ++i) {
+      for (int j = 0; j < 4; ++j) {
+        xe::store_and_swap<uint32_t>(&aes->aesni_rk[i][j * 4],
+                                     aes->rk[i * 4 + j]);
+      }
+    }
+  }
+  std::memset(aes->ivec, 0, sizeof(aes->ivec));
+}
+
+#if XE_ARCH_AMD64
+XE_XEX2_TARGET_AES
+static void xe_xex2_aes_cbc_decrypt_aesni(const xe_xex2_aes_cbc_t* aes,
+                                          const uint8_t* ivec,
+                                          const uint8_t* input,
+                                          uint8_t* output, size_t blocks) {
+  __m128i rk[MAXNR + 1];
+  for (int32_t i = 0; i <= aes->nr; ++i) {
+    rk[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(aes->aesni_rk[i]));
+  }
+  auto in = reinterpret_cast<const __m128i*>(input);
+  auto out = reinterpret_cast<__m128i*>(output);
+  __m128i prev = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ivec));
+  size_t n = 0;
+  // Four independent blocks at a time to hide AESDEC latency.
+  for (; n + 4 <= blocks; n += 4) {
+    __m128i c0 = _mm_loadu_si128(in + n + 0);
+    __m128i c1 = _mm_loadu_si128(in + n + 1);
+    __m128i c2 = _mm_loadu_si128(in + n + 2);
+    __m128i c3 = _mm_loadu_si128(in + n + 3);
+    __m128i b0 = _mm_xor_si128(c0, rk[0]);
+    __m128i b1 = _mm_xor_si128(c1, rk[0]);
+    __m128i b2 = _mm_xor_si128(c2, rk[0]);
+    __m128i b3 = _mm_xor_si128(c3, rk[0]);
+    for (int32_t r = 1; r < aes->nr; ++r) {
+      b0 = _mm_aesdec_si128(b0, rk[r]);
+      b1 = _mm_aesdec_si128(b1, rk[r]);
+      b2 = _mm_aesdec_si128(b2, rk[r]);
+      b3 = _mm_aesdec_si128(b3, rk[r]);
+    }
+    b0 = _mm_aesdeclast_si128(b0, rk[aes->nr]);
+    b1 = _mm_aesdeclast_si128(b1, rk[aes->nr]);
+    b2 = _mm_aesdeclast_si128(b2, rk[aes->nr]);
+    b3 = _mm_aesdeclast_si128(b3, rk[aes->nr]);
+    _mm_storeu_si128(out + n + 0, _mm_xor_si128(b0, prev));
+    _mm_storeu_si128(out + n + 1, _mm_xor_si128(b1, c0));
+    _mm_storeu_si128(out + n + 2, _mm_xor_si128(b2, c1));
+    _mm_storeu_si128(out + n + 3, _mm_xor_si128(b3, c2));
+    prev = c3;
+  }
+  for (; n < blocks; ++n) {
+    __m128i c = _mm_loadu_si128(in + n);
+    __m128i b = _mm_xor_si128(c, rk[0]);
+    for (int32_t r = 1; r < aes->nr; ++r) {
+      b = _mm_aesdec_si128(b, rk[r]);
+    }
+    b = _mm_aesdeclast_si128(b, rk[aes->nr]);
+    _mm_storeu_si128(out + n, _mm_xor_si128(b, prev));
+    prev = c;
+  }
+}
+#endif  // XE_ARCH_AMD64
+
+// Decrypts whole blocks starting from the given chaining value. input and
+// output must not overlap.
+static void xe_xex2_aes_cbc_decrypt_range(const xe_xex2_aes_cbc_t* aes,
+                                          const uint8_t* ivec,
+                                          const uint8_t* input,
+                                          uint8_t* output, size_t blocks) {
+#if XE_ARCH_AMD64
+  if (aes->use_aesni) {
+    xe_xex2_aes_cbc_decrypt_aesni(aes, ivec, input, output, blocks);
+    return;
+  }
+#endif  // XE_ARCH_AMD64
+  const uint8_t* ct = input;
+  uint8_t* pt = output;
+  for (size_t n = 0; n < blocks; ++n, ct += 16, pt += 16) {
     // Decrypt 16 uint8_ts from input -> output.
-    rijndaelDecrypt(rk, Nr, ct, pt);
+    rijndaelDecrypt(aes->rk, aes->nr, ct, pt);
+    // XOR with previous.
     for (size_t i = 0; i < 16; i++) {
-      // XOR with previous.
       pt[i] ^= ivec[i];
-      // Set previous.
-      ivec[i] = ct[i];
+    }
+    ivec = ct;
+  }
+}
+
+void xe_xex2_aes_cbc_decrypt(xe_xex2_aes_cbc_t* aes, const uint8_t* input,
+                             uint8_t* output, size_t size) {
+  size_t blocks = size / 16;
+  if (!blocks) {
+    return;
+  }
+  uint32_t thread_count = 1;
+  if (size >= kXex2ParallelDecryptSize) {
+    thread_count = std::min(xe::threading::logical_processor_count(),
+                            uint32_t(size / (kXex2ParallelDecryptSize / 4)));
+  }
+  if (thread_count <= 1) {
+    xe_xex2_aes_cbc_decrypt_range(aes, aes->ivec, input, output, blocks);
+  } else {
+    // Each slice chains off the last ciphertext block of the one before it.
+    size_t slice_blocks = (blocks + thread_count - 1) / thread_count;
+    std::vector<std::unique_ptr<xe::threading::Thread>> threads;
+    for (uint32_t i = 1; i < thread_count; ++i) {
+      size_t first = i * slice_blocks;
+      if (first >= blocks) {
+        break;
+      }
+      size_t count = std::min(slice_blocks, blocks - first);
+      threads.push_back(xe::threading::Thread::Create(
+          {}, [aes, input, output, first, count]() {
+            xe_xex2_aes_cbc_decrypt_range(aes, input + (first - 1) * 16,
+                                          input + first * 16,
+                                          output + first * 16, count);
+          }));
+    }
+    xe_xex2_aes_cbc_decrypt_range(aes, aes->ivec, input, output,
+                                  std::min(slice_blocks, blocks));
+    for (auto& thread : threads) {
+      xe::threading::Wait(thread.get(), false);
     }
   }
+  std::memcpy(aes->ivec, input + (blocks - 1) * 16, 16);
+}
+
+void xe_xex2_decrypt_buffer(const uint8_t* session_key,
+                            const uint8_t* input_buffer,
+                            const size_t input_size, uint8_t* output_buffer,
+                            const size_t output_size) {
+  xe_xex2_aes_cbc_t aes;
+  xe_xex2_aes_cbc_init(&aes, session_key);
+  xe_xex2_aes_cbc_decrypt(&aes, input_buffer,
+                          output_buffer, std::min(input_size, output_size));
 }
 
 int xe_xex2_read_image_uncompressed(const xe_xex2_header_t* header,
                                     const uint8_t* xex_addr,
                                     const uint32_t xex_length,
-                                    xe::Memory* memory) {
+                                    xe::Memory* memory,
+                                    xe_xex2_load_timing_t* timing) {
   // Allocate in-place the XEX memory.
   const uint32_t exe_length = xex_length - header->exe_offset;
   uint32_t uncompressed_size = exe_length;
@@ -566,10 +772,13 @@ int xe_xex2_read_image_uncompressed(const xe_xex2_header_t* header,
       }
       memcpy(buffer, p, exe_length);
       return 0;
-    case XEX_ENCRYPTION_NORMAL:
+    case XEX_ENCRYPTION_NORMAL: {
+      uint64_t decrypt_start = xe::Clock::QueryHostTickCount();
       xe_xex2_decrypt_buffer(header->session_key, p, exe_length, buffer,
                              uncompressed_size);
+      timing->decrypt = xe::Clock::QueryHostTickCount() - decrypt_start;
       return 0;
+    }
     default:
       assert_always();
       return 1;
@@ -581,7 +790,8 @@ int xe_xex2_read_image_uncompressed(const xe_xex2_header_t* header,
 int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t* header,
                                         const uint8_t* xex_addr,
                                         const uint32_t xex_length,
-                                        xe::Memory* memory) {
+                                        xe::Memory* memory,
+                                        xe_xex2_load_timing_t* timing) {
   const uint32_t exe_length = xex_length - header->exe_offset;
   const uint8_t* source_buffer = (const uint8_t*)xex_addr + header->exe_offset;
   const uint8_t* p = source_buffer;
@@ -620,10 +830,10 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t* header,
   std::memset(buffer, 0, total_size);  // Quickly zero the contents.
   uint8_t* d = buffer;
 
-  uint32_t rk[4 * (MAXNR + 1)];
-  uint8_t ivec[16] = {0};
-  int32_t Nr = rijndaelKeySetupDec(rk, header->session_key, 128);
+  xe_xex2_aes_cbc_t aes;
+  xe_xex2_aes_cbc_init(&aes, header->session_key);
 
+  uint64_t decrypt_start = xe::Clock::QueryHostTickCount();
   for (size_t n = 0; n < comp_info->block_count; n++) {
     const uint32_t data_size = comp_info->blocks[n].data_size;
     const uint32_t zero_size = comp_info->blocks[n].zero_size;
@@ -636,20 +846,10 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t* header,
         }
         memcpy(d, p, data_size);
         break;
-      case XEX_ENCRYPTION_NORMAL: {
-        const uint8_t* ct = p;
-        uint8_t* pt = d;
-        for (size_t m = 0; m < data_size; m += 16, ct += 16, pt += 16) {
-          // Decrypt 16 uint8_ts from input -> output.
-          rijndaelDecrypt(rk, Nr, ct, pt);
-          for (size_t i = 0; i < 16; i++) {
-            // XOR with previous.
-            pt[i] ^= ivec[i];
-            // Set previous.
-            ivec[i] = ct[i];
-          }
-        }
-      } break;
+      case XEX_ENCRYPTION_NORMAL:
+        // The CBC chain continues across blocks.
+        xe_xex2_aes_cbc_decrypt(&aes, p, d, data_size);
+        break;
       default:
         assert_always();
         return 1;
@@ -658,6 +858,7 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t* header,
     p += data_size;
     d += data_size + zero_size;
   }
+  timing->decrypt = xe::Clock::QueryHostTickCount() - decrypt_start;
 
   return 0;
 }
@@ -665,7 +866,8 @@ int xe_xex2_read_image_basic_compressed(const xe_xex2_header_t* header,
 int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
                                   const uint8_t* xex_addr,
                                   const uint32_t xex_length,
-                                  xe::Memory* memory) {
+                                  xe::Memory* memory,
+                                  xe_xex2_load_timing_t* timing) {
   const uint32_t exe_length = xex_length - header->exe_offset;
   const uint8_t* exe_buffer = (const uint8_t*)xex_addr + header->exe_offset;
 
@@ -682,7 +884,6 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
   uint8_t* compress_buffer = NULL;
   const uint8_t* p = NULL;
   uint8_t* d = NULL;
-  uint8_t* deblock_buffer = NULL;
   size_t block_size = 0;
   uint32_t uncompressed_size = 0;
   struct mspack_system* sys = NULL;
@@ -691,6 +892,7 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
   struct lzxd_stream* lzxd = NULL;
 
   // Decrypt (if needed).
+  uint64_t phase_start = xe::Clock::QueryHostTickCount();
   bool free_input = false;
   const uint8_t* input_buffer = exe_buffer;
   const size_t input_size = exe_length;
@@ -709,14 +911,16 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
       assert_always();
       return false;
   }
+  timing->decrypt = xe::Clock::QueryHostTickCount() - phase_start;
+  phase_start = xe::Clock::QueryHostTickCount();
 
-  compress_buffer = (uint8_t*)calloc(1, exe_length);
+  // Every byte read back is written first, so no need to zero it.
+  compress_buffer = (uint8_t*)malloc(exe_length);
 
   p = input_buffer;
   d = compress_buffer;
 
   // De-block.
-  deblock_buffer = (uint8_t*)calloc(1, input_size);
   block_size = header->file_format_info.compression_info.normal.block_size;
   while (block_size) {
     const uint8_t* pnext = p + block_size;
@@ -740,6 +944,7 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
     p = pnext;
     block_size = next_size;
   }
+  timing->deblock = xe::Clock::QueryHostTickCount() - phase_start;
 
   // Allocate in-place the XEX memory.
   bool alloc_result =
@@ -761,6 +966,8 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
   std::memset(buffer, 0, uncompressed_size);
 
   // Setup decompressor and decompress.
+  // LZX is a single stream with a sliding window, so this stays serial.
+  phase_start = xe::Clock::QueryHostTickCount();
   sys = mspack_memory_sys_create();
   lzxsrc = mspack_memory_open(sys, (void*)compress_buffer, d - compress_buffer);
   lzxdst = mspack_memory_open(sys, buffer, uncompressed_size);
@@ -769,6 +976,7 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
                 header->file_format_info.compression_info.normal.window_bits, 0,
                 32768, (off_t)header->loader_info.image_size);
   result_code = lzxd_decompress(lzxd, (off_t)header->loader_info.image_size);
+  timing->decompress = xe::Clock::QueryHostTickCount() - phase_start;
 
   if (lzxd) {
     lzxd_free(lzxd);
@@ -787,7 +995,6 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
     sys = NULL;
   }
   free(compress_buffer);
-  free(deblock_buffer);
   if (free_input) {
     free((void*)input_buffer);
   }
@@ -795,18 +1002,19 @@ int xe_xex2_read_image_compressed(const xe_xex2_header_t* header,
 }
 
 int xe_xex2_read_image(xe_xex2_ref xex, const uint8_t* xex_addr,
-                       const uint32_t xex_length, xe::Memory* memory) {
+                       const uint32_t xex_length, xe::Memory* memory,
+                       xe_xex2_load_timing_t* timing) {
   const xe_xex2_header_t* header = &xex->header;
   switch (header->file_format_info.compression_type) {
     case XEX_COMPRESSION_NONE:
       return xe_xex2_read_image_uncompressed(header, xex_addr, xex_length,
-                                             memory);
+                                             memory, timing);
     case XEX_COMPRESSION_BASIC:
       return xe_xex2_read_image_basic_compressed(header, xex_addr, xex_length,
-                                                 memory);
+                                                 memory, timing);
     case XEX_COMPRESSION_NORMAL:
       return xe_xex2_read_image_compressed(header, xex_addr, xex_length,
-                                           memory);
+                                           memory, timing);
     default:
       assert_always();
       return 1;
@@ -7,6 +7,10 @@
  ******************************************************************************
  */
 
+#include <gflags/gflags.h>
+
+#include <algorithm>
+
 #include "xenia/base/logging.h"
 #include "xenia/base/memory.h"
 #include "xenia/cpu/processor.h"
@@ -20,6 +24,8 @@
 #include "xenia/vfs/device.h"
 #include "xenia/xbox.h"
 
+DECLARE_bool(async_file_io);
+
 namespace xe {
 namespace kernel {
 namespace xboxkrnl {
@@ -146,6 +152,36 @@ dword_result_t NtOpenFile(lpdword_t handle_out, dword_t desired_access,
 }
 DECLARE_XBOXKRNL_EXPORT(NtOpenFile, ExportTag::kImplemented);
 
+// Builds the completion for an overlapped request: it fills the
+// IO_STATUS_BLOCK, queues the APC to the issuing thread and signals the event
+// once the I/O workers are done with the request.
+static XFile::AsyncCompletion MakeAsyncFileCompletion(
+    object_ref<XEvent> ev, uint32_t apc_routine_ptr, uint32_t apc_context_ptr,
+    pointer_t<X_IO_STATUS_BLOCK> io_status_block) {
+  // Low bit probably means do not queue to IO ports.
+  uint32_t apc_routine = apc_routine_ptr & ~1u;
+  object_ref<XThread> thread;
+  if (apc_routine && apc_context_ptr) {
+    thread = retain_object(XThread::GetCurrentThread());
+  }
+  X_IO_STATUS_BLOCK* io_status_block_host = io_status_block;
+  uint32_t io_status_block_ptr = io_status_block.guest_address();
+  return [ev, thread, apc_routine, apc_context_ptr, io_status_block_host,
+          io_status_block_ptr](X_STATUS status, size_t bytes_transferred) {
+    if (io_status_block_host) {
+      io_status_block_host->status = status;
+      io_status_block_host->information =
+          static_cast<uint32_t>(bytes_transferred);
+    }
+    if (thread) {
+      thread->EnqueueApc(apc_routine, apc_context_ptr, io_status_block_ptr, 0);
+    }
+    if (ev) {
+      ev->Set(0, false);
+    }
+  };
+}
+
 dword_result_t NtReadFile(dword_t file_handle, dword_t event_handle,
                           lpvoid_t apc_routine_ptr, lpvoid_t apc_context,
                           pointer_t<X_IO_STATUS_BLOCK> io_status_block,
@@ -164,20 +200,40 @@ dword_result_t NtReadFile(dword_t file_handle, dword_t event_handle,
     result = X_STATUS_INVALID_HANDLE;
   }
 
+  uint32_t read_length = buffer_length;
   if (XSUCCEEDED(result)) {
-    if (true || file->is_synchronous()) {
-      // some games NtReadFile() directly into texture memory
-      // TODO(rick): better checking of physical address
-      if (buffer.guest_address() >= 0xA0000000) {
+    // some games NtReadFile() directly into texture memory
+    // TODO(rick): better checking of physical address
+    if (buffer.guest_address() >= 0xA0000000) {
+      // Only invalidate what the read can write - games often pass buffers far
+      // larger than what is left in the file, and every watch in the tail
+      // (textures, etc) would be thrown away. The length is queried from the
+      // file itself as the entry size can be stale, and the read is clamped
+      // to it so a file growing meanwhile can't write past what was
+      // invalidated. At or past the end the read writes nothing.
+      uint64_t read_offset =
+          byte_offset_ptr ? static_cast<uint64_t>(*byte_offset_ptr)
+                          : file->position();
+      size_t file_length = 0;
+      if (XFAILED(file->file()->GetLength(&file_length))) {
+        file_length = file->entry()->size();
+      }
+      if (read_offset < file_length) {
+        read_length = static_cast<uint32_t>(
+            std::min<uint64_t>(buffer_length, file_length - read_offset));
         auto heap = kernel_memory()->LookupHeap(buffer.guest_address());
         cpu::MMIOHandler::global_handler()->InvalidateRange(
-            heap->GetPhysicalAddress(buffer.guest_address()), buffer_length);
+            heap->GetPhysicalAddress(buffer.guest_address()), read_length);
       }
+    }
 
+    // Overlapped reads need an explicit offset; anything else completes
+    // inline.
+    if (!FLAGS_async_file_io || file->is_synchronous() || !byte_offset_ptr) {
       // Synchronous.
       size_t bytes_read = 0;
       result = file->Read(
-          buffer, buffer_length,
+          buffer, read_length,
           byte_offset_ptr ? static_cast<uint64_t>(*byte_offset_ptr) : -1,
           &bytes_read, apc_context);
       if (io_status_block) {
@@ -204,22 +260,22 @@ dword_result_t NtReadFile(dword_t file_handle, dword_t event_handle,
       // we have written the info out.
       signal_event = true;
     } else {
-      // TODO(benvanik): async.
-
-      // X_STATUS_PENDING if not returning immediately.
-      // XFile is waitable and signalled after each async req completes.
-      // reset the input event (->Reset())
-      /*xeNtReadFileState* call_state = new xeNtReadFileState();
-      XAsyncRequest* request = new XAsyncRequest(
-      state, file,
-      (XAsyncRequest::CompletionCallback)xeNtReadFileCompleted,
-      call_state);*/
-      // result = file->Read(buffer, buffer_length, byte_offset, request);
+      // X_STATUS_PENDING until the I/O workers finish the read. The XFile is
+      // waitable and signalled after each async req completes, along with the
+      // event, APC and any completion ports.
       if (io_status_block) {
         io_status_block->status = X_STATUS_PENDING;
         io_status_block->information = 0;
       }
+      if (ev) {
+        ev->Reset();
+      }
 
+      file->ReadAsync(
+          buffer, read_length, *byte_offset_ptr, apc_context.guest_address(),
+          MakeAsyncFileCompletion(ev, apc_routine_ptr.guest_address(),
+                                  apc_context.guest_address(),
+                                  io_status_block));
       result = X_STATUS_PENDING;
     }
   }
@@ -243,9 +299,6 @@ dword_result_t NtWriteFile(dword_t file_handle, dword_t event_handle,
                            pointer_t<X_IO_STATUS_BLOCK> io_status_block,
                            lpvoid_t buffer, dword_t buffer_length,
                            lpqword_t byte_offset_ptr) {
-  // Async not supported yet.
-  assert_zero(apc_routine);
-
   X_STATUS result = X_STATUS_SUCCESS;
   uint32_t info = 0;
 
@@ -264,9 +317,10 @@ dword_result_t NtWriteFile(dword_t file_handle, dword_t event_handle,
 
   // Execute write.
   if (XSUCCEEDED(result)) {
-    // TODO(benvanik): async path.
-    if (true || file->is_synchronous()) {
+    if (!FLAGS_async_file_io || file->is_synchronous() || !byte_offset_ptr) {
       // Synchronous request.
+      // APCs aren't delivered on this path yet.
+      assert_zero(apc_routine);
       size_t bytes_written = 0;
       result = file->Write(
           buffer, buffer_length,
@@ -290,13 +344,19 @@ dword_result_t NtWriteFile(dword_t file_handle, dword_t event_handle,
       signal_event = true;
     } else {
       // X_STATUS_PENDING if not returning immediately.
-      result = X_STATUS_PENDING;
-      info = 0;
-
       if (io_status_block) {
-        io_status_block->status = X_STATUS_SUCCESS;
-        io_status_block->information = info;
+        io_status_block->status = X_STATUS_PENDING;
+        io_status_block->information = 0;
       }
+      if (ev) {
+        ev->Reset();
+      }
+
+      file->WriteAsync(
+          buffer, buffer_length, *byte_offset_ptr, apc_context.guest_address(),
+          MakeAsyncFileCompletion(ev, apc_routine, apc_context.guest_address(),
+                                  io_status_block));
+      result = X_STATUS_PENDING;
     }
   }
 
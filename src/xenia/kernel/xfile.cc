@@ -147,6 +147,50 @@ X_STATUS XFile::Write(const void* buffer, size_t buffer_length,
   return result;
 }
 
+void XFile::ReadAsync(void* buffer, size_t buffer_length, size_t byte_offset,
+                      uint32_t apc_context, AsyncCompletion completion) {
+  // Keep ourselves alive until the request completes, even if the guest closes
+  // the handle in the meantime.
+  auto self = retain_object(this);
+  kernel_state()->QueueFileIO([self, buffer, buffer_length, byte_offset,
+                               apc_context, completion]() {
+    size_t bytes_read = 0;
+    X_STATUS result = self->file_->ReadSync(buffer, buffer_length,
+                                            byte_offset, &bytes_read);
+    self->CompleteAsync(result, bytes_read, apc_context, completion);
+  });
+}
+
+void XFile::WriteAsync(const void* buffer, size_t buffer_length,
+                       size_t byte_offset, uint32_t apc_context,
+                       AsyncCompletion completion) {
+  auto self = retain_object(this);
+  kernel_state()->QueueFileIO([self, buffer, buffer_length, byte_offset,
+                               apc_context, completion]() {
+    size_t bytes_written = 0;
+    X_STATUS result = self->file_->WriteSync(buffer, buffer_length,
+                                             byte_offset, &bytes_written);
+    self->CompleteAsync(result, bytes_written, apc_context, completion);
+  });
+}
+
+void XFile::CompleteAsync(X_STATUS result, size_t bytes_transferred,
+                          uint32_t apc_context,
+                          const AsyncCompletion& completion) {
+  if (completion) {
+    completion(result, bytes_transferred);
+  }
+
+  XIOCompletion::IONotification notify;
+  notify.apc_context = apc_context;
+  notify.num_bytes = uint32_t(bytes_transferred);
+  notify.status = result;
+
+  NotifyIOCompletionPorts(notify);
+
+  async_event_->Set();
+}
+
 X_STATUS XFile::SetLength(size_t length) { return file_->SetLength(length); }
 
 void XFile::RegisterIOCompletionPort(uint32_t key,
@@ -10,6 +10,7 @@
 #ifndef XENIA_KERNEL_XFILE_H_
 #define XENIA_KERNEL_XFILE_H_
 
+#include <functional>
 #include <string>
 
 #include "xenia/base/filesystem.h"
@@ -104,6 +105,18 @@ class XFile : public XObject {
   X_STATUS Write(const void* buffer, size_t buffer_length, size_t byte_offset,
                  size_t* out_bytes_written, uint32_t apc_context);
 
+  // Overlapped variants. The transfer runs on the kernel's file I/O workers;
+  // completion is called there with the result before the completion ports
+  // are notified and the file's wait handle is signaled. The file position is
+  // not used or updated, as with overlapped handles on Windows.
+  typedef std::function<void(X_STATUS result, size_t bytes_transferred)>
+      AsyncCompletion;
+  void ReadAsync(void* buffer, size_t buffer_length, size_t byte_offset,
+                 uint32_t apc_context, AsyncCompletion completion);
+  void WriteAsync(const void* buffer, size_t buffer_length,
+                  size_t byte_offset, uint32_t apc_context,
+                  AsyncCompletion completion);
+
   X_STATUS SetLength(size_t length);
 
   void RegisterIOCompletionPort(uint32_t key, object_ref<XIOCompletion> port);
@@ -117,6 +130,8 @@ class XFile : public XObject {
 
  protected:
   void NotifyIOCompletionPorts(XIOCompletion::IONotification& notification);
+  void CompleteAsync(X_STATUS result, size_t bytes_transferred,
+                     uint32_t apc_context, const AsyncCompletion& completion);
 
   xe::threading::WaitHandle* GetWaitHandle() override {
     return async_event_.get();
@@ -376,6 +376,8 @@ X_STATUS XThread::Create() {
 
     // Profiler needs to know about the thread.
     xe::Profiler::ThreadEnter(thread_name_.c_str());
+    emulator()->processor()->OnThreadEnter(thread_state_, stack_limit_,
+                                           stack_base_);
 
     // Execute user code.
     current_xthread_tls_ = this;
@@ -386,6 +388,7 @@ X_STATUS XThread::Create() {
     current_thread_ = nullptr;
     current_xthread_tls_ = nullptr;
 
+    emulator()->processor()->OnThreadLeave(thread_state_);
     xe::Profiler::ThreadExit();
 
     // Release the self-reference to the thread.
@@ -445,6 +448,7 @@ X_STATUS XThread::Exit(int exit_code) {
   // NOTE: unless PlatformExit fails, expect it to never return!
   current_xthread_tls_ = nullptr;
   current_thread_ = nullptr;
+  emulator()->processor()->OnThreadLeave(thread_state_);
   xe::Profiler::ThreadExit();
 
   running_ = false;
@@ -989,6 +993,8 @@ object_ref<XThread> XThread::Restore(KernelState* kernel_state,
 
       // Profiler needs to know about the thread.
       xe::Profiler::ThreadEnter(thread->name().c_str());
+      thread->kernel_state_->processor()->OnThreadEnter(
+          thread->thread_state_, thread->stack_limit_, thread->stack_base_);
 
       // Setup the time now that we're in the thread.
       Clock::SetGuestTickCount(state.tick_count_);
@@ -1014,6 +1020,7 @@ object_ref<XThread> XThread::Restore(KernelState* kernel_state,
       current_thread_ = nullptr;
       current_xthread_tls_ = nullptr;
 
+      thread->kernel_state_->processor()->OnThreadLeave(thread->thread_state_);
       xe::Profiler::ThreadExit();
 
       // Release the self-reference to the thread.
@@ -10,6 +10,7 @@
 #ifndef XENIA_VFS_DEVICE_H_
 #define XENIA_VFS_DEVICE_H_
 
+#include <atomic>
 #include <memory>
 #include <string>
 
@@ -33,6 +34,15 @@ class Device {
   virtual void Dump(StringBuffer* string_buffer) = 0;
   virtual Entry* ResolvePath(std::string path) = 0;
 
+  // Whether resolved entries may be cached by path until the next
+  // InvalidateEntries. Devices that apply host changes lazily in ResolvePath
+  // must see every lookup.
+  virtual bool can_cache_paths() const { return true; }
+  // Bumped whenever an entry is removed from the device; cached Entry*s taken
+  // at an older generation may be dangling.
+  uint32_t entry_generation() const { return entry_generation_; }
+  void InvalidateEntries() { ++entry_generation_; }
+
   virtual uint32_t total_allocation_units() const = 0;
   virtual uint32_t available_allocation_units() const = 0;
   virtual uint32_t sectors_per_allocation_unit() const = 0;
@@ -41,6 +51,7 @@ class Device {
  protected:
   xe::global_critical_region global_critical_region_;
   std::string mount_path_;
+  std::atomic<uint32_t> entry_generation_ = {0};
 };
 
 }  // namespace vfs
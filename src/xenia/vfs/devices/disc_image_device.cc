@@ -183,7 +183,7 @@ bool DiscImageDevice::ReadEntry(ParseState* state, const uint8_t* buffer,
   }
 
   // Add to parent.
-  parent->children_.emplace_back(std::move(entry));
+  parent->AddChild(std::move(entry));
 
   // Read next file in the list.
   if (node_r && !ReadEntry(state, buffer, node_r, parent)) {
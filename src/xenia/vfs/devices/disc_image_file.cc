@@ -16,6 +16,9 @@
 namespace xe {
 namespace vfs {
 
+// Reads at least this large hint the whole source range to the OS first.
+constexpr size_t kPrefetchThreshold = 256 * 1024;
+
 DiscImageFile::DiscImageFile(uint32_t file_access, DiscImageEntry* entry)
     : File(file_access, entry), entry_(entry) {}
 
@@ -31,6 +34,11 @@ X_STATUS DiscImageFile::ReadSync(void* buffer, size_t buffer_length,
   size_t real_offset = entry_->data_offset() + byte_offset;
   size_t real_length =
       std::min(buffer_length, entry_->data_size() - byte_offset);
+  if (real_length >= kPrefetchThreshold) {
+    // Level loads read many MB at once; have the OS page the whole run in up
+    // front rather than stalling on every page during the copy.
+    entry_->mmap()->Prefetch(real_offset, real_length);
+  }
   std::memcpy(buffer, entry_->mmap()->data() + real_offset, real_length);
   *out_bytes_read = real_length;
   return X_STATUS_SUCCESS;
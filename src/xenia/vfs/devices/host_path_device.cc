@@ -9,12 +9,26 @@
 
 #include "xenia/vfs/devices/host_path_device.h"
 
+#include <gflags/gflags.h>
+
+#include "xenia/base/assert.h"
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/math.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/string.h"
 #include "xenia/kernel/xfile.h"
 #include "xenia/vfs/devices/host_path_entry.h"
 
+#if XE_PLATFORM_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif  // XE_PLATFORM_LINUX
+
+DEFINE_bool(host_path_watch, false,
+            "Watch mounted host directories for changes made outside of the "
+            "emulator (files added, removed or resized). Linux only.");
+
 namespace xe {
 namespace vfs {
 
@@ -22,7 +36,16 @@ HostPathDevice::HostPathDevice(const std::string& mount_path,
                                const std::wstring& local_path, bool read_only)
     : Device(mount_path), local_path_(local_path), read_only_(read_only) {}
 
-HostPathDevice::~HostPathDevice() = default;
+HostPathDevice::~HostPathDevice() {
+  // Entries unwatch themselves as they are destroyed.
+  root_entry_.reset();
+  removed_entries_.clear();
+#if XE_PLATFORM_LINUX
+  if (watch_handle_ != -1) {
+    close(watch_handle_);
+  }
+#endif  // XE_PLATFORM_LINUX
+}
 
 bool HostPathDevice::Initialize() {
   if (!xe::filesystem::PathExists(local_path_)) {
@@ -35,10 +58,23 @@ bool HostPathDevice::Initialize() {
     }
   }
 
+  if (FLAGS_host_path_watch) {
+#if XE_PLATFORM_LINUX
+    watch_handle_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (watch_handle_ == -1) {
+      XELOGW("Unable to watch host path for changes");
+    }
+#else
+    XELOGW("--host_path_watch is not supported on this platform");
+#endif  // XE_PLATFORM_LINUX
+  }
+
+  // Directories are populated lazily as they are first looked into, so
+  // mounting is constant time regardless of how large the tree is.
   auto root_entry = new HostPathEntry(this, nullptr, "", local_path_);
   root_entry->attributes_ = kFileAttributeDirectory;
+  root_entry->children_populated_ = false;
   root_entry_ = std::unique_ptr<Entry>(root_entry);
-  PopulateEntry(root_entry);
 
   return true;
 }
@@ -55,6 +91,9 @@ Entry* HostPathDevice::ResolvePath(std::string path) {
 
   XELOGFS("HostPathDevice::ResolvePath(%s)", path.c_str());
 
+  auto global_lock = global_critical_region_.Acquire();
+  ProcessHostChanges();
+
   // Walk the path, one separator at a time.
   auto entry = root_entry_.get();
   auto path_parts = xe::split_path(path);
@@ -69,19 +108,142 @@ Entry* HostPathDevice::ResolvePath(std::string path) {
   return entry;
 }
 
-void HostPathDevice::PopulateEntry(HostPathEntry* parent_entry) {
-  auto child_infos = xe::filesystem::ListFiles(parent_entry->local_path());
-  for (auto& child_info : child_infos) {
-    auto child = HostPathEntry::Create(
-        this, parent_entry,
-        xe::join_paths(parent_entry->local_path(), child_info.name),
-        child_info);
-    parent_entry->children_.push_back(std::unique_ptr<Entry>(child));
-
-    if (child_info.type == xe::filesystem::FileInfo::Type::kDirectory) {
-      PopulateEntry(child);
+void HostPathDevice::WatchEntry(HostPathEntry* entry) {
+#if XE_PLATFORM_LINUX
+  if (watch_handle_ == -1) {
+    return;
+  }
+  int wd = inotify_add_watch(
+      watch_handle_, xe::to_string(entry->local_path()).c_str(),
+      IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE |
+          IN_ATTRIB | IN_ONLYDIR);
+  if (wd == -1) {
+    XELOGW("Unable to watch host directory %S", entry->local_path().c_str());
+    return;
+  }
+  entry->watch_descriptor_ = wd;
+  watched_entries_[wd] = entry;
+#endif  // XE_PLATFORM_LINUX
+}
+
+void HostPathDevice::UnwatchEntry(HostPathEntry* entry) {
+#if XE_PLATFORM_LINUX
+  // Any events still queued for the descriptor are dropped when processed.
+  inotify_rm_watch(watch_handle_, entry->watch_descriptor_);
+  watched_entries_.erase(entry->watch_descriptor_);
+  entry->watch_descriptor_ = -1;
+#endif  // XE_PLATFORM_LINUX
+}
+
+void HostPathDevice::ProcessHostChanges() {
+#if XE_PLATFORM_LINUX
+  if (watch_handle_ == -1) {
+    return;
+  }
+  // Guest threads walk the tree under the same lock.
+  auto global_lock = global_critical_region_.Acquire();
+  alignas(struct inotify_event) char buffer[4096];
+  while (true) {
+    ssize_t length = read(watch_handle_, buffer, sizeof(buffer));
+    if (length <= 0) {
+      break;
+    }
+    for (ssize_t offset = 0; offset < length;) {
+      auto event = reinterpret_cast<struct inotify_event*>(buffer + offset);
+      offset += sizeof(struct inotify_event) + event->len;
+      if (event->mask & IN_Q_OVERFLOW) {
+        XELOGW("Host path change queue overflowed; changes may be missed");
+        continue;
+      }
+      auto it = watched_entries_.find(event->wd);
+      if (it == watched_entries_.end() || !event->len) {
+        continue;
+      }
+      auto parent = it->second;
+      auto child = parent->GetChild(event->name);
+      if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        if (child) {
+          parent->RemoveChild(child);
+        }
+        continue;
+      }
+      auto local_path =
+          xe::join_paths(parent->local_path(), xe::to_wstring(event->name));
+      xe::filesystem::FileInfo file_info;
+      if (!xe::filesystem::GetInfo(local_path, &file_info)) {
+        // Already gone again; the removal event follows.
+        continue;
+      }
+      if (child) {
+        static_cast<HostPathEntry*>(child)->UpdateInfo(file_info);
+      } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+        parent->AddChild(std::unique_ptr<Entry>(
+            HostPathEntry::Create(this, parent, local_path, file_info)));
+      }
+    }
+  }
+#endif  // XE_PLATFORM_LINUX
+}
+
+void HostPathDevice::RemoveEntry(HostPathEntry* parent,
+                                 HostPathEntry* entry) {
+  auto global_lock = global_critical_region_.Acquire();
+  auto detached = parent->DetachChild(entry);
+  if (!detached) {
+    return;
+  }
+  // Nothing is left on the host to watch, and events for it would otherwise
+  // land in the detached subtree.
+  UnwatchTree(entry);
+  if (HasOpenFiles(entry)) {
+    entry->removed_ = true;
+    removed_entries_.push_back(std::move(detached));
+  }
+}
+
+void HostPathDevice::ReleaseFile(HostPathEntry* entry) {
+  auto global_lock = global_critical_region_.Acquire();
+  assert_true(entry->open_file_count_ > 0);
+  --entry->open_file_count_;
+  // Find the removed subtree this entry is in, if any. Removed roots still
+  // point at their old parent, so stop there.
+  auto removed_root = entry;
+  while (!removed_root->removed_) {
+    removed_root = static_cast<HostPathEntry*>(removed_root->parent());
+    if (!removed_root) {
+      return;
+    }
+  }
+  if (HasOpenFiles(removed_root)) {
+    return;
+  }
+  for (auto it = removed_entries_.begin(); it != removed_entries_.end(); ++it) {
+    if (it->get() == removed_root) {
+      removed_entries_.erase(it);
+      break;
+    }
+  }
+}
+
+void HostPathDevice::UnwatchTree(HostPathEntry* entry) {
+  if (entry->watch_descriptor_ != -1) {
+    UnwatchEntry(entry);
+  }
+  for (auto& child : entry->children_) {
+    UnwatchTree(static_cast<HostPathEntry*>(child.get()));
+  }
+}
+
+bool HostPathDevice::HasOpenFiles(HostPathEntry* entry) {
+  if (entry->open_file_count_) {
+    return true;
+  }
+  for (auto& child : entry->children_) {
+    if (HasOpenFiles(static_cast<HostPathEntry*>(child.get()))) {
+      return true;
     }
   }
+  return false;
 }
 
 }  // namespace vfs
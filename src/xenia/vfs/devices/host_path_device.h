@@ -10,7 +10,10 @@
 #ifndef XENIA_VFS_DEVICES_HOST_PATH_DEVICE_H_
 #define XENIA_VFS_DEVICES_HOST_PATH_DEVICE_H_
 
+#include <memory>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "xenia/vfs/device.h"
 
@@ -30,18 +33,38 @@ class HostPathDevice : public Device {
   Entry* ResolvePath(std::string path) override;
 
   bool is_read_only() const override { return read_only_; }
+  bool can_cache_paths() const override { return watch_handle_ == -1; }
 
   uint32_t total_allocation_units() const override { return 128 * 1024; }
   uint32_t available_allocation_units() const override { return 128 * 1024; }
   uint32_t sectors_per_allocation_unit() const override { return 1; }
   uint32_t bytes_per_sector() const override { return 2 * 1024; }
 
+  // Called as a file opened on the entry is destroyed.
+  void ReleaseFile(HostPathEntry* entry);
+
  private:
-  void PopulateEntry(HostPathEntry* parent_entry);
+  friend class HostPathEntry;
+
+  // Host change notification (--host_path_watch). Directories are watched as
+  // they are populated and pending changes are applied on each ResolvePath.
+  void WatchEntry(HostPathEntry* entry);
+  void UnwatchEntry(HostPathEntry* entry);
+  void ProcessHostChanges();
+  // Takes an entry deleted by the guest or on the host out of the tree. Guest
+  // files may still be open on it (or below it), so it's only freed once they
+  // are closed.
+  void RemoveEntry(HostPathEntry* parent, HostPathEntry* entry);
+  void UnwatchTree(HostPathEntry* entry);
+  bool HasOpenFiles(HostPathEntry* entry);
 
   std::wstring local_path_;
   std::unique_ptr<Entry> root_entry_;
   bool read_only_;
+
+  int watch_handle_ = -1;
+  std::unordered_map<int, HostPathEntry*> watched_entries_;
+  std::vector<std::unique_ptr<Entry>> removed_entries_;
 };
 
 }  // namespace vfs
@@ -15,6 +15,7 @@
 #include "xenia/base/math.h"
 #include "xenia/base/string.h"
 #include "xenia/vfs/device.h"
+#include "xenia/vfs/devices/host_path_device.h"
 #include "xenia/vfs/devices/host_path_file.h"
 
 namespace xe {
@@ -24,29 +25,40 @@ HostPathEntry::HostPathEntry(Device* device, Entry* parent, std::string path,
                              const std::wstring& local_path)
     : Entry(device, parent, path), local_path_(local_path) {}
 
-HostPathEntry::~HostPathEntry() = default;
+HostPathEntry::~HostPathEntry() {
+  if (watch_descriptor_ != -1) {
+    static_cast<HostPathDevice*>(device_)->UnwatchEntry(this);
+  }
+}
 
 HostPathEntry* HostPathEntry::Create(Device* device, Entry* parent,
                                      const std::wstring& full_path,
                                      xe::filesystem::FileInfo file_info) {
   auto path = xe::join_paths(parent->path(), xe::to_string(file_info.name));
   auto entry = new HostPathEntry(device, parent, path, full_path);
+  if (file_info.type == xe::filesystem::FileInfo::Type::kDirectory) {
+    // Directories are listed on first access.
+    entry->children_populated_ = false;
+  }
+  entry->UpdateInfo(file_info);
+  return entry;
+}
 
-  entry->create_timestamp_ = file_info.create_timestamp;
-  entry->access_timestamp_ = file_info.access_timestamp;
-  entry->write_timestamp_ = file_info.write_timestamp;
+void HostPathEntry::UpdateInfo(const xe::filesystem::FileInfo& file_info) {
+  create_timestamp_ = file_info.create_timestamp;
+  access_timestamp_ = file_info.access_timestamp;
+  write_timestamp_ = file_info.write_timestamp;
   if (file_info.type == xe::filesystem::FileInfo::Type::kDirectory) {
-    entry->attributes_ = kFileAttributeDirectory;
+    attributes_ = kFileAttributeDirectory;
   } else {
-    entry->attributes_ = kFileAttributeNormal;
-    if (device->is_read_only()) {
-      entry->attributes_ |= kFileAttributeReadOnly;
+    attributes_ = kFileAttributeNormal;
+    if (device_->is_read_only()) {
+      attributes_ |= kFileAttributeReadOnly;
     }
-    entry->size_ = file_info.total_size;
-    entry->allocation_size_ =
-        xe::round_up(file_info.total_size, device->bytes_per_sector());
+    size_ = file_info.total_size;
+    allocation_size_ =
+        xe::round_up(file_info.total_size, device_->bytes_per_sector());
   }
-  return entry;
 }
 
 X_STATUS HostPathEntry::Open(uint32_t desired_access, File** out_file) {
@@ -61,6 +73,8 @@ X_STATUS HostPathEntry::Open(uint32_t desired_access, File** out_file) {
     // TODO(benvanik): pick correct response.
     return X_STATUS_NO_SUCH_FILE;
   }
+  auto global_lock = global_critical_region_.Acquire();
+  ++open_file_count_;
   *out_file = new HostPathFile(desired_access, this, std::move(file_handle));
   return X_STATUS_SUCCESS;
 }
@@ -93,6 +107,24 @@ std::unique_ptr<Entry> HostPathEntry::CreateEntryInternal(std::string name,
       HostPathEntry::Create(device_, this, full_path, file_info));
 }
 
+void HostPathEntry::PopulateChildren() {
+  auto device = static_cast<HostPathDevice*>(device_);
+  // Watch before listing so nothing created in between is missed; duplicate
+  // creation events are ignored.
+  device->WatchEntry(this);
+  auto child_infos = xe::filesystem::ListFiles(local_path_);
+  for (auto& child_info : child_infos) {
+    AddChild(std::unique_ptr<Entry>(HostPathEntry::Create(
+        device_, this, xe::join_paths(local_path_, child_info.name),
+        child_info)));
+  }
+}
+
+void HostPathEntry::RemoveChild(Entry* child) {
+  static_cast<HostPathDevice*>(device_)->RemoveEntry(
+      this, static_cast<HostPathEntry*>(child));
+}
+
 bool HostPathEntry::DeleteEntryInternal(Entry* entry) {
   auto full_path = xe::join_paths(local_path_, xe::to_wstring(entry->name()));
   if (entry->attributes() & kFileAttributeDirectory) {
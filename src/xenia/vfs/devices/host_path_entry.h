@@ -32,6 +32,9 @@ class HostPathEntry : public Entry {
 
   const std::wstring& local_path() { return local_path_; }
 
+  // Refreshes size and timestamps from the host file.
+  void UpdateInfo(const xe::filesystem::FileInfo& file_info);
+
   X_STATUS Open(uint32_t desired_access, File** out_file) override;
 
   bool can_map() const override { return true; }
@@ -45,8 +48,17 @@ class HostPathEntry : public Entry {
   std::unique_ptr<Entry> CreateEntryInternal(std::string name,
                                              uint32_t attributes) override;
   bool DeleteEntryInternal(Entry* entry) override;
+  void PopulateChildren() override;
+  void RemoveChild(Entry* child) override;
 
   std::wstring local_path_;
+  // Host change watch on this directory, if the device is watching.
+  int watch_descriptor_ = -1;
+  // Files open on this entry. Removed entries outlive their files; see
+  // HostPathDevice::RemoveEntry.
+  int open_file_count_ = 0;
+  // Set on the root of a removed subtree that still has files open.
+  bool removed_ = false;
 };
 
 }  // namespace vfs
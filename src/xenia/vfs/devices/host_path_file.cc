@@ -9,6 +9,7 @@
 
 #include "xenia/vfs/devices/host_path_file.h"
 
+#include "xenia/vfs/devices/host_path_device.h"
 #include "xenia/vfs/devices/host_path_entry.h"
 
 namespace xe {
@@ -19,7 +20,10 @@ HostPathFile::HostPathFile(
     std::unique_ptr<xe::filesystem::FileHandle> file_handle)
     : File(file_access, entry), file_handle_(std::move(file_handle)) {}
 
-HostPathFile::~HostPathFile() = default;
+HostPathFile::~HostPathFile() {
+  auto entry = static_cast<HostPathEntry*>(entry_);
+  static_cast<HostPathDevice*>(entry->device())->ReleaseFile(entry);
+}
 
 void HostPathFile::Destroy() { delete this; }
 
@@ -64,5 +68,13 @@ X_STATUS HostPathFile::SetLength(size_t length) {
   }
 }
 
+X_STATUS HostPathFile::GetLength(size_t* out_length) {
+  if (file_handle_->GetLength(out_length)) {
+    return X_STATUS_SUCCESS;
+  } else {
+    return X_STATUS_UNSUCCESSFUL;
+  }
+}
+
 }  // namespace vfs
 }  // namespace xe
@@ -261,29 +261,17 @@ bool StfsContainerDevice::ReadEntryEGDF(const uint8_t* buffer,
       uint32_t sector_index = sector;
       size_t remaining_size = xe::round_up(length, 0x800);
 
-      size_t last_record = -1;
-      size_t last_offset = -1;
       while (remaining_size) {
         size_t block_size = 0x800;
         size_t offset = BlockToOffsetEGDF(sector_index);
         sector_index++;
         remaining_size -= block_size;
-
-        if (offset - last_offset == 0x800) {
-          // Consecutive, so append to last entry.
-          entry->block_list_[last_record].length += block_size;
-          last_offset = offset;
-          continue;
-        }
-
-        entry->block_list_.push_back({offset, block_size});
-        last_record = entry->block_list_.size() - 1;
-        last_offset = offset;
+        entry->AppendBlock(offset, block_size);
       }
     }
   }
 
-  parent->children_.emplace_back(std::move(entry));
+  parent->AddChild(std::move(entry));
 
   // Read next file in the list.
   if (node_r && !ReadEntryEGDF(buffer, node_r, parent)) {
@@ -367,7 +355,7 @@ StfsContainerDevice::Error StfsContainerDevice::ReadAllEntriesSTFS(
           size_t block_size =
               std::min(static_cast<size_t>(0x1000), remaining_size);
           size_t offset = BlockToOffsetSTFS(block_index);
-          entry->block_list_.push_back({offset, block_size});
+          entry->AppendBlock(offset, block_size);
           remaining_size -= block_size;
           auto block_hash = GetBlockHash(map_ptr, block_index, 0);
           if (table_size_shift_ && block_hash.info < 0x80) {
@@ -378,7 +366,7 @@ StfsContainerDevice::Error StfsContainerDevice::ReadAllEntriesSTFS(
         }
       }
 
-      parent_entry->children_.emplace_back(std::move(entry));
+      parent_entry->AddChild(std::move(entry));
     }
 
     auto block_hash = GetBlockHash(map_ptr, table_block_index, 0);
@@ -9,6 +9,8 @@
 
 #include "xenia/vfs/devices/stfs_container_entry.h"
 
+#include <algorithm>
+
 #include "xenia/base/math.h"
 #include "xenia/vfs/devices/stfs_container_file.h"
 
@@ -32,6 +34,36 @@ std::unique_ptr<StfsContainerEntry> StfsContainerEntry::Create(
   return std::move(entry);
 }
 
+void StfsContainerEntry::AppendBlock(size_t offset, size_t length) {
+  if (!block_list_.empty()) {
+    auto& last = block_list_.back();
+    if (last.offset + last.length == offset) {
+      last.length += length;
+      return;
+    }
+    block_list_.push_back({offset, length, last.file_offset + last.length});
+  } else {
+    block_list_.push_back({offset, length, 0});
+  }
+}
+
+size_t StfsContainerEntry::FindBlock(size_t byte_offset) const {
+  // First run starting after byte_offset; the one before it contains it.
+  auto it = std::upper_bound(
+      block_list_.begin(), block_list_.end(), byte_offset,
+      [](size_t value, const BlockRecord& record) {
+        return value < record.file_offset;
+      });
+  if (it == block_list_.begin()) {
+    return block_list_.size();
+  }
+  --it;
+  if (byte_offset >= it->file_offset + it->length) {
+    return block_list_.size();
+  }
+  return it - block_list_.begin();
+}
+
 X_STATUS StfsContainerEntry::Open(uint32_t desired_access, File** out_file) {
   *out_file = new StfsContainerFile(desired_access, this);
   return X_STATUS_SUCCESS;
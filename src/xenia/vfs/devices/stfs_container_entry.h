@@ -40,12 +40,22 @@ class StfsContainerEntry : public Entry {
 
   X_STATUS Open(uint32_t desired_access, File** out_file) override;
 
+  // A run of blocks that are contiguous in the container.
   struct BlockRecord {
-    size_t offset;
-    size_t length;
+    size_t offset;       // Offset of the run in the container.
+    size_t length;       // Length of the run in bytes.
+    size_t file_offset;  // Offset of the run in the file (sum of prior runs).
   };
   const std::vector<BlockRecord>& block_list() const { return block_list_; }
 
+  // Appends the next block of the file, extending the last run if the block
+  // directly follows it in the container.
+  void AppendBlock(size_t offset, size_t length);
+
+  // Returns the index of the run containing byte_offset in the file, or
+  // block_list().size() if it is past the end.
+  size_t FindBlock(size_t byte_offset) const;
+
  private:
   friend class StfsContainerDevice;
 
@@ -33,33 +33,27 @@ X_STATUS StfsContainerFile::ReadSync(void* buffer, size_t buffer_length,
     return X_STATUS_END_OF_FILE;
   }
 
-  size_t src_offset = 0;
   uint8_t* src = entry_->mmap()->data();
   uint8_t* p = reinterpret_cast<uint8_t*>(buffer);
   size_t remaining_length =
       std::min(buffer_length, entry_->size() - byte_offset);
   *out_bytes_read = remaining_length;
 
-  for (size_t i = 0; i < entry_->block_list().size(); i++) {
-    auto& record = entry_->block_list()[i];
-    if (src_offset + record.length <= byte_offset) {
-      // Doesn't begin in this region. Skip it.
-      src_offset += record.length;
-      continue;
-    }
-
+  // Seek straight to the run holding byte_offset and copy whole runs from
+  // there.
+  auto& block_list = entry_->block_list();
+  for (size_t i = entry_->FindBlock(byte_offset);
+       i < block_list.size() && remaining_length; i++) {
+    auto& record = block_list[i];
     size_t read_offset =
-        (byte_offset > src_offset) ? byte_offset - src_offset : 0;
+        (byte_offset > record.file_offset) ? byte_offset - record.file_offset
+                                           : 0;
     size_t read_length =
         std::min(record.length - read_offset, remaining_length);
     std::memcpy(p, src + record.offset + read_offset, read_length);
 
     p += read_length;
-    src_offset += record.length;
     remaining_length -= read_length;
-    if (remaining_length == 0) {
-      break;
-    }
   }
 
   return X_STATUS_SUCCESS;
@@ -39,6 +39,7 @@ void Entry::Dump(xe::StringBuffer* string_buffer, int indent) {
   }
   string_buffer->Append(name());
   string_buffer->Append('\n');
+  EnsurePopulated();
   for (auto& child : children_) {
     child->Dump(string_buffer, indent + 2);
   }
@@ -48,18 +49,15 @@ bool Entry::is_read_only() const { return device_->is_read_only(); }
 
 Entry* Entry::GetChild(std::string name) {
   auto global_lock = global_critical_region_.Acquire();
-  // TODO(benvanik): a faster search
-  for (auto& child : children_) {
-    if (strcasecmp(child->name().c_str(), name.c_str()) == 0) {
-      return child.get();
-    }
-  }
-  return nullptr;
+  EnsurePopulated();
+  auto it = child_index_.find(xe::to_lower_ascii(std::move(name)));
+  return it != child_index_.end() ? it->second : nullptr;
 }
 
 Entry* Entry::IterateChildren(const xe::filesystem::WildcardEngine& engine,
                               size_t* current_index) {
   auto global_lock = global_critical_region_.Acquire();
+  EnsurePopulated();
   while (*current_index < children_.size()) {
     auto& child = children_[*current_index];
     *current_index = *current_index + 1;
@@ -83,10 +81,10 @@ Entry* Entry::CreateEntry(std::string name, uint32_t attributes) {
   if (!entry) {
     return nullptr;
   }
-  children_.push_back(std::move(entry));
+  auto child = AddChild(std::move(entry));
   // TODO(benvanik): resort? would break iteration?
   Touch();
-  return children_.back().get();
+  return child;
 }
 
 bool Entry::Delete(Entry* entry) {
@@ -100,12 +98,7 @@ bool Entry::Delete(Entry* entry) {
   if (!DeleteEntryInternal(entry)) {
     return false;
   }
-  for (auto it = children_.begin(); it != children_.end(); ++it) {
-    if (it->get() == entry) {
-      children_.erase(it);
-      break;
-    }
-  }
+  RemoveChild(entry);
   Touch();
   return true;
 }
@@ -115,6 +108,41 @@ bool Entry::Delete() {
   return parent_->Delete(this);
 }
 
+void Entry::EnsurePopulated() {
+  auto global_lock = global_critical_region_.Acquire();
+  if (!children_populated_) {
+    PopulateChildren();
+    children_populated_ = true;
+  }
+}
+
+Entry* Entry::AddChild(std::unique_ptr<Entry> child) {
+  auto child_ptr = child.get();
+  // First one wins on case-only collisions, as the linear scan did.
+  child_index_.emplace(xe::to_lower_ascii(child->name()), child_ptr);
+  children_.push_back(std::move(child));
+  return child_ptr;
+}
+
+void Entry::RemoveChild(Entry* child) { DetachChild(child); }
+
+std::unique_ptr<Entry> Entry::DetachChild(Entry* child) {
+  // Anything holding on to entries of this device must re-resolve.
+  device_->InvalidateEntries();
+  auto it = child_index_.find(xe::to_lower_ascii(child->name()));
+  if (it != child_index_.end() && it->second == child) {
+    child_index_.erase(it);
+  }
+  for (auto it = children_.begin(); it != children_.end(); ++it) {
+    if (it->get() == child) {
+      auto detached = std::move(*it);
+      children_.erase(it);
+      return detached;
+    }
+  }
+  return nullptr;
+}
+
 void Entry::Touch() {
   // TODO(benvanik): update timestamps.
 }
@@ -12,6 +12,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "xenia/base/filesystem.h"
@@ -98,10 +99,14 @@ class Entry {
 
   Entry* GetChild(std::string name);
 
-  const std::vector<std::unique_ptr<Entry>>& children() const {
+  const std::vector<std::unique_ptr<Entry>>& children() {
+    EnsurePopulated();
     return children_;
   }
-  size_t child_count() const { return children_.size(); }
+  size_t child_count() {
+    EnsurePopulated();
+    return children_.size();
+  }
   Entry* IterateChildren(const xe::filesystem::WildcardEngine& engine,
                          size_t* current_index);
 
@@ -130,6 +135,19 @@ class Entry {
   }
   virtual bool DeleteEntryInternal(Entry* entry) { return false; }
 
+  // Devices that populate their tree on demand clear children_populated_ on
+  // directory entries and fill children_ here on first access.
+  virtual void PopulateChildren() {}
+  void EnsurePopulated();
+
+  // Adds a child and indexes it by case-folded name for GetChild.
+  Entry* AddChild(std::unique_ptr<Entry> child);
+  // Removes (and destroys) a child previously added with AddChild. Devices
+  // whose files can outlive their entry override this to defer the destroy.
+  virtual void RemoveChild(Entry* child);
+  // Removes a child previously added with AddChild and returns it.
+  std::unique_ptr<Entry> DetachChild(Entry* child);
+
   xe::global_critical_region global_critical_region_;
   Device* device_;
   Entry* parent_;
@@ -143,6 +161,8 @@ class Entry {
   uint64_t access_timestamp_;
   uint64_t write_timestamp_;
   std::vector<std::unique_ptr<Entry>> children_;
+  std::unordered_map<std::string, Entry*> child_index_;
+  bool children_populated_ = true;
 };
 
 }  // namespace vfs
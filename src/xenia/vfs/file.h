@@ -45,6 +45,11 @@ class File {
   }
 
   virtual X_STATUS SetLength(size_t length) { return X_STATUS_NOT_IMPLEMENTED; }
+  // Current length of the file's data, for devices where it can change
+  // without the entry knowing. Others use the entry size.
+  virtual X_STATUS GetLength(size_t* out_length) {
+    return X_STATUS_NOT_IMPLEMENTED;
+  }
 
   // xe::filesystem::FileAccess
   uint32_t file_access() const { return file_access_; }
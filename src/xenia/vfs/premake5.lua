@@ -42,3 +42,4 @@ project("xenia-vfs-dump")
     project_root,
   })
 
+include("testing")
@@ -0,0 +1,98 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <cstdio>
+#include <string>
+
+#include "xenia/base/filesystem.h"
+#include "xenia/base/platform.h"
+#include "xenia/base/string.h"
+#include "xenia/vfs/devices/host_path_device.h"
+#include "xenia/vfs/file.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace vfs {
+namespace test {
+
+// Windows refuses to delete files that are open, so there is nothing to test.
+#if !XE_PLATFORM_WIN32
+
+// A scratch host directory holding sub\test.bin.
+class ScratchFolder {
+ public:
+  ScratchFolder() : path_(L"xenia-vfs-tests-host-path") {
+    xe::filesystem::DeleteFolder(path_);
+    auto sub_path = xe::join_paths(path_, L"sub");
+    xe::filesystem::CreateFolder(path_);
+    xe::filesystem::CreateFolder(sub_path);
+    auto file = xe::filesystem::OpenFile(
+        xe::join_paths(sub_path, L"test.bin"), "wb");
+    std::fputs("test", file);
+    std::fclose(file);
+  }
+  ~ScratchFolder() { xe::filesystem::DeleteFolder(path_); }
+
+  const std::wstring& path() const { return path_; }
+
+ private:
+  std::wstring path_;
+};
+
+TEST_CASE("host_path_delete_open_file", "HostPathDevice") {
+  ScratchFolder folder;
+  HostPathDevice device("\\Device\\Test", folder.path(), false);
+  REQUIRE(device.Initialize());
+
+  auto entry = device.ResolvePath("sub\\test.bin");
+  REQUIRE(entry);
+  File* file = nullptr;
+  REQUIRE(entry->Open(FileAccess::kFileReadData, &file) == X_STATUS_SUCCESS);
+
+  REQUIRE(entry->Delete());
+  REQUIRE(!device.ResolvePath("sub\\test.bin"));
+
+  // The open file keeps the removed entry alive until it is closed.
+  REQUIRE(file->entry() == entry);
+  REQUIRE(file->entry()->name() == "test.bin");
+  char buffer[4];
+  size_t bytes_read = 0;
+  REQUIRE(file->ReadSync(buffer, sizeof(buffer), 0, &bytes_read) ==
+          X_STATUS_SUCCESS);
+  REQUIRE(bytes_read == sizeof(buffer));
+  file->Destroy();
+}
+
+TEST_CASE("host_path_delete_folder_with_open_file", "HostPathDevice") {
+  ScratchFolder folder;
+  HostPathDevice device("\\Device\\Test", folder.path(), false);
+  REQUIRE(device.Initialize());
+
+  auto sub_entry = device.ResolvePath("sub");
+  auto entry = device.ResolvePath("sub\\test.bin");
+  REQUIRE(sub_entry);
+  REQUIRE(entry);
+  File* file = nullptr;
+  REQUIRE(entry->Open(FileAccess::kFileReadData, &file) == X_STATUS_SUCCESS);
+
+  REQUIRE(sub_entry->Delete());
+  REQUIRE(!device.ResolvePath("sub"));
+
+  // The whole removed subtree stays alive, up to the deleted folder.
+  REQUIRE(file->entry()->parent() == sub_entry);
+  REQUIRE(sub_entry->name() == "sub");
+  file->Destroy();
+}
+
+#endif  // !XE_PLATFORM_WIN32
+
+}  // namespace test
+}  // namespace vfs
+}  // namespace xe
@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * Xenia : Xbox 360 Emulator Research Project                                 *
+ ******************************************************************************
+ * Copyright 2017 Ben Vanik. All rights reserved.                             *
+ * Released under the BSD license - see LICENSE in the root for more details. *
+ ******************************************************************************
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "xenia/base/mapped_memory.h"
+#include "xenia/vfs/devices/stfs_container_device.h"
+#include "xenia/vfs/devices/stfs_container_entry.h"
+#include "xenia/vfs/devices/stfs_container_file.h"
+
+#include "third_party/catch/include/catch.hpp"
+
+namespace xe {
+namespace vfs {
+namespace test {
+
+constexpr size_t kBlockSize = 0x1000;
+
+class TestEntry : public StfsContainerEntry {
+ public:
+  TestEntry(Device* device, MappedMemory* mmap)
+      : StfsContainerEntry(device, nullptr, "test.bin", mmap) {}
+  void set_size(size_t size) { size_ = size; }
+};
+
+// A synthetic package: a container holding one file whose blocks are
+// scattered through it in runs of 1 to max_run_blocks contiguous blocks.
+class SyntheticPackage {
+ public:
+  SyntheticPackage(size_t block_count, size_t max_run_blocks, size_t tail)
+      : device_("\\Device\\Test", L""),
+        container_(block_count * kBlockSize),
+        file_data_((block_count - 1) * kBlockSize + tail) {
+    std::mt19937 rng(1234);
+    for (size_t i = 0; i < file_data_.size(); ++i) {
+      file_data_[i] = uint8_t(rng());
+    }
+
+    // Chop the file into runs and shuffle where each run lands.
+    std::vector<std::pair<size_t, size_t>> runs;
+    std::uniform_int_distribution<size_t> run_dist(1, max_run_blocks);
+    for (size_t block = 0; block < block_count;) {
+      size_t length = std::min(run_dist(rng), block_count - block);
+      runs.push_back({block, length});
+      block += length;
+    }
+    std::vector<size_t> order(runs.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      order[i] = i;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<size_t> container_block(block_count);
+    size_t next_block = 0;
+    for (size_t run_index : order) {
+      auto& run = runs[run_index];
+      for (size_t i = 0; i < run.second; ++i) {
+        container_block[run.first + i] = next_block++;
+      }
+    }
+
+    mmap_ = std::make_unique<MappedMemory>(L"", MappedMemory::Mode::kRead,
+                                           container_.data(),
+                                           container_.size());
+    entry_ = std::make_unique<TestEntry>(&device_, mmap_.get());
+    entry_->set_size(file_data_.size());
+    for (size_t block = 0; block < block_count; ++block) {
+      size_t offset = container_block[block] * kBlockSize;
+      size_t length =
+          std::min(kBlockSize, file_data_.size() - block * kBlockSize);
+      std::memcpy(container_.data() + offset,
+                  file_data_.data() + block * kBlockSize, length);
+      entry_->AppendBlock(offset, length);
+    }
+    file_ = std::make_unique<StfsContainerFile>(0, entry_.get());
+  }
+
+  StfsContainerEntry* entry() const { return entry_.get(); }
+  StfsContainerFile* file() const { return file_.get(); }
+  const std::vector<uint8_t>& file_data() const { return file_data_; }
+
+ private:
+  StfsContainerDevice device_;
+  std::vector<uint8_t> container_;
+  std::vector<uint8_t> file_data_;
+  std::unique_ptr<MappedMemory> mmap_;
+  std::unique_ptr<TestEntry> entry_;
+  std::unique_ptr<StfsContainerFile> file_;
+};
+
+TEST_CASE("stfs_append_block_merges_runs", "STFS") {
+  StfsContainerDevice device("\\Device\\Test", L"");
+  TestEntry entry(&device, nullptr);
+  entry.AppendBlock(0x1000, 0x1000);
+  entry.AppendBlock(0x2000, 0x1000);
+  entry.AppendBlock(0x8000, 0x1000);
+  entry.AppendBlock(0x3000, 0x800);
+  auto& blocks = entry.block_list();
+  REQUIRE(blocks.size() == 3);
+  REQUIRE(blocks[0].offset == 0x1000);
+  REQUIRE(blocks[0].length == 0x2000);
+  REQUIRE(blocks[0].file_offset == 0);
+  REQUIRE(blocks[1].file_offset == 0x2000);
+  REQUIRE(blocks[2].file_offset == 0x3000);
+
+  REQUIRE(entry.FindBlock(0) == 0);
+  REQUIRE(entry.FindBlock(0x1FFF) == 0);
+  REQUIRE(entry.FindBlock(0x2000) == 1);
+  REQUIRE(entry.FindBlock(0x37FF) == 2);
+  REQUIRE(entry.FindBlock(0x3800) == blocks.size());
+}
+
+TEST_CASE("stfs_read_matches_file", "STFS") {
+  SyntheticPackage package(512, 8, 0x123);
+  auto& data = package.file_data();
+  std::vector<uint8_t> buffer(data.size());
+
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<size_t> offset_dist(0, data.size() - 1);
+  std::uniform_int_distribution<size_t> length_dist(1, 8 * kBlockSize);
+  for (int i = 0; i < 2000; ++i) {
+    size_t offset = offset_dist(rng);
+    size_t length = length_dist(rng);
+    size_t bytes_read = 0;
+    REQUIRE(package.file()->ReadSync(buffer.data(), length, offset,
+                                     &bytes_read) == X_STATUS_SUCCESS);
+    REQUIRE(bytes_read == std::min(length, data.size() - offset));
+    REQUIRE(std::memcmp(buffer.data(), data.data() + offset, bytes_read) == 0);
+  }
+
+  // Whole file, and past the end.
+  size_t bytes_read = 0;
+  REQUIRE(package.file()->ReadSync(buffer.data(), buffer.size(), 0,
+                                   &bytes_read) == X_STATUS_SUCCESS);
+  REQUIRE(bytes_read == data.size());
+  REQUIRE(std::memcmp(buffer.data(), data.data(), data.size()) == 0);
+  REQUIRE(package.file()->ReadSync(buffer.data(), 1, data.size(),
+                                   &bytes_read) == X_STATUS_END_OF_FILE);
+}
+
+// Not run by default; use `xenia-vfs-tests [benchmark]`.
+TEST_CASE("stfs_random_read_benchmark", "[.][benchmark]") {
+  // 256MB package, fully fragmented into single-block runs (worst case).
+  const size_t block_count = 256 * 1024 * 1024 / kBlockSize;
+  SyntheticPackage package(block_count, 1, kBlockSize);
+  auto& data = package.file_data();
+  std::vector<uint8_t> buffer(64 * 1024);
+
+  std::mt19937 rng(7);
+  std::uniform_int_distribution<size_t> offset_dist(
+      0, data.size() - buffer.size());
+  const int read_count = 20000;
+  std::vector<size_t> offsets(read_count);
+  for (auto& offset : offsets) {
+    offset = offset_dist(rng);
+  }
+
+  auto start = std::chrono::high_resolution_clock::now();
+  for (size_t offset : offsets) {
+    size_t bytes_read = 0;
+    package.file()->ReadSync(buffer.data(), buffer.size(), offset,
+                             &bytes_read);
+  }
+  auto elapsed = std::chrono::duration<double, std::micro>(
+                     std::chrono::high_resolution_clock::now() - start)
+                     .count();
+  std::printf("stfs: %zu runs, %d random 64KB reads, %.2f us/read\n",
+              package.entry()->block_list().size(), read_count,
+              elapsed / read_count);
+}
+
+}  // namespace test
+}  // namespace vfs
+}  // namespace xe
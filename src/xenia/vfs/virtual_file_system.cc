@@ -9,6 +9,9 @@
 
 #include "xenia/vfs/virtual_file_system.h"
 
+#include <algorithm>
+#include <functional>
+
 #include "xenia/base/filesystem.h"
 #include "xenia/base/logging.h"
 #include "xenia/base/string.h"
@@ -17,17 +20,64 @@
 namespace xe {
 namespace vfs {
 
+// Bounds memory for titles that probe many unique paths.
+constexpr size_t kMaxPathCacheSize = 16 * 1024;
+
+// Returns the longest key of map that prefixes path, given all distinct key
+// lengths in descending order. One hash probe per distinct length.
+template <typename T>
+static typename std::unordered_map<std::string, T>::const_iterator
+FindLongestPrefix(const std::unordered_map<std::string, T>& map,
+                  const std::vector<size_t>& prefix_lengths,
+                  const std::string& path) {
+  for (size_t length : prefix_lengths) {
+    if (length > path.size()) {
+      continue;
+    }
+    auto it = map.find(path.substr(0, length));
+    if (it != map.end()) {
+      return it;
+    }
+  }
+  return map.end();
+}
+
+template <typename T>
+static void UpdatePrefixLengths(const std::unordered_map<std::string, T>& map,
+                                std::vector<size_t>* prefix_lengths) {
+  prefix_lengths->clear();
+  for (auto& it : map) {
+    prefix_lengths->push_back(it.first.size());
+  }
+  std::sort(prefix_lengths->begin(), prefix_lengths->end(),
+            std::greater<size_t>());
+  prefix_lengths->erase(
+      std::unique(prefix_lengths->begin(), prefix_lengths->end()),
+      prefix_lengths->end());
+}
+
 VirtualFileSystem::VirtualFileSystem() {}
 
 VirtualFileSystem::~VirtualFileSystem() {
   // Delete all devices.
   // This will explode if anyone is still using data from them.
+  ClearPathCache();
+  device_index_.clear();
   devices_.clear();
   symlinks_.clear();
 }
 
+void VirtualFileSystem::ClearPathCache() {
+  std::unique_lock<std::shared_timed_mutex> cache_lock(path_cache_mutex_);
+  path_cache_.clear();
+}
+
 bool VirtualFileSystem::RegisterDevice(std::unique_ptr<Device> device) {
   auto global_lock = global_critical_region_.Acquire();
+  ClearPathCache();
+  // Later registrations shadow earlier ones at the same mount path.
+  device_index_[xe::to_lower_ascii(device->mount_path())] = device.get();
+  UpdatePrefixLengths(device_index_, &device_prefix_lengths_);
   devices_.emplace_back(std::move(device));
   return true;
 }
@@ -37,6 +87,23 @@ bool VirtualFileSystem::UnregisterDevice(const std::string& path) {
   for (auto it = devices_.begin(); it != devices_.end(); ++it) {
     if ((*it)->mount_path() == path) {
       XELOGD("Unregistered device: %s", (*it)->mount_path().c_str());
+      // Hold the cache exclusively so no lookup is reading the device as it
+      // goes away.
+      std::unique_lock<std::shared_timed_mutex> cache_lock(path_cache_mutex_);
+      path_cache_.clear();
+      auto index_key = xe::to_lower_ascii(path);
+      auto index_it = device_index_.find(index_key);
+      if (index_it != device_index_.end() && index_it->second == it->get()) {
+        device_index_.erase(index_it);
+        // Uncover a device previously shadowed at the same mount path.
+        for (auto& device : devices_) {
+          if (device.get() != it->get() &&
+              xe::to_lower_ascii(device->mount_path()) == index_key) {
+            device_index_[index_key] = device.get();
+          }
+        }
+        UpdatePrefixLengths(device_index_, &device_prefix_lengths_);
+      }
       devices_.erase(it);
       return true;
     }
@@ -47,7 +114,9 @@ bool VirtualFileSystem::UnregisterDevice(const std::string& path) {
 bool VirtualFileSystem::RegisterSymbolicLink(const std::string& path,
                                              const std::string& target) {
   auto global_lock = global_critical_region_.Acquire();
-  symlinks_.insert({path, target});
+  ClearPathCache();
+  symlinks_.insert({xe::to_lower_ascii(path), target});
+  UpdatePrefixLengths(symlinks_, &symlink_prefix_lengths_);
   XELOGD("Registered symbolic link: %s => %s", path.c_str(), target.c_str());
 
   return true;
@@ -55,20 +124,22 @@ bool VirtualFileSystem::RegisterSymbolicLink(const std::string& path,
 
 bool VirtualFileSystem::UnregisterSymbolicLink(const std::string& path) {
   auto global_lock = global_critical_region_.Acquire();
-  auto it = symlinks_.find(path);
+  auto it = symlinks_.find(xe::to_lower_ascii(path));
   if (it == symlinks_.end()) {
     return false;
   }
-  XELOGD("Unregistered symbolic link: %s => %s", it->first.c_str(),
+  XELOGD("Unregistered symbolic link: %s => %s", path.c_str(),
          it->second.c_str());
 
+  ClearPathCache();
   symlinks_.erase(it);
+  UpdatePrefixLengths(symlinks_, &symlink_prefix_lengths_);
   return true;
 }
 
 bool VirtualFileSystem::IsSymbolicLink(const std::string& path) {
   auto global_lock = global_critical_region_.Acquire();
-  auto it = symlinks_.find(path);
+  auto it = symlinks_.find(xe::to_lower_ascii(path));
   if (it == symlinks_.end()) {
     return false;
   }
@@ -76,60 +147,78 @@ bool VirtualFileSystem::IsSymbolicLink(const std::string& path) {
 }
 
 Entry* VirtualFileSystem::ResolvePath(const std::string& path) {
+  auto cache_key = xe::to_lower_ascii(path);
+  {
+    std::shared_lock<std::shared_timed_mutex> cache_lock(path_cache_mutex_);
+    auto it = path_cache_.find(cache_key);
+    if (it != path_cache_.end() &&
+        it->second.generation == it->second.device->entry_generation()) {
+      return it->second.entry;
+    }
+  }
+
   auto global_lock = global_critical_region_.Acquire();
 
   // Resolve relative paths
   std::string normalized_path(xe::filesystem::CanonicalizePath(path));
+  std::string lowered_path = xe::to_lower_ascii(normalized_path);
 
   // Resolve symlinks.
   std::string device_path;
   std::string relative_path;
   for (int i = 0; i < 2; i++) {
-    for (const auto& it : symlinks_) {
-      if (xe::find_first_of_case(normalized_path, it.first) == 0) {
-        // Found symlink!
-        device_path = it.second;
-        if (relative_path.empty()) {
-          relative_path = normalized_path.substr(it.first.size());
-        }
-
-        // Bit of a cheaty move here, but allows double symlinks to be resolved.
-        normalized_path = device_path;
-        break;
-      }
+    auto it = FindLongestPrefix(symlinks_, symlink_prefix_lengths_,
+                                lowered_path);
+    if (it == symlinks_.end()) {
+      break;
     }
+    // Found symlink!
+    device_path = it->second;
+    if (relative_path.empty()) {
+      relative_path = normalized_path.substr(it->first.size());
+    }
+
+    // Bit of a cheaty move here, but allows double symlinks to be resolved.
+    normalized_path = device_path;
+    lowered_path = xe::to_lower_ascii(device_path);
 
     // Break as soon as we've completely resolved the symlinks to a device.
-    if (!IsSymbolicLink(device_path)) {
+    if (!symlinks_.count(lowered_path)) {
       break;
     }
   }
 
+  Device* device = nullptr;
   if (device_path.empty()) {
     // Symlink wasn't passed in - Check if we've received a raw device name.
-    for (auto& device : devices_) {
-      if (xe::find_first_of_case(normalized_path, device->mount_path()) == 0) {
-        device_path = device->mount_path();
-        relative_path = normalized_path.substr(device_path.size());
-      }
+    auto it = FindLongestPrefix(device_index_, device_prefix_lengths_,
+                                lowered_path);
+    if (it == device_index_.end()) {
+      XELOGE("ResolvePath(%s) failed - no root found", path.c_str());
+      return nullptr;
     }
+    device = it->second;
+    relative_path = normalized_path.substr(it->first.size());
+  } else {
+    auto it = device_index_.find(lowered_path);
+    if (it == device_index_.end()) {
+      XELOGE("ResolvePath(%s) failed - device not found (%s)", path.c_str(),
+             device_path.c_str());
+      return nullptr;
+    }
+    device = it->second;
   }
 
-  if (device_path.empty()) {
-    XELOGE("ResolvePath(%s) failed - no root found", path.c_str());
-    return nullptr;
-  }
-
-  // Scan all devices.
-  for (auto& device : devices_) {
-    if (strcasecmp(device_path.c_str(), device->mount_path().c_str()) == 0) {
-      return device->ResolvePath(relative_path);
+  uint32_t generation = device->entry_generation();
+  auto entry = device->ResolvePath(relative_path);
+  if (entry && device->can_cache_paths()) {
+    std::unique_lock<std::shared_timed_mutex> cache_lock(path_cache_mutex_);
+    if (path_cache_.size() >= kMaxPathCacheSize) {
+      path_cache_.clear();
     }
+    path_cache_[cache_key] = {entry, device, generation};
   }
-
-  XELOGE("ResolvePath(%s) failed - device not found (%s)", path.c_str(),
-         device_path.c_str());
-  return nullptr;
+  return entry;
 }
 
 Entry* VirtualFileSystem::ResolveBasePath(const std::string& path) {
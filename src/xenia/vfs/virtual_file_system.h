@@ -11,6 +11,7 @@
 #define XENIA_VFS_VIRTUAL_FILE_SYSTEM_H_
 
 #include <memory>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -47,9 +48,28 @@ class VirtualFileSystem {
                     FileAction* out_action);
 
  private:
+  struct CachedPath {
+    Entry* entry;
+    Device* device;
+    uint32_t generation;
+  };
+
+  void ClearPathCache();
+
   xe::global_critical_region global_critical_region_;
   std::vector<std::unique_ptr<Device>> devices_;
+  // Keyed by lowercased mount path.
+  std::unordered_map<std::string, Device*> device_index_;
+  std::vector<size_t> device_prefix_lengths_;
+  // Keyed by lowercased link path.
   std::unordered_map<std::string, std::string> symlinks_;
+  std::vector<size_t> symlink_prefix_lengths_;
+
+  // Lowercased guest path -> resolved entry. Read without the global lock.
+  // Only hits are cached: creating an entry never invalidates one, and
+  // removals are caught by the device entry generation.
+  std::shared_timed_mutex path_cache_mutex_;
+  std::unordered_map<std::string, CachedPath> path_cache_;
 };
 
 }  // namespace vfs